@@ -0,0 +1,90 @@
+#include <cstdio>
+#include "twitatomicfile.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*++
+* @method: twitAtomicFile::twitAtomicFile
+*
+* @description: constructor, creates the temporary file
+*
+* @input: path - file to write,
+*         binary - true to write bytes as they are
+*
+* @output: none
+*
+*--*/
+twitAtomicFile::twitAtomicFile( const std::string& path, bool binary ):
+m_path( path ),
+m_tempPath( path + ".tmp" ),
+m_stream( m_tempPath.c_str(), binary ? ( std::ios::binary | std::ios::trunc ) : std::ios::trunc ),
+m_committed( false )
+{
+}
+
+/*++
+* @method: twitAtomicFile::~twitAtomicFile
+*
+* @description: destructor, removes the temporary file unless committed
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitAtomicFile::~twitAtomicFile()
+{
+    if( !m_committed )
+    {
+        m_stream.close();
+        remove( m_tempPath.c_str() );
+    }
+}
+
+/*++
+* @method: twitAtomicFile::commit
+*
+* @description: puts what was written in place of the file. on Windows a
+*               file mapped by a reader cannot be replaced; the old file
+*               then stays.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if the file now holds what was written
+*
+*--*/
+bool twitAtomicFile::commit( std::string& errorMessage )
+{
+    m_stream.close();
+    if( !m_stream )
+    {
+        errorMessage = "cannot write " + m_tempPath;
+        return false;
+    }
+
+#ifdef _WIN32
+    bool replaced = ( 0 != MoveFileExA( m_tempPath.c_str(), m_path.c_str(),
+                                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) );
+#else
+    /* The bytes must be on disk before the name points at them */
+    int fd = open( m_tempPath.c_str(), O_RDONLY );
+    bool replaced = ( fd >= 0 ) && ( 0 == fsync( fd ) );
+    if( fd >= 0 )
+    {
+        close( fd );
+    }
+    replaced = replaced && ( 0 == rename( m_tempPath.c_str(), m_path.c_str() ) );
+#endif
+    if( !replaced )
+    {
+        errorMessage = "cannot replace " + m_path;
+        return false;
+    }
+    m_committed = true;
+    return true;
+}
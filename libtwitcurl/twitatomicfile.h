@@ -0,0 +1,34 @@
+#ifndef _TWITATOMICFILE_H_
+#define _TWITATOMICFILE_H_
+
+#include <fstream>
+#include <string>
+
+/* twitAtomicFile class
+*
+* Writes a file as a whole. The bytes go to a temporary file next to it,
+* which commit() flushes to disk and moves over the file in one step, so
+* readers and a crash see either the old file or the complete new one,
+* never part of it or none. The old file is never removed first. Without
+* commit() the temporary file is removed and the file left as it was.
+*/
+class twitAtomicFile
+{
+public:
+    explicit twitAtomicFile( const std::string& path /* in */, bool binary = false /* in */ );
+    ~twitAtomicFile();
+
+    std::ostream& stream() { return m_stream; }
+    bool commit( std::string& errorMessage /* out */ );
+
+private:
+    std::string m_path;
+    std::string m_tempPath;
+    std::ofstream m_stream;
+    bool m_committed;
+
+    twitAtomicFile( const twitAtomicFile& );
+    twitAtomicFile& operator=( const twitAtomicFile& );
+};
+
+#endif // _TWITATOMICFILE_H_
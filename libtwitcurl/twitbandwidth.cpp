@@ -0,0 +1,204 @@
+#include <algorithm>
+#include "twitbandwidth.h"
+
+using namespace twitBandwidthDefaults;
+
+/*++
+* @method: twitBandwidth::twitBandwidth
+*
+* @description: constructor
+*
+* @input: bytesPerSec - upload rate, 0 for no limit
+*
+* @output: none
+*
+*--*/
+twitBandwidth::twitBandwidth( unsigned long long bytesPerSec ):
+m_rate( (double)bytesPerSec ),
+m_tokens( 0.0 ),
+m_refilled( std::chrono::steady_clock::now() ),
+m_nextTicket( 0 ),
+m_servedTicket( 0 )
+{
+    for( int i = 0; i < eTwitTrafficMax; ++i )
+    {
+        m_active[i] = 0;
+    }
+}
+
+/*++
+* @method: twitBandwidth::setRate
+*
+* @description: changes the upload rate, also for transfers under way
+*
+* @input: bytesPerSec - upload rate, 0 for no limit
+*
+* @output: none
+*
+*--*/
+void twitBandwidth::setRate( unsigned long long bytesPerSec )
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        refill();
+        m_rate = (double)bytesPerSec;
+        m_tokens = std::min( m_tokens, 0.0 );
+    }
+    m_condition.notify_all();
+}
+
+/*++
+* @method: twitBandwidth::getRate
+*
+* @description: returns the upload rate
+*
+* @input: none
+*
+* @output: bytes per second, 0 if unlimited
+*
+*--*/
+unsigned long long twitBandwidth::getRate()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return (unsigned long long)m_rate;
+}
+
+/*++
+* @method: twitBandwidth::beginTransfer
+*
+* @description: accounts for a request about to be sent
+*
+* @input: trafficClass - kind of the request
+*
+* @output: none
+*
+*--*/
+void twitBandwidth::beginTransfer( eTwitTrafficClass trafficClass )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    refill();
+    ++m_active[trafficClass];
+}
+
+/*++
+* @method: twitBandwidth::endTransfer
+*
+* @description: accounts for a request that completed. bytes sent by an
+*               interactive request are taken from the bulk budget.
+*
+* @input: trafficClass - kind of the request,
+*         bytesSent - bytes the request sent
+*
+* @output: none
+*
+*--*/
+void twitBandwidth::endTransfer( eTwitTrafficClass trafficClass, unsigned long long bytesSent )
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        refill();
+        if( m_active[trafficClass] )
+        {
+            --m_active[trafficClass];
+        }
+        if( ( eTwitTrafficInteractive == trafficClass ) && ( m_rate > 0.0 ) )
+        {
+            m_tokens -= (double)bytesSent;
+        }
+    }
+
+    /* Bulk gets the full rate back */
+    m_condition.notify_all();
+}
+
+/*++
+* @method: twitBandwidth::acquire
+*
+* @description: waits until bytes may be sent and takes them from the
+*               budget. interactive requests are granted everything at
+*               once; bulk gets at most a quantum, after the transfers that
+*               asked before it.
+*
+* @input: trafficClass - kind of the request,
+*         wanted - bytes ready to be sent
+*
+* @output: bytes that may be sent now, at least 1 if wanted is not 0
+*
+*--*/
+size_t twitBandwidth::acquire( eTwitTrafficClass trafficClass, size_t wanted )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    if( !wanted || ( m_rate <= 0.0 ) || ( eTwitTrafficInteractive == trafficClass ) )
+    {
+        return wanted;
+    }
+
+    const unsigned long long ticket = m_nextTicket++;
+    for( ;; )
+    {
+        refill();
+        if( m_rate <= 0.0 )
+        {
+            break;
+        }
+        if( ( ticket == m_servedTicket ) && ( m_tokens > 0.0 ) )
+        {
+            wanted = std::min( wanted, TWITBANDWIDTH_QUANTUM );
+            m_tokens -= (double)wanted;
+            break;
+        }
+
+        /* Sleep until the tokens owed are back, or anything changes */
+        double rate = m_active[eTwitTrafficInteractive] ? m_rate * TWITBANDWIDTH_BULK_SHARE : m_rate;
+        double seconds = ( ticket == m_servedTicket ) ? ( 1.0 - m_tokens ) / rate : 0.1;
+        m_condition.wait_for( lock, std::chrono::duration<double>( std::min( seconds, 1.0 ) ) );
+    }
+    ++m_servedTicket;
+    lock.unlock();
+    m_condition.notify_all();
+    return wanted;
+}
+
+/*++
+* @method: twitBandwidth::getActiveCount
+*
+* @description: returns the number of requests of a kind under way
+*
+* @input: trafficClass - kind of the requests
+*
+* @output: request count
+*
+*--*/
+unsigned int twitBandwidth::getActiveCount( eTwitTrafficClass trafficClass )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_active[trafficClass];
+}
+
+/*++
+* @method: twitBandwidth::refill
+*
+* @description: adds the tokens earned since the last refill. called with
+*               the lock held.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitBandwidth::refill()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>( now - m_refilled ).count();
+    m_refilled = now;
+    if( m_rate <= 0.0 )
+    {
+        m_tokens = 0.0;
+        return;
+    }
+    double rate = m_active[eTwitTrafficInteractive] ? m_rate * TWITBANDWIDTH_BULK_SHARE : m_rate;
+    double burst = std::max( m_rate * TWITBANDWIDTH_BURST_SECS, (double)TWITBANDWIDTH_QUANTUM );
+    m_tokens = std::min( m_tokens + rate * seconds, burst );
+}
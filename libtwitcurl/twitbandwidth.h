@@ -0,0 +1,68 @@
+#ifndef _TWITBANDWIDTH_H_
+#define _TWITBANDWIDTH_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+/* Kinds of traffic sharing a twitBandwidth */
+enum eTwitTrafficClass
+{
+    eTwitTrafficInteractive = 0,    /* API requests, small and latency sensitive */
+    eTwitTrafficBulk,               /* media bytes */
+    eTwitTrafficMax
+};
+
+namespace twitBandwidthDefaults
+{
+    const size_t TWITBANDWIDTH_QUANTUM = 16 * 1024;     /* most bytes granted at once */
+    const double TWITBANDWIDTH_BURST_SECS = 0.25;       /* unused budget kept for a burst */
+    const double TWITBANDWIDTH_BULK_SHARE = 0.25;       /* of the rate left to bulk while API requests run */
+};
+
+/* twitBandwidth class
+*
+* Upload budget shared by every twitCurl object set to use it, e.g. all
+* connections of a process, so that media uploads as a whole stay under a
+* rate instead of saturating the uplink.
+*
+* Bulk bytes are drawn from a token bucket by cURL's read callback, a
+* quantum at a time and first come first served, so concurrent uploads
+* split the rate evenly and take over the share of a transfer that ends.
+* Interactive requests are never held back; while one is in flight, bulk
+* is refilled at only a fraction of the rate, and the bytes it sent are
+* paid back by bulk afterwards. Small API calls therefore keep their
+* latency next to a large upload. A rate of 0 lets everything through.
+*/
+class twitBandwidth
+{
+public:
+    explicit twitBandwidth( unsigned long long bytesPerSec = 0 /* in */ );
+
+    void setRate( unsigned long long bytesPerSec /* in */ );
+    unsigned long long getRate();
+
+    void beginTransfer( eTwitTrafficClass trafficClass /* in */ );
+    void endTransfer( eTwitTrafficClass trafficClass /* in */, unsigned long long bytesSent /* in */ );
+    size_t acquire( eTwitTrafficClass trafficClass /* in */, size_t wanted /* in */ );
+
+    unsigned int getActiveCount( eTwitTrafficClass trafficClass /* in */ );
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    double m_rate;                  /* bytes per second, 0 if unlimited */
+    double m_tokens;                /* bytes bulk may send, negative while in debt */
+    std::chrono::steady_clock::time_point m_refilled;
+    unsigned int m_active[eTwitTrafficMax];
+    unsigned long long m_nextTicket;
+    unsigned long long m_servedTicket;
+
+    void refill();
+
+    twitBandwidth( const twitBandwidth& );
+    twitBandwidth& operator=( const twitBandwidth& );
+};
+
+#endif // _TWITBANDWIDTH_H_
@@ -0,0 +1,218 @@
+#include "twitbatch.h"
+
+/*++
+* @method: twitTweetBatch::twitTweetBatch
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitTweetBatch::twitTweetBatch()
+{
+    m_textOffsets.push_back( 0 );
+}
+
+/*++
+* @method: twitTweetBatch::clear
+*
+* @description: removes all tweets, keeping the allocated capacity
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitTweetBatch::clear()
+{
+    m_ids.clear();
+    m_createdAt.clear();
+    m_userIds.clear();
+    m_retweetCounts.clear();
+    m_favoriteCounts.clear();
+    m_textOffsets.resize( 1 );
+    m_textBlob.clear();
+}
+
+/*++
+* @method: twitTweetBatch::reserve
+*
+* @description: reserves room in every column
+*
+* @input: tweetCount - expected number of tweets,
+*         textBytes - expected total text size
+*
+* @output: none
+*
+*--*/
+void twitTweetBatch::reserve( size_t tweetCount, size_t textBytes )
+{
+    m_ids.reserve( tweetCount );
+    m_createdAt.reserve( tweetCount );
+    m_userIds.reserve( tweetCount );
+    m_retweetCounts.reserve( tweetCount );
+    m_favoriteCounts.reserve( tweetCount );
+    m_textOffsets.reserve( tweetCount + 1 );
+    if( textBytes > m_textBlob.capacity() )
+    {
+        m_textBlob.reserve( textBytes );
+    }
+}
+
+/*++
+* @method: twitTweetBatch::append
+*
+* @description: appends a parsed tweet
+*
+* @input: tweet - parsed tweet
+*
+* @output: none
+*
+*--*/
+void twitTweetBatch::append( const twitTweet& tweet )
+{
+    m_ids.push_back( tweet.id );
+    m_createdAt.push_back( tweet.createdAt );
+    m_userIds.push_back( tweet.userId );
+    m_retweetCounts.push_back( tweet.retweetCount );
+    m_favoriteCounts.push_back( tweet.favoriteCount );
+    appendText( tweet.text.data(), tweet.text.size() );
+}
+
+/*++
+* @method: twitTweetBatch::append
+*
+* @description: appends a row, typically one read from another batch
+*
+* @input: row - tweet row
+*
+* @output: none
+*
+*--*/
+void twitTweetBatch::append( const twitTweetRow& row )
+{
+    m_ids.push_back( row.id );
+    m_createdAt.push_back( row.createdAt );
+    m_userIds.push_back( row.userId );
+    m_retweetCounts.push_back( row.retweetCount );
+    m_favoriteCounts.push_back( row.favoriteCount );
+    appendText( row.text, row.textLength );
+}
+
+/*++
+* @method: twitTweetBatch::appendJson
+*
+* @description: appends tweets of a timeline or search response straight
+*               into the columns, without building twitTweet objects
+*
+* @input: json - timeline (array) or search (object with "statuses") response
+*
+* @output: number of tweets appended
+*
+*--*/
+size_t twitTweetBatch::appendJson( const picojson::value& json )
+{
+    const picojson::value* arrValue = &json;
+    if( json.is<picojson::object>() && json.contains( "statuses" ) )
+    {
+        arrValue = &json.get( "statuses" );
+    }
+    if( !arrValue->is<picojson::array>() )
+    {
+        return 0;
+    }
+
+    const picojson::array& arr = arrValue->get<picojson::array>();
+    size_t before = size();
+    if( !before )
+    {
+        /* Later pages rely on the columns growing geometrically */
+        reserve( arr.size() );
+    }
+    for( size_t i = 0; i < arr.size(); ++i )
+    {
+        const picojson::value& tweet = arr[i];
+        unsigned long long id = tweet.is<picojson::object>() ? twitGetJsonId( tweet, "id" ) : 0;
+        if( !id )
+        {
+            continue;
+        }
+
+        unsigned long long createdAt = 0;
+        if( tweet.contains( "created_at" ) && tweet.get( "created_at" ).is<std::string>() )
+        {
+            createdAt = twitParseCreatedAt( tweet.get( "created_at" ).get<std::string>() );
+        }
+        unsigned long long userId = 0;
+        if( tweet.contains( "user" ) )
+        {
+            userId = twitGetJsonId( tweet.get( "user" ), "id" );
+        }
+
+        m_ids.push_back( id );
+        m_createdAt.push_back( createdAt );
+        m_userIds.push_back( userId );
+        m_retweetCounts.push_back( twitGetJsonCount( tweet, "retweet_count" ) );
+        m_favoriteCounts.push_back( twitGetJsonCount( tweet, "favorite_count" ) );
+
+        const char* textKey = tweet.contains( "full_text" ) ? "full_text" : "text";
+        if( tweet.contains( textKey ) && tweet.get( textKey ).is<std::string>() )
+        {
+            const std::string& text = tweet.get( textKey ).get<std::string>();
+            appendText( text.data(), text.size() );
+        }
+        else
+        {
+            appendText( NULL, 0 );
+        }
+    }
+    return size() - before;
+}
+
+/*++
+* @method: twitTweetBatch::getRow
+*
+* @description: returns a row view of one tweet
+*
+* @input: index - tweet index, less than size()
+*
+* @output: row view, valid until the batch is modified
+*
+*--*/
+twitTweetRow twitTweetBatch::getRow( size_t index ) const
+{
+    twitTweetRow row;
+    row.id = m_ids[index];
+    row.createdAt = m_createdAt[index];
+    row.userId = m_userIds[index];
+    row.retweetCount = m_retweetCounts[index];
+    row.favoriteCount = m_favoriteCounts[index];
+    row.text = m_textBlob.data() + m_textOffsets[index];
+    row.textLength = (size_t)( m_textOffsets[index + 1] - m_textOffsets[index] );
+    return row;
+}
+
+/*++
+* @method: twitTweetBatch::appendText
+*
+* @description: appends a text to the blob and records its end offset. this
+*               is an internal method.
+*
+* @input: text - tweet text,
+*         textLength - text size in bytes
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitTweetBatch::appendText( const char* text, size_t textLength )
+{
+    if( text && textLength )
+    {
+        m_textBlob.append( text, textLength );
+    }
+    m_textOffsets.push_back( m_textBlob.size() );
+}
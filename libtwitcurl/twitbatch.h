@@ -0,0 +1,121 @@
+#ifndef _TWITBATCH_H_
+#define _TWITBATCH_H_
+
+#include <string>
+#include <vector>
+#include <iterator>
+#include <picojson/picojson.h>
+#include "twitmodel.h"
+
+/* Row view of one tweet in a twitTweetBatch. text points into the batch. */
+struct twitTweetRow
+{
+    unsigned long long id;
+    unsigned long long createdAt;
+    unsigned long long userId;
+    unsigned int retweetCount;
+    unsigned int favoriteCount;
+    const char* text;
+    size_t textLength;
+
+    std::string getText() const { return std::string( text, textLength ); }
+};
+
+/* twitTweetBatch class
+*
+* Struct-of-arrays store for the tweet fields analytics jobs aggregate on.
+* Each field lives in its own contiguous array, and the texts are packed
+* back to back in one blob, with tweet i spanning
+* [getTextOffsets()[i], getTextOffsets()[i+1]).
+*/
+class twitTweetBatch
+{
+public:
+    class const_iterator
+    {
+    public:
+        /* Rows are built on access, so it-> holds one until the expression ends */
+        class pointer_proxy
+        {
+        public:
+            explicit pointer_proxy( const twitTweetRow& row ) : m_row( row ) {}
+            const twitTweetRow* operator->() const { return &m_row; }
+
+        private:
+            twitTweetRow m_row;
+        };
+
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef twitTweetRow value_type;
+        typedef long difference_type;
+        typedef pointer_proxy pointer;
+        typedef twitTweetRow reference;
+
+        const_iterator() : m_batch( NULL ), m_index( 0 ) {}
+        const_iterator( const twitTweetBatch* batch, size_t index ) : m_batch( batch ), m_index( index ) {}
+
+        twitTweetRow operator*() const { return m_batch->getRow( m_index ); }
+        pointer_proxy operator->() const { return pointer_proxy( m_batch->getRow( m_index ) ); }
+        twitTweetRow operator[]( long n ) const { return m_batch->getRow( m_index + n ); }
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++( int ) { const_iterator tmp( *this ); ++m_index; return tmp; }
+        const_iterator& operator--() { --m_index; return *this; }
+        const_iterator operator--( int ) { const_iterator tmp( *this ); --m_index; return tmp; }
+        const_iterator& operator+=( long n ) { m_index += n; return *this; }
+        const_iterator& operator-=( long n ) { m_index -= n; return *this; }
+        const_iterator operator+( long n ) const { return const_iterator( m_batch, m_index + n ); }
+        const_iterator operator-( long n ) const { return const_iterator( m_batch, m_index - n ); }
+        long operator-( const const_iterator& rhs ) const { return (long)m_index - (long)rhs.m_index; }
+        bool operator==( const const_iterator& rhs ) const { return m_index == rhs.m_index; }
+        bool operator!=( const const_iterator& rhs ) const { return m_index != rhs.m_index; }
+        bool operator<( const const_iterator& rhs ) const { return m_index < rhs.m_index; }
+        bool operator>( const const_iterator& rhs ) const { return m_index > rhs.m_index; }
+        bool operator<=( const const_iterator& rhs ) const { return m_index <= rhs.m_index; }
+        bool operator>=( const const_iterator& rhs ) const { return m_index >= rhs.m_index; }
+        friend const_iterator operator+( long n, const const_iterator& it ) { return it + n; }
+
+    private:
+        const twitTweetBatch* m_batch;
+        size_t m_index;
+    };
+
+    twitTweetBatch();
+
+    void clear();
+    void reserve( size_t tweetCount /* in */, size_t textBytes = 0 /* in */ );
+    size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+
+    /* Filling the batch */
+    void append( const twitTweet& tweet /* in */ );
+    void append( const twitTweetRow& row /* in */ );
+    size_t appendJson( const picojson::value& json /* in */ );
+
+    /* Column access */
+    const unsigned long long* getIds() const { return m_ids.empty() ? NULL : &m_ids[0]; }
+    const unsigned long long* getCreatedAt() const { return m_createdAt.empty() ? NULL : &m_createdAt[0]; }
+    const unsigned long long* getUserIds() const { return m_userIds.empty() ? NULL : &m_userIds[0]; }
+    const unsigned int* getRetweetCounts() const { return m_retweetCounts.empty() ? NULL : &m_retweetCounts[0]; }
+    const unsigned int* getFavoriteCounts() const { return m_favoriteCounts.empty() ? NULL : &m_favoriteCounts[0]; }
+    const unsigned long long* getTextOffsets() const { return &m_textOffsets[0]; }
+    const char* getTextBlob() const { return m_textBlob.data(); }
+    size_t getTextBlobSize() const { return m_textBlob.size(); }
+
+    /* Row access */
+    twitTweetRow getRow( size_t index /* in */ ) const;
+    const_iterator begin() const { return const_iterator( this, 0 ); }
+    const_iterator end() const { return const_iterator( this, size() ); }
+
+private:
+    std::vector<unsigned long long> m_ids;
+    std::vector<unsigned long long> m_createdAt;
+    std::vector<unsigned long long> m_userIds;
+    std::vector<unsigned int> m_retweetCounts;
+    std::vector<unsigned int> m_favoriteCounts;
+    std::vector<unsigned long long> m_textOffsets;
+    std::string m_textBlob;
+
+    void appendText( const char* text, size_t textLength );
+};
+
+#endif // _TWITBATCH_H_
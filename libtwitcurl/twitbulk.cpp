@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <picojson/picojson.h>
+#include "twitcurlurls.h"
+#include "twitbulk.h"
+
+namespace
+{
+    /* State shared by the lookup workers */
+    struct twitBulkLookupJob
+    {
+        const std::vector<std::string>* inputs;     /* unique inputs */
+        bool isUserId;
+        size_t batchCount;
+        twitRateBudget* budget;
+        twitInternPool* pool;
+        const std::unordered_map<std::string, size_t>* slots;
+
+        std::vector<twitUser> users;                /* one per unique input */
+        std::vector<char> found;
+        std::atomic<size_t> nextBatch;
+        std::atomic<bool> failed;
+        std::mutex errorMutex;
+        std::string errorMessage;
+    };
+
+    /* Key an input or a returned user is matched by */
+    std::string lookupKey( const std::string& userInfo, const bool isUserId )
+    {
+        if( isUserId )
+        {
+            return std::to_string( twitParseId( userInfo ) );
+        }
+        std::string key( userInfo );
+        std::transform( key.begin(), key.end(), key.begin(), ::tolower );
+        return key;
+    }
+
+    void failJob( twitBulkLookupJob& job, const std::string& errorMessage )
+    {
+        std::unique_lock<std::mutex> lock( job.errorMutex );
+        if( !job.failed )
+        {
+            job.errorMessage = errorMessage;
+            job.failed = true;
+        }
+    }
+
+    /* Looks up one batch, returns false if the job should stop */
+    bool lookupBatch( twitBulkLookupJob& job, twitCurl& twitObj, const std::vector<std::string>& batch )
+    {
+        std::string response;
+        for( int attempt = 0; attempt < twitBulkDefaults::TWITBULK_MAX_ATTEMPTS; ++attempt )
+        {
+            if( !job.budget->acquire( twitRateResources::TWITRATE_USERS_LOOKUP, &job.failed ) )
+            {
+                return false;
+            }
+            if( !twitObj.userLookup( batch, job.isUserId ) )
+            {
+                twitObj.getLastCurlError( response );
+                failJob( job, response );
+                return false;
+            }
+            if( !job.budget->recordResponse( twitRateResources::TWITRATE_USERS_LOOKUP, twitObj ) )
+            {
+                continue;
+            }
+
+            twitObj.takeLastWebResponse( response );
+            long httpStatus = twitObj.getLastHttpStatus();
+            if( 404 == httpStatus )
+            {
+                /* None of the batch exists */
+                return true;
+            }
+            if( 200 != httpStatus )
+            {
+                failJob( job, response );
+                return false;
+            }
+
+            picojson::value json;
+            std::string parseError = picojson::parse( json, response );
+            if( parseError.length() )
+            {
+                failJob( job, parseError );
+                return false;
+            }
+            std::vector<twitUser> users;
+            twitParseUsers( json, users, *job.pool );
+            for( size_t i = 0; i < users.size(); ++i )
+            {
+                std::string key = job.isUserId ? std::to_string( users[i].id ) :
+                                                 lookupKey( *users[i].screenName, false );
+                std::unordered_map<std::string, size_t>::const_iterator slot = job.slots->find( key );
+                if( slot != job.slots->end() )
+                {
+                    /* Every slot belongs to exactly one batch, no locking needed */
+                    job.users[slot->second] = users[i];
+                    job.found[slot->second] = 1;
+                }
+            }
+            return true;
+        }
+        failJob( job, "rate limited" );
+        return false;
+    }
+
+    void lookupWorker( twitBulkLookupJob& job, twitCurl* twitObj )
+    {
+        std::unique_ptr<twitCurl> twit( twitObj );
+        std::vector<std::string> batch;
+        while( !job.failed )
+        {
+            size_t batchIndex = job.nextBatch++;
+            if( batchIndex >= job.batchCount )
+            {
+                break;
+            }
+            size_t first = batchIndex * twitCurlDefaults::MAX_USERLOOKUP_USER_COUNT;
+            size_t last = std::min( first + twitCurlDefaults::MAX_USERLOOKUP_USER_COUNT, job.inputs->size() );
+            batch.assign( job.inputs->begin() + first, job.inputs->begin() + last );
+            if( !lookupBatch( job, *twit, batch ) )
+            {
+                break;
+            }
+        }
+    }
+}
+
+/*++
+* @method: twitBulkUserLookup
+*
+* @description: looks up the profiles of any number of users, in batches of
+*               up to 100 running concurrently
+*
+* @input: twitObj - authorized twitCurl object, cloned for every worker,
+*         userInfo - screen names or user ids,
+*         isUserId - true if userInfo contains ids,
+*         parallelism - maximum number of batches in flight,
+*         budget - rate budget shared with other users of the same
+*                  credentials, NULL to use a private one,
+*         pool - intern pool of the returned users' strings
+*
+* @output: outResult - users in input order and inputs that were not found,
+*          errorMessage - reason of failure,
+*          true if every batch was looked up
+*
+*--*/
+bool twitBulkUserLookup( twitCurl& twitObj, const std::vector<std::string>& userInfo, const bool isUserId,
+                         twitUserLookupResult& outResult, std::string& errorMessage,
+                         unsigned int parallelism, twitRateBudget* budget, twitInternPool& pool )
+{
+    outResult.users.clear();
+    outResult.inputIndex.clear();
+    outResult.missing.clear();
+    errorMessage = "";
+
+    /* Look up every user once, however often it is asked for */
+    std::unordered_map<std::string, size_t> slots;
+    std::vector<std::string> inputs;
+    std::vector<size_t> inputSlots( userInfo.size() );
+    slots.reserve( userInfo.size() );
+    inputs.reserve( userInfo.size() );
+    for( size_t i = 0; i < userInfo.size(); ++i )
+    {
+        std::pair<std::unordered_map<std::string, size_t>::iterator, bool> inserted =
+            slots.insert( std::make_pair( lookupKey( userInfo[i], isUserId ), inputs.size() ) );
+        if( inserted.second )
+        {
+            inputs.push_back( userInfo[i] );
+        }
+        inputSlots[i] = inserted.first->second;
+    }
+    if( inputs.empty() )
+    {
+        return true;
+    }
+
+    twitRateBudget ownBudget;
+    twitBulkLookupJob job;
+    job.inputs = &inputs;
+    job.isUserId = isUserId;
+    job.batchCount = ( inputs.size() + twitCurlDefaults::MAX_USERLOOKUP_USER_COUNT - 1 ) /
+                     twitCurlDefaults::MAX_USERLOOKUP_USER_COUNT;
+    job.budget = budget ? budget : &ownBudget;
+    job.pool = &pool;
+    job.slots = &slots;
+    job.users.resize( inputs.size() );
+    job.found.resize( inputs.size(), 0 );
+    job.nextBatch = 0;
+    job.failed = false;
+
+    size_t workerCount = std::max( (size_t)1, std::min( (size_t)parallelism, job.batchCount ) );
+    std::vector<std::thread> workers;
+    workers.reserve( workerCount );
+    for( size_t i = 0; i < workerCount; ++i )
+    {
+        workers.push_back( std::thread( lookupWorker, std::ref( job ), twitObj.clone() ) );
+    }
+    for( size_t i = 0; i < workers.size(); ++i )
+    {
+        workers[i].join();
+    }
+    if( job.failed )
+    {
+        errorMessage = job.errorMessage;
+        return false;
+    }
+
+    /* Merge back in input order */
+    outResult.users.reserve( userInfo.size() );
+    outResult.inputIndex.reserve( userInfo.size() );
+    for( size_t i = 0; i < userInfo.size(); ++i )
+    {
+        size_t slot = inputSlots[i];
+        if( job.found[slot] )
+        {
+            outResult.users.push_back( job.users[slot] );
+            outResult.inputIndex.push_back( i );
+        }
+        else
+        {
+            outResult.missing.push_back( userInfo[i] );
+        }
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef _TWITBULK_H_
+#define _TWITBULK_H_
+
+#include <string>
+#include <vector>
+#include "twitcurl.h"
+#include "twitmodel.h"
+#include "twitratelimit.h"
+
+namespace twitBulkDefaults
+{
+    const unsigned int TWITBULK_DEFAULT_PARALLELISM = 4;
+    const int TWITBULK_MAX_ATTEMPTS = 4;
+};
+
+/* Result of a bulk user lookup */
+struct twitUserLookupResult
+{
+    std::vector<twitUser> users;        /* users found, in input order */
+    std::vector<size_t> inputIndex;     /* index in the input of each user */
+    std::vector<std::string> missing;   /* inputs twitter returned no user for,
+                                           i.e. unknown, suspended or deactivated */
+};
+
+/* Looks up any number of users.
+*
+* The input is split into batches of MAX_USERLOOKUP_USER_COUNT, which are
+* looked up concurrently on clones of twitObj, taking calls from the rate
+* budget. Duplicate inputs are looked up once; screen names are matched case
+* insensitively. twitObj itself is left untouched.
+*/
+bool twitBulkUserLookup( twitCurl& twitObj /* in */,
+                         const std::vector<std::string>& userInfo /* in */,
+                         const bool isUserId /* in */,
+                         twitUserLookupResult& outResult /* out */,
+                         std::string& errorMessage /* out */,
+                         unsigned int parallelism = twitBulkDefaults::TWITBULK_DEFAULT_PARALLELISM /* in */,
+                         twitRateBudget* budget = NULL /* in */,
+                         twitInternPool& pool = twitInternPool::global() /* in */ );
+
+#endif // _TWITBULK_H_
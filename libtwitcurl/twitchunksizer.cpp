@@ -0,0 +1,144 @@
+#include <algorithm>
+#include "twitchunksizer.h"
+
+using namespace twitChunkSizerDefaults;
+
+namespace
+{
+    /* Chunk sizes are kept a multiple of this */
+    const size_t TWITCHUNK_GRANULARITY = 16 * 1024;
+
+    /* Share of the target size given up at the worst error rate */
+    const double TWITCHUNK_MAX_ERROR_SHRINK = 0.75;
+}
+
+/*++
+* @method: twitChunkSizer::twitChunkSizer
+*
+* @description: constructor
+*
+* @input: minSize, maxSize - bounds of the chunk size,
+*         initialSize - size of the first chunk
+*
+* @output: none
+*
+*--*/
+twitChunkSizer::twitChunkSizer( size_t minSize, size_t maxSize, size_t initialSize ):
+m_minSize( std::max( minSize, TWITCHUNK_GRANULARITY ) ),
+m_maxSize( std::max( maxSize, m_minSize ) ),
+m_size( 0 ),
+m_throughput( 0.0 ),
+m_errorRate( 0.0 )
+{
+    setSize( (double)initialSize );
+}
+
+/*++
+* @method: twitChunkSizer::getChunkSize
+*
+* @description: returns the size to use for the next chunk
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+size_t twitChunkSizer::getChunkSize()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_size;
+}
+
+/*++
+* @method: twitChunkSizer::recordSuccess
+*
+* @description: accounts for a chunk that went through and resizes towards
+*               the target duration
+*
+* @input: bytes - size of the chunk,
+*         seconds - time the request took
+*
+* @output: none
+*
+*--*/
+void twitChunkSizer::recordSuccess( size_t bytes, double seconds )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    double rate = bytes / std::max( seconds, 0.001 );
+    m_throughput = ( m_throughput > 0.0 ) ? TWITCHUNK_WEIGHT * rate + ( 1.0 - TWITCHUNK_WEIGHT ) * m_throughput : rate;
+    m_errorRate *= 1.0 - TWITCHUNK_WEIGHT;
+
+    double target = m_throughput * TWITCHUNK_TARGET_SECS;
+    target *= 1.0 - std::min( 2.0 * m_errorRate, TWITCHUNK_MAX_ERROR_SHRINK );
+    setSize( std::max( std::min( target, 2.0 * m_size ), 0.5 * m_size ) );
+}
+
+/*++
+* @method: twitChunkSizer::recordFailure
+*
+* @description: accounts for a chunk that failed, halving the size
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitChunkSizer::recordFailure()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_errorRate = TWITCHUNK_WEIGHT + ( 1.0 - TWITCHUNK_WEIGHT ) * m_errorRate;
+    setSize( 0.5 * m_size );
+}
+
+/*++
+* @method: twitChunkSizer::getThroughput
+*
+* @description: returns the measured throughput of one connection
+*
+* @input: none
+*
+* @output: bytes per second, 0 until a chunk went through
+*
+*--*/
+double twitChunkSizer::getThroughput()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_throughput;
+}
+
+/*++
+* @method: twitChunkSizer::getErrorRate
+*
+* @description: returns the moving average of failed chunks
+*
+* @input: none
+*
+* @output: rate between 0 and 1
+*
+*--*/
+double twitChunkSizer::getErrorRate()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_errorRate;
+}
+
+/*++
+* @method: twitChunkSizer::setSize
+*
+* @description: clamps and rounds a new chunk size. called with the lock
+*               held.
+*
+* @input: size - wanted size in bytes
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitChunkSizer::setSize( double size )
+{
+    size = std::min( std::max( size, (double)m_minSize ), (double)m_maxSize );
+    m_size = (size_t)size;
+    m_size -= m_size % TWITCHUNK_GRANULARITY;
+    m_size = std::max( m_size, m_minSize );
+}
@@ -0,0 +1,54 @@
+#ifndef _TWITCHUNKSIZER_H_
+#define _TWITCHUNKSIZER_H_
+
+#include <cstddef>
+#include <mutex>
+
+namespace twitChunkSizerDefaults
+{
+    const size_t TWITCHUNK_MIN_SIZE = 64 * 1024;
+    const size_t TWITCHUNK_MAX_SIZE = 5 * 1024 * 1024;     /* largest APPEND twitter takes */
+    const size_t TWITCHUNK_INITIAL_SIZE = 1024 * 1024;
+    const double TWITCHUNK_TARGET_SECS = 2.0;               /* aimed for duration of one chunk */
+    const double TWITCHUNK_WEIGHT = 0.3;                    /* weight of the latest chunk in the averages */
+};
+
+/* twitChunkSizer class
+*
+* Picks the size of the next chunk of a chunked upload from how the
+* previous ones went. Chunks are sized to take about TWITCHUNK_TARGET_SECS
+* at the measured throughput, so fast links send few large chunks and slow
+* ones small chunks that are cheap to resend. Failures halve the size and
+* raise the error rate, which keeps chunks small on lossy links until
+* chunks go through again. Growth is at most twofold per chunk. Safe to
+* share between the connections of a parallel upload.
+*/
+class twitChunkSizer
+{
+public:
+    twitChunkSizer( size_t minSize = twitChunkSizerDefaults::TWITCHUNK_MIN_SIZE /* in */,
+                    size_t maxSize = twitChunkSizerDefaults::TWITCHUNK_MAX_SIZE /* in */,
+                    size_t initialSize = twitChunkSizerDefaults::TWITCHUNK_INITIAL_SIZE /* in */ );
+
+    size_t getChunkSize();
+    void recordSuccess( size_t bytes /* in */, double seconds /* in */ );
+    void recordFailure();
+
+    double getThroughput();
+    double getErrorRate();
+
+private:
+    std::mutex m_mutex;
+    size_t m_minSize;
+    size_t m_maxSize;
+    size_t m_size;
+    double m_throughput;        /* bytes per second, 0 until measured */
+    double m_errorRate;         /* moving average of failed chunks */
+
+    void setSize( double size );
+
+    twitChunkSizer( const twitChunkSizer& );
+    twitChunkSizer& operator=( const twitChunkSizer& );
+};
+
+#endif // _TWITCHUNKSIZER_H_
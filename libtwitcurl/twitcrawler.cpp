@@ -0,0 +1,537 @@
+#include <algorithm>
+#include <picojson/picojson.h>
+#include "twitcurlurls.h"
+#include "twitcrawler.h"
+
+namespace
+{
+    bool tweetIdLess( const twitTweet& a, const twitTweet& b )
+    {
+        return a.id < b.id;
+    }
+}
+
+/*++
+* @method: twitTimelineCrawler::twitTimelineCrawler
+*
+* @description: constructor
+*
+* @input: callback - receives new tweets,
+*         pool - intern pool of the tweets' strings
+*
+* @output: none
+*
+*--*/
+twitTimelineCrawler::twitTimelineCrawler( const twitCrawlCallback& callback, twitInternPool& pool ):
+m_callback( callback ),
+m_pool( pool ),
+m_seenFilter( NULL ),
+m_stopping( false ),
+m_running( false ),
+m_minIntervalSecs( twitCrawlerDefaults::TWITCRAWLER_MIN_INTERVAL_SECS ),
+m_maxIntervalSecs( twitCrawlerDefaults::TWITCRAWLER_MAX_INTERVAL_SECS )
+{
+}
+
+/*++
+* @method: twitTimelineCrawler::~twitTimelineCrawler
+*
+* @description: destructor, stops the workers
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitTimelineCrawler::~twitTimelineCrawler()
+{
+    stop();
+}
+
+/*++
+* @method: twitTimelineCrawler::addCredential
+*
+* @description: adds a worker polling with the given credentials. every
+*               credential has its own rate window, so each added one raises
+*               the number of polls the crawler can make.
+*
+* @input: twitObj - authorized twitCurl object, it is cloned
+*
+* @output: none
+*
+*--*/
+void twitTimelineCrawler::addCredential( twitCurl& twitObj )
+{
+    std::unique_ptr<twitCrawlWorker> worker( new twitCrawlWorker );
+    worker->twit.reset( twitObj.clone() );
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+    if( m_running )
+    {
+        worker->thread = std::thread( &twitTimelineCrawler::workerLoop, this, worker.get() );
+    }
+    m_workers.push_back( std::move( worker ) );
+}
+
+/*++
+* @method: twitTimelineCrawler::addAccount
+*
+* @description: adds an account to crawl, or moves the watermark of one
+*               already added
+*
+* @input: userId - id of the account,
+*         sinceId - newest tweet id already seen, 0 to start with the
+*                   latest page of the timeline
+*
+* @output: none
+*
+*--*/
+void twitTimelineCrawler::addAccount( unsigned long long userId, unsigned long long sinceId )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::pair<std::unordered_map<unsigned long long, twitCrawlAccount>::iterator, bool> inserted =
+        m_accounts.insert( std::make_pair( userId, twitCrawlAccount() ) );
+    twitCrawlAccount& account = inserted.first->second;
+    account.position.sinceId = sinceId;
+    account.position.gapTop = 0;
+    account.position.gapMaxId = 0;
+    if( inserted.second )
+    {
+        account.tweetsPerSec = -1;
+        account.polled = false;
+        twitCrawlDue due = { twitCrawlClock::now(), userId };
+        m_due.push( due );
+        m_condition.notify_one();
+    }
+}
+
+/*++
+* @method: twitTimelineCrawler::setPollInterval
+*
+* @description: sets the bounds of the time between two polls of an account
+*
+* @input: minSecs - interval of the busiest accounts,
+*         maxSecs - interval of accounts that do not post
+*
+* @output: none
+*
+*--*/
+void twitTimelineCrawler::setPollInterval( unsigned int minSecs, unsigned int maxSecs )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_minIntervalSecs = minSecs;
+    m_maxIntervalSecs = std::max( minSecs, maxSecs );
+}
+
+/*++
+* @method: twitTimelineCrawler::setSeenFilter
+*
+* @description: sets a filter consulted before tweets reach the callback,
+*               e.g. one shared with a home timeline poller. set it before
+*               start().
+*
+* @input: seenFilter - filter, must outlive the crawler; NULL for none
+*
+* @output: none
+*
+*--*/
+void twitTimelineCrawler::setSeenFilter( twitSeenFilter* seenFilter )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_seenFilter = seenFilter;
+}
+
+/*++
+* @method: twitTimelineCrawler::start
+*
+* @description: starts one worker thread per credential
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if started
+*
+*--*/
+bool twitTimelineCrawler::start( std::string& errorMessage )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    if( m_running )
+    {
+        return true;
+    }
+    if( m_workers.empty() )
+    {
+        errorMessage = "no credentials added";
+        return false;
+    }
+    m_stopping = false;
+    m_running = true;
+    for( size_t i = 0; i < m_workers.size(); ++i )
+    {
+        m_workers[i]->thread = std::thread( &twitTimelineCrawler::workerLoop, this, m_workers[i].get() );
+    }
+    return true;
+}
+
+/*++
+* @method: twitTimelineCrawler::stop
+*
+* @description: stops the workers, waiting for polls in progress. the crawl
+*               can be resumed with start().
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitTimelineCrawler::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if( !m_running )
+        {
+            return;
+        }
+        m_stopping = true;
+        m_running = false;
+    }
+    m_condition.notify_all();
+    for( size_t i = 0; i < m_workers.size(); ++i )
+    {
+        if( m_workers[i]->thread.joinable() )
+        {
+            m_workers[i]->thread.join();
+        }
+    }
+}
+
+/*++
+* @method: twitTimelineCrawler::getWatermark
+*
+* @description: returns the newest tweet id of an account delivered
+*               without gaps
+*
+* @input: userId - id of the account
+*
+* @output: watermark, 0 if none
+*
+*--*/
+unsigned long long twitTimelineCrawler::getWatermark( unsigned long long userId )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::unordered_map<unsigned long long, twitCrawlAccount>::iterator it = m_accounts.find( userId );
+    return ( it == m_accounts.end() ) ? 0 : it->second.position.sinceId;
+}
+
+/*++
+* @method: twitTimelineCrawler::getWatermarks
+*
+* @description: returns the watermark of every account, to be passed to
+*               addAccount() when the crawler is restarted
+*
+* @input: none
+*
+* @output: outWatermarks - user id and watermark pairs
+*
+*--*/
+void twitTimelineCrawler::getWatermarks( std::vector<std::pair<unsigned long long, unsigned long long> >& outWatermarks )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    outWatermarks.clear();
+    outWatermarks.reserve( m_accounts.size() );
+    for( std::unordered_map<unsigned long long, twitCrawlAccount>::const_iterator it = m_accounts.begin();
+         it != m_accounts.end(); ++it )
+    {
+        outWatermarks.push_back( std::make_pair( it->first, it->second.position.sinceId ) );
+    }
+}
+
+/*++
+* @method: twitTimelineCrawler::workerLoop
+*
+* @description: thread of a credential, polls due accounts as long as its
+*               rate window allows. this is an internal method.
+*
+* @input: worker - worker of the thread
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitTimelineCrawler::workerLoop( twitCrawlWorker* worker )
+{
+    std::vector<twitTweet> tweets;
+    while( !m_stopping )
+    {
+        /* Wait for a call before taking an account, so that workers with
+           calls left get to the due accounts first */
+        if( !worker->budget.acquire( twitRateResources::TWITRATE_USER_TIMELINE, &m_stopping ) )
+        {
+            break;
+        }
+        unsigned long long userId = 0;
+        twitCrawlPosition position;
+        if( !takeDueAccount( userId, position ) )
+        {
+            break;
+        }
+
+        tweets.clear();
+        bool rateLimited = false;
+        bool ok = crawlAccount( *worker, userId, position, tweets, rateLimited );
+
+        /* The posting rate counts tweets another poller delivered first */
+        size_t newCount = ok ? tweets.size() : 0;
+
+        /* A failed poll is repeated from the same position, so its tweets
+           must not reach the seen filter before they are delivered */
+        if( ok && m_seenFilter )
+        {
+            m_seenFilter->filter( tweets );
+        }
+        if( ok && tweets.size() )
+        {
+            m_callback( userId, tweets );
+        }
+        reschedule( userId, newCount, position, !ok, rateLimited );
+    }
+}
+
+/*++
+* @method: twitTimelineCrawler::takeDueAccount
+*
+* @description: waits until an account is due and takes it off the schedule.
+*               this is an internal method.
+*
+* @input: none
+*
+* @output: userId - id of the account,
+*          position - where it was crawled up to,
+*          false if the crawler is stopping
+*
+* @remarks: internal method
+*
+*--*/
+bool twitTimelineCrawler::takeDueAccount( unsigned long long& userId, twitCrawlPosition& position )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    for( ;; )
+    {
+        if( m_stopping )
+        {
+            return false;
+        }
+        if( m_due.empty() )
+        {
+            m_condition.wait( lock );
+            continue;
+        }
+        twitCrawlDue next = m_due.top();
+        if( next.due > twitCrawlClock::now() )
+        {
+            m_condition.wait_until( lock, next.due );
+            continue;
+        }
+        m_due.pop();
+        userId = next.userId;
+        position = m_accounts[userId].position;
+        return true;
+    }
+}
+
+/*++
+* @method: twitTimelineCrawler::crawlAccount
+*
+* @description: fetches the tweets of an account not delivered yet, paging
+*               back with max_id if more than a page was posted: first down
+*               a gap left by an earlier poll, then from the newest tweet
+*               down to the watermark. after TWITCRAWLER_MAX_PAGES pages
+*               the rest is left as a gap. the first page's call is taken
+*               from the budget by the caller. this is an internal method.
+*
+* @input: worker - worker making the calls,
+*         userId - id of the account,
+*         position - where the account was crawled up to
+*
+* @output: position - where it is crawled up to with outTweets, its gapTop
+*                     set if older tweets are still missing,
+*          outTweets - new tweets, oldest first,
+*          outRateLimited - true if the crawl failed on the rate limit,
+*          true if the pages were fetched; false leaves position as is
+*
+* @remarks: internal method
+*
+*--*/
+bool twitTimelineCrawler::crawlAccount( twitCrawlWorker& worker, unsigned long long userId, twitCrawlPosition& position,
+                                        std::vector<twitTweet>& outTweets, bool& outRateLimited )
+{
+    const std::string& resource = twitRateResources::TWITRATE_USER_TIMELINE;
+    std::string userInfo = std::to_string( userId );
+    std::string response;
+    std::vector<twitTweet> page;
+    twitCrawlPosition next = position;
+    bool askedNew = false;
+
+    for( unsigned int pageIndex = 0; ; ++pageIndex )
+    {
+        if( !next.gapTop )
+        {
+            if( askedNew )
+            {
+                break;
+            }
+            askedNew = true;
+        }
+        if( pageIndex >= twitCrawlerDefaults::TWITCRAWLER_MAX_PAGES )
+        {
+            /* The gap is filled by the next polls */
+            break;
+        }
+        if( pageIndex && !worker.budget.acquire( resource, &m_stopping ) )
+        {
+            return false;
+        }
+
+        /* Newest page above the watermark, or the next page down the gap */
+        std::string sinceIdStr = next.sinceId ? std::to_string( next.sinceId ) : "";
+        std::string maxIdStr = next.gapTop ? std::to_string( next.gapMaxId ) : "";
+        if( !worker.twit->timelineUserGet( true, true, twitCurlDefaults::MAX_TIMELINE_TWEET_COUNT,
+                                           userInfo, true, sinceIdStr, maxIdStr ) )
+        {
+            return false;
+        }
+        if( !worker.budget.recordResponse( resource, *worker.twit ) )
+        {
+            outRateLimited = true;
+            return false;
+        }
+        worker.twit->takeLastWebResponse( response );
+        if( 200 != worker.twit->getLastHttpStatus() )
+        {
+            /* Protected, suspended or deleted account */
+            return false;
+        }
+
+        picojson::value json;
+        if( picojson::parse( json, response ).length() )
+        {
+            return false;
+        }
+        page.clear();
+        twitParseTweets( json, page, m_pool );
+
+        unsigned long long oldest = 0;
+        unsigned long long newest = 0;
+        for( size_t i = 0; i < page.size(); ++i )
+        {
+            unsigned long long id = page[i].id;
+            oldest = ( !oldest || id < oldest ) ? id : oldest;
+            newest = std::max( newest, id );
+            if( id > next.sinceId && ( !next.gapTop || id <= next.gapMaxId ) )
+            {
+                outTweets.push_back( page[i] );
+            }
+        }
+
+        /* A first crawl takes the latest page only, not the whole history */
+        if( page.empty() || oldest <= next.sinceId || !next.sinceId )
+        {
+            /* Reached the watermark, everything up to the gap top is in */
+            next.sinceId = next.gapTop ? next.gapTop : std::max( next.sinceId, newest );
+            next.gapTop = 0;
+            next.gapMaxId = 0;
+        }
+        else
+        {
+            if( next.gapTop && oldest > next.gapMaxId )
+            {
+                /* max_id not honoured */
+                return false;
+            }
+            if( !next.gapTop )
+            {
+                next.gapTop = newest;
+            }
+            next.gapMaxId = oldest - 1;
+        }
+    }
+
+    std::sort( outTweets.begin(), outTweets.end(), tweetIdLess );
+    position = next;
+    return true;
+}
+
+/*++
+* @method: twitTimelineCrawler::reschedule
+*
+* @description: updates an account's position and posting rate after a
+*               poll and puts it back on the schedule. the poll interval aims
+*               at TWITCRAWLER_TWEETS_PER_POLL new tweets per poll; an
+*               account with a gap left is due again at once. this is an
+*               internal method.
+*
+* @input: userId - id of the account,
+*         newCount - number of new tweets,
+*         position - where the poll crawled the account up to,
+*         failed - true if the poll failed,
+*         rateLimited - true if it failed on the rate limit
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitTimelineCrawler::reschedule( unsigned long long userId, size_t newCount, const twitCrawlPosition& position,
+                                      bool failed, bool rateLimited )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    twitCrawlAccount& account = m_accounts[userId];
+    twitCrawlClock::time_point now = twitCrawlClock::now();
+
+    if( !failed )
+    {
+        account.position = position;
+        if( account.polled )
+        {
+            /* The first poll returns a backlog, not a rate */
+            double elapsed = std::chrono::duration<double>( now - account.lastPoll ).count();
+            double sample = ( elapsed > 0 ) ? newCount / elapsed : 0;
+            account.tweetsPerSec = ( account.tweetsPerSec < 0 ) ? sample :
+                                   twitCrawlerDefaults::TWITCRAWLER_RATE_WEIGHT * sample +
+                                   ( 1 - twitCrawlerDefaults::TWITCRAWLER_RATE_WEIGHT ) * account.tweetsPerSec;
+        }
+        account.polled = true;
+        account.lastPoll = now;
+    }
+
+    double intervalSecs;
+    if( rateLimited || ( !failed && account.position.gapTop ) )
+    {
+        /* Try again as soon as some worker has calls left */
+        intervalSecs = 0;
+    }
+    else if( failed )
+    {
+        intervalSecs = m_maxIntervalSecs;
+    }
+    else if( account.tweetsPerSec < 0 )
+    {
+        /* Rate unknown, take a second sample soon */
+        intervalSecs = m_minIntervalSecs;
+    }
+    else if( 0 == account.tweetsPerSec )
+    {
+        intervalSecs = m_maxIntervalSecs;
+    }
+    else
+    {
+        intervalSecs = twitCrawlerDefaults::TWITCRAWLER_TWEETS_PER_POLL / account.tweetsPerSec;
+        intervalSecs = std::min( std::max( intervalSecs, (double)m_minIntervalSecs ), (double)m_maxIntervalSecs );
+    }
+
+    twitCrawlDue due = { now + std::chrono::duration_cast<twitCrawlClock::duration>( std::chrono::duration<double>( intervalSecs ) ),
+                         userId };
+    m_due.push( due );
+    m_condition.notify_one();
+}
@@ -0,0 +1,124 @@
+#ifndef _TWITCRAWLER_H_
+#define _TWITCRAWLER_H_
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "twitcurl.h"
+#include "twitmodel.h"
+#include "twitratelimit.h"
+#include "twitseenfilter.h"
+
+namespace twitCrawlerDefaults
+{
+    const unsigned int TWITCRAWLER_MIN_INTERVAL_SECS = 60;
+    const unsigned int TWITCRAWLER_MAX_INTERVAL_SECS = 6 * 60 * 60;
+    const unsigned int TWITCRAWLER_TWEETS_PER_POLL = 20;    /* aimed for, keeps polls to one page */
+    const unsigned int TWITCRAWLER_MAX_PAGES = 16;          /* user_timeline serves 3200 tweets */
+    const double TWITCRAWLER_RATE_WEIGHT = 0.3;             /* weight of the latest poll in the rate */
+};
+
+/* Receives the new tweets of one account, oldest first. Called from the
+   crawler's worker threads, possibly for several accounts at once. */
+typedef std::function<void( unsigned long long userId, std::vector<twitTweet>& tweets )> twitCrawlCallback;
+
+/* twitTimelineCrawler class
+*
+* Polls the user timelines of many accounts. Each credential added gets a
+* worker thread with its own rate budget, and workers take the account that
+* is due soonest. How soon an account is due again follows its posting
+* rate, a moving average over past polls, so busy accounts are polled often
+* and quiet ones rarely. Only tweets newer than the account's watermark are
+* fetched. A poll fetches at most TWITCRAWLER_MAX_PAGES pages; when more
+* were posted, the tweets older than the last page are a gap that the next
+* polls fill before the watermark moves past it.
+*/
+class twitTimelineCrawler
+{
+public:
+    twitTimelineCrawler( const twitCrawlCallback& callback /* in */,
+                         twitInternPool& pool = twitInternPool::global() /* in */ );
+    ~twitTimelineCrawler();
+
+    void addCredential( twitCurl& twitObj /* in */ );
+    void addAccount( unsigned long long userId /* in */, unsigned long long sinceId = 0 /* in */ );
+    void setPollInterval( unsigned int minSecs /* in */, unsigned int maxSecs /* in */ );
+    void setSeenFilter( twitSeenFilter* seenFilter /* in */ );
+
+    bool start( std::string& errorMessage /* out */ );
+    void stop();
+
+    unsigned long long getWatermark( unsigned long long userId /* in */ );
+    void getWatermarks( std::vector<std::pair<unsigned long long, unsigned long long> >& outWatermarks /* out */ );
+
+private:
+    typedef std::chrono::steady_clock twitCrawlClock;
+
+    /* Where an account was crawled up to. While gapTop is set, ids in
+       ( sinceId, gapMaxId ] are still missing and ids in ( gapMaxId, gapTop ]
+       are delivered. */
+    struct twitCrawlPosition
+    {
+        unsigned long long sinceId;
+        unsigned long long gapTop;
+        unsigned long long gapMaxId;
+    };
+
+    struct twitCrawlAccount
+    {
+        twitCrawlPosition position;
+        double tweetsPerSec;                /* -1 until polled twice */
+        twitCrawlClock::time_point lastPoll;
+        bool polled;
+    };
+
+    /* Heap entry, earliest due first */
+    struct twitCrawlDue
+    {
+        twitCrawlClock::time_point due;
+        unsigned long long userId;
+
+        bool operator<( const twitCrawlDue& other ) const { return due > other.due; }
+    };
+
+    struct twitCrawlWorker
+    {
+        std::unique_ptr<twitCurl> twit;
+        twitRateBudget budget;
+        std::thread thread;
+    };
+
+    twitCrawlCallback m_callback;
+    twitInternPool& m_pool;
+    twitSeenFilter* m_seenFilter;
+    std::vector<std::unique_ptr<twitCrawlWorker> > m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::unordered_map<unsigned long long, twitCrawlAccount> m_accounts;
+    std::priority_queue<twitCrawlDue> m_due;
+    std::atomic<bool> m_stopping;
+    bool m_running;
+    unsigned int m_minIntervalSecs;
+    unsigned int m_maxIntervalSecs;
+
+    void workerLoop( twitCrawlWorker* worker );
+    bool takeDueAccount( unsigned long long& userId, twitCrawlPosition& position );
+    bool crawlAccount( twitCrawlWorker& worker, unsigned long long userId, twitCrawlPosition& position,
+                       std::vector<twitTweet>& outTweets, bool& outRateLimited );
+    void reschedule( unsigned long long userId, size_t newCount, const twitCrawlPosition& position,
+                     bool failed, bool rateLimited );
+
+    twitTimelineCrawler( const twitTimelineCrawler& );
+    twitTimelineCrawler& operator=( const twitTimelineCrawler& );
+};
+
+#endif // _TWITCRAWLER_H_
@@ -1,11 +1,87 @@
 #define NOMINMAX
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
 #include <memory.h>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <picojson/picojson.h>
 #include "twitcurlurls.h"
 #include "twitcurl.h"
+#include "twithash.h"
 #include "urlencode.h"
 
+namespace
+{
+    /* Reads when an uploaded media id expires from an upload response */
+    time_t parseMediaExpiry( const picojson::value& json )
+    {
+        long expiresAfter = twitUploadSessionDefaults::TWITUPLOAD_DEFAULT_EXPIRY_SECS;
+        if( json.is<picojson::object>() && json.contains( "expires_after_secs" ) && json.get( "expires_after_secs" ).is<double>() )
+        {
+            expiresAfter = (long)json.get( "expires_after_secs" ).get<double>();
+        }
+        return time( NULL ) + expiresAfter;
+    }
+
+    /* Reads processing_info of a FINALIZE or STATUS response */
+    void parseMediaProcessing( const picojson::value& json, twitMediaProcessing& outProcessing )
+    {
+        outProcessing.state = twitCurlTypes::eTwitCurlMediaStateNone;
+        outProcessing.checkAfterSecs = 0;
+        outProcessing.progressPercent = -1;
+        outProcessing.errorMessage.clear();
+        if( !json.is<picojson::object>() || !json.contains( "processing_info" ) )
+        {
+            return;
+        }
+
+        const picojson::value& info = json.get( "processing_info" );
+        if( !info.is<picojson::object>() )
+        {
+            return;
+        }
+        const std::string state = info.contains( "state" ) && info.get( "state" ).is<std::string>() ?
+                                  info.get( "state" ).get<std::string>() : "";
+        if( "pending" == state )
+        {
+            outProcessing.state = twitCurlTypes::eTwitCurlMediaStatePending;
+        }
+        else if( "in_progress" == state )
+        {
+            outProcessing.state = twitCurlTypes::eTwitCurlMediaStateInProgress;
+        }
+        else if( "succeeded" == state )
+        {
+            outProcessing.state = twitCurlTypes::eTwitCurlMediaStateSucceeded;
+        }
+        else
+        {
+            outProcessing.state = twitCurlTypes::eTwitCurlMediaStateFailed;
+        }
+        if( info.contains( "check_after_secs" ) && info.get( "check_after_secs" ).is<double>() )
+        {
+            outProcessing.checkAfterSecs = (int)info.get( "check_after_secs" ).get<double>();
+        }
+        if( info.contains( "progress_percent" ) && info.get( "progress_percent" ).is<double>() )
+        {
+            outProcessing.progressPercent = (int)info.get( "progress_percent" ).get<double>();
+        }
+        if( info.contains( "error" ) && info.get( "error" ).is<picojson::object>() && info.get( "error" ).contains( "message" ) )
+        {
+            outProcessing.errorMessage = info.get( "error" ).get( "message" ).to_str();
+        }
+        else if( twitCurlTypes::eTwitCurlMediaStateFailed == outProcessing.state )
+        {
+            outProcessing.errorMessage = "media processing failed";
+        }
+    }
+}
+
 /*++
 * @method: twitCurl::twitCurl
 *
@@ -22,8 +98,18 @@ m_curlProxyParamsSet( false ),
 m_curlLoginParamsSet( false ),
 m_curlCallbackParamsSet( false ),
 m_eApiFormatType( twitCurlTypes::eTwitCurlApiFormatJson ),
-m_eProtocolType( twitCurlTypes::eTwitCurlProtocolHttps )
-{
+m_eProtocolType( twitCurlTypes::eTwitCurlProtocolHttps ),
+m_uploadParallelism( 1 ),
+m_chunkedUpload( false ),
+m_chunkSizer( std::make_shared<twitChunkSizer>() ),
+m_lastMediaExpiresAt( 0 ),
+m_cancelFlag( NULL ),
+m_maxSendSpeed( 0 ),
+m_bandwidth( NULL )
+{
+    m_lastMediaProcessing.state = twitCurlTypes::eTwitCurlMediaStateNone;
+    m_lastMediaProcessing.checkAfterSecs = 0;
+    m_lastMediaProcessing.progressPercent = -1;
     /* Alloc memory for cURL error responses */
     m_errorBuffer = (char*)malloc( twitCurlDefaults::TWITCURL_DEFAULT_BUFFSIZE );
 
@@ -92,6 +178,14 @@ twitCurl* twitCurl::clone()
     /* OAuth data */
     cloneObj->m_oAuth = m_oAuth.clone();
 
+    /* Upload settings */
+    cloneObj->m_uploadParallelism = m_uploadParallelism;
+    cloneObj->m_chunkedUpload = m_chunkedUpload;
+    cloneObj->m_chunkSizer = m_chunkSizer;
+    cloneObj->m_cancelFlag = m_cancelFlag;
+    cloneObj->m_maxSendSpeed = m_maxSendSpeed;
+    cloneObj->m_bandwidth = m_bandwidth;
+
     return cloneObj;
 }
 
@@ -337,6 +431,7 @@ void twitCurl::setProxyPassword( const std::string& proxyPassword )
 *
 * @input: searchQuery - search query in string format
 *         resultCount - optional search result count
+*         maxId - optional max id, to get the next page of results
 *
 * @output: true if GET is success, otherwise false. This does not check http
 *          response by twitter. Use getLastWebResponse() for that.
@@ -344,7 +439,7 @@ void twitCurl::setProxyPassword( const std::string& proxyPassword )
 * @note: Only ATOM and JSON format supported.
 *
 *--*/
-bool twitCurl::search( const std::string& searchQuery, const std::string resultCount )
+bool twitCurl::search( const std::string& searchQuery, const std::string resultCount, const std::string maxId )
 {
     /* Prepare URL */
     std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
@@ -360,6 +455,13 @@ bool twitCurl::search( const std::string& searchQuery, const std::string resultC
                     twitCurlDefaults::TWITCURL_COUNT + urlencode( resultCount );
     }
 
+    /* Add max id if paging */
+    if( maxId.size() )
+    {
+        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_AMP +
+                    twitCurlDefaults::TWITCURL_MAXID + maxId;
+    }
+
     /* Perform GET */
     return performGet( buildUrl );
 }
@@ -417,158 +519,631 @@ bool twitCurl::statusUpdate(const twitStatus& stat)
 
 
 
-inline size_t get_stream_size(std::istream &s)
+/*++
+* @method: twitCurl::uploadMedia
+*
+* @description: method to upload media from a stream. one that cannot
+*               seek, e.g. a pipe, is spooled by uploadMediaStream() and
+*               its upload cannot be resumed.
+*
+* @input: is - media bytes,
+*         mtype - media type, mp4 is uploaded in segments,
+*         session - session to resume and record the upload in, or NULL
+*
+* @output: o_media_id - media id to attach to a status,
+*          o_error_message - reason of failure given by twitter,
+*          true if uploaded
+*
+*--*/
+bool twitCurl::uploadMedia( std::istream& is, twitCurlTypes::eTwitCurlMediaType mtype, std::string& o_media_id, std::string& o_error_message,
+                            twitUploadSession* session )
 {
-    size_t ret = 0;
-    s.seekg(0, std::ios::end);
-    ret = s.tellg();
-    s.seekg(0, std::ios::beg);
-    return ret;
+    if( is.tellg() < 0 )
+    {
+        is.clear();
+        return uploadMediaStream( is, mtype, o_media_id, o_error_message );
+    }
+    twitStreamMediaSource source( is );
+    return uploadMedia( source, mtype, o_media_id, o_error_message, session );
 }
 
-
-bool twitCurl::uploadMedia(std::istream& is, twitCurlTypes::eTwitCurlMediaType mtype, std::string& media_id, std::string& error_message)
+/*++
+* @method: twitCurl::uploadMediaStream
+*
+* @description: method to upload media from a stream that cannot seek or
+*               whose length is unknown, e.g. the output of an encoder. the
+*               bytes are spooled to a temporary file as they arrive so that
+*               segments can be retried. INIT has to give twitter the total
+*               length: with an expected size, it is sent at once and every
+*               segment is APPENDed as soon as its bytes arrived, the last
+*               one when the stream ended with that length. without one,
+*               the upload starts once the stream ended and its length is
+*               known.
+*
+* @input: is - media bytes, read once to the end,
+*         mtype - media type,
+*         expectedSize - exact length of the stream, 0 if unknown
+*
+* @output: o_media_id - media id to attach to a status,
+*          o_error_message - reason of failure given by twitter, or why the
+*                            stream could not be read,
+*          true if uploaded
+*
+*--*/
+bool twitCurl::uploadMediaStream( std::istream& is, twitCurlTypes::eTwitCurlMediaType mtype, std::string& o_media_id, std::string& o_error_message,
+                                  unsigned long long expectedSize )
 {
-    std::string url =
-        twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-        twitterDefaults::TWITCURL_MEDIAUPLOAD_URL +
-        twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
+    twitSpoolMediaSource source( expectedSize );
+    std::string spoolError;
+    if( !source.open() )
+    {
+        o_error_message = "cannot create a temporary file to spool the stream to";
+        return false;
+    }
+    if( !expectedSize )
+    {
+        if( !source.fill( is, spoolError ) )
+        {
+            o_error_message = spoolError;
+            return false;
+        }
+        return uploadMedia( source, mtype, o_media_id, o_error_message );
+    }
 
-    std::string oAuthHttpHeader;
-    m_oAuth.getOAuthHeader(eOAuthHttpPost, url, "", oAuthHttpHeader);
+    std::thread reader( [&]() { source.fill( is, spoolError ); } );
+    bool ret = uploadMedia( source, mtype, o_media_id, o_error_message );
 
-    struct curl_slist* pOAuthHeaderList = nullptr;
-    pOAuthHeaderList = curl_slist_append(pOAuthHeaderList, oAuthHttpHeader.c_str());
+    /* An upload that failed early does not wait for the rest of the stream */
+    source.cancel();
+    reader.join();
+    if( !ret && o_error_message.empty() )
+    {
+        o_error_message = spoolError;
+    }
+    return ret;
+}
 
+/*++
+* @method: twitCurl::uploadMedia
+*
+* @description: method to upload media. every request body is read from the
+*               source by cURL while it is sent, so no copy of the media is
+*               made; a mapped file goes from the page cache to the socket.
+*               mp4, and every known type once setChunkedUpload( true ) was
+*               called or when a session is given, goes through
+*               INIT/APPEND/FINALIZE with segments sized by the chunk sizer
+*               and retried on their own. with a session, an upload that
+*               failed or was cut short by a restart goes on from the first
+*               missing segment under the saved media id, as long as twitter
+*               still knows it and the media did not change. video and
+*               animated gif may still be processed by twitter afterwards;
+*               see getLastMediaProcessing().
+*
+* @input: source - media bytes,
+*         mtype - media type,
+*         session - session to resume and record the upload in, loaded
+*                   by the caller; NULL to start from scratch every time
+*
+* @output: o_media_id - media id to attach to a status,
+*          o_error_message - reason of failure given by twitter,
+*          true if uploaded
+*
+*--*/
+bool twitCurl::uploadMedia( twitMediaSource& source, twitCurlTypes::eTwitCurlMediaType mtype, std::string& o_media_id, std::string& o_error_message,
+                            twitUploadSession* session )
+{
+    std::string url = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                      twitterDefaults::TWITCURL_MEDIAUPLOAD_URL +
+                      twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
+
+    const unsigned long long size = source.getSize();
     std::string response;
     picojson::value json;
     bool ret = false;
-    int size = (int)get_stream_size(is);
-    std::string buf;
-
-    // MP4 must be chunked
-    if (mtype == twitCurlTypes::eTwitCurlMediaMP4)
-    {
-        // INIT
+    parseMediaProcessing( json, m_lastMediaProcessing );
+    m_lastMediaExpiresAt = 0;
+
+    /* MP4 must be chunked, other types may be; resuming needs segments */
+    const bool chunked = ( twitCurlTypes::eTwitCurlMediaMP4 == mtype ) ||
+                         ( ( m_chunkedUpload || session ) && ( twitCurlTypes::eTwitCurlMediaUnknown != mtype ) );
+    if( chunked )
+    {
+        /* Without a session from the caller, segments are tracked for this call only */
+        twitUploadSession ownSession;
+        twitUploadSession& upload = session ? *session : ownSession;
+        const unsigned long long fingerprint = session ? twitFingerprintSource( source ) : 0;
+        bool resumed = upload.canResume( mtype, size, fingerprint );
+        struct curl_httppost* post = NULL;
+        struct curl_httppost* last = NULL;
+        for( ;; )
         {
-            prepareStandardParams();
-            char int_to_str[32];
-            sprintf(int_to_str, "%d", size);
-
-            struct curl_httppost* post = nullptr;
-            struct curl_httppost* last = nullptr;
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "command", CURLFORM_COPYCONTENTS, "INIT", CURLFORM_END);
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "media_type", CURLFORM_COPYCONTENTS, "video/mp4", CURLFORM_END);
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "total_bytes", CURLFORM_COPYCONTENTS, int_to_str, CURLFORM_END);
-            curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList);
-            curl_easy_setopt(m_curlHandle, CURLOPT_HTTPPOST, post);
-            ret = curl_easy_perform(m_curlHandle) == CURLE_OK;
-            curl_formfree(post);
-            if (ret)
+            /* INIT, unless the saved media id is used */
+            if( resumed )
             {
-                getLastWebResponse(response);
-                picojson::parse(json, response);
-                if (json.contains("media_id_string")) {
-                    media_id = json.get("media_id_string").get<std::string>();
+                o_media_id = upload.getMediaId();
+                m_lastMediaExpiresAt = upload.getExpiresAt();
+                ret = true;
+            }
+            else
+            {
+                std::string totalBytes = std::to_string( size );
+                post = NULL;
+                last = NULL;
+                curl_formadd( &post, &last, CURLFORM_COPYNAME, "command", CURLFORM_COPYCONTENTS, "INIT", CURLFORM_END );
+                curl_formadd( &post, &last, CURLFORM_COPYNAME, "media_type", CURLFORM_COPYCONTENTS, twitCurlDefaults::TWITCURL_MEDIATYPES[mtype].c_str(), CURLFORM_END );
+                curl_formadd( &post, &last, CURLFORM_COPYNAME, "total_bytes", CURLFORM_COPYCONTENTS, totalBytes.c_str(), CURLFORM_END );
+                if( !twitCurlDefaults::TWITCURL_MEDIACATEGORIES[mtype].empty() )
+                {
+                    curl_formadd( &post, &last, CURLFORM_COPYNAME, "media_category", CURLFORM_COPYCONTENTS, twitCurlDefaults::TWITCURL_MEDIACATEGORIES[mtype].c_str(), CURLFORM_END );
                 }
-                else {
-                    ret = false;
+                ret = performMultiPartPost( url, post );
+                curl_formfree( post );
+                if( ret )
+                {
+                    getLastWebResponse( response );
+                    picojson::parse( json, response );
+                    if( json.is<picojson::object>() && json.contains( "media_id_string" ) )
+                    {
+                        o_media_id = json.get( "media_id_string" ).get<std::string>();
+                        m_lastMediaExpiresAt = parseMediaExpiry( json );
+                        upload.begin( o_media_id, mtype, size, fingerprint, m_lastMediaExpiresAt );
+                    }
+                    else
+                    {
+                        ret = false;
+                    }
                 }
             }
-        }
 
-        // APPEND
-        const int buf_size = 1024 * 1024 * 1;
-        buf.resize(buf_size);
-        long data_size = size;
-        long data_left = data_size;
-        long chunk_size = 1024 * 1024 * 1;
-        int segment = 0;
-        while (ret) {
-            prepareStandardParams();
-
-            long size_send = std::min<long>(data_left, chunk_size);
-            is.read(&buf[0], size_send);
-            char int_to_str[32];
-            sprintf(int_to_str, "%d", segment);
-
-            struct curl_httppost* post = nullptr;
-            struct curl_httppost* last = nullptr;
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "command", CURLFORM_COPYCONTENTS, "APPEND", CURLFORM_END);
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "media_id", CURLFORM_COPYCONTENTS, media_id.c_str(), CURLFORM_END);
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "segment_index", CURLFORM_COPYCONTENTS, int_to_str, CURLFORM_END);
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "media",
-                CURLFORM_BUFFER, "data",
-                CURLFORM_BUFFERPTR, &buf[0],
-                CURLFORM_BUFFERLENGTH, size_send,
-                CURLFORM_END);
-            curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList);
-            curl_easy_setopt(m_curlHandle, CURLOPT_HTTPPOST, post);
-            ret = curl_easy_perform(m_curlHandle) == CURLE_OK;
-            curl_formfree(post);
-
-            data_left -= size_send;
-            segment++;
-            if (data_left == 0) { break; }
+            /* APPEND */
+            long httpStatus = 0;
+            if( ret && !appendMediaSegments( source, upload, response, httpStatus ) )
+            {
+                ret = false;
+                picojson::parse( json, response );
+
+                /* A saved media id twitter no longer takes: start over once */
+                if( resumed && ( 4 == httpStatus / 100 ) && ( 408 != httpStatus ) && ( 429 != httpStatus ) )
+                {
+                    upload.clear();
+                    resumed = false;
+                    continue;
+                }
+            }
+            break;
         }
-    
-        // FINALIZE
-        if (ret) {
-            prepareStandardParams();
-            struct curl_httppost* post = nullptr;
-            struct curl_httppost* last = nullptr;
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "command", CURLFORM_COPYCONTENTS, "FINALIZE", CURLFORM_END);
-            curl_formadd(&post, &last, CURLFORM_COPYNAME, "media_id", CURLFORM_COPYCONTENTS, media_id.c_str(), CURLFORM_END);
-            curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList);
-            curl_easy_setopt(m_curlHandle, CURLOPT_HTTPPOST, post);
-            ret = curl_easy_perform(m_curlHandle) == CURLE_OK;
-            curl_formfree(post);
+
+        /* FINALIZE */
+        if( ret )
+        {
+            post = NULL;
+            last = NULL;
+            curl_formadd( &post, &last, CURLFORM_COPYNAME, "command", CURLFORM_COPYCONTENTS, "FINALIZE", CURLFORM_END );
+            curl_formadd( &post, &last, CURLFORM_COPYNAME, "media_id", CURLFORM_COPYCONTENTS, o_media_id.c_str(), CURLFORM_END );
+            ret = performMultiPartPost( url, post ) && ( 2 == getLastHttpStatus() / 100 );
+            curl_formfree( post );
+            getLastWebResponse( response );
+            picojson::parse( json, response );
+            if( ret )
+            {
+                upload.clear();
+                parseMediaProcessing( json, m_lastMediaProcessing );
+            }
         }
     }
     else
     {
-        buf.resize(size);
-        is.read(&buf[0], size);
-
-        prepareStandardParams();
-        struct curl_httppost* post = nullptr;
-        struct curl_httppost* last = nullptr;
-        curl_formadd(&post, &last, CURLFORM_COPYNAME, "media",
-            CURLFORM_BUFFER, "data",
-            CURLFORM_BUFFERPTR, &buf[0],
-            CURLFORM_BUFFERLENGTH, size,
-            CURLFORM_END);
-        curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList);
-        curl_easy_setopt(m_curlHandle, CURLOPT_HTTPPOST, post);
-        ret = curl_easy_perform(m_curlHandle) == CURLE_OK;
-        if (ret)
+        twitMediaRange range = { &source, 0, 0, size, m_bandwidth };
+        struct curl_httppost* post = NULL;
+        struct curl_httppost* last = NULL;
+        curl_formadd( &post, &last, CURLFORM_COPYNAME, "media", CURLFORM_FILENAME, "data",
+                      CURLFORM_STREAM, &range, CURLFORM_CONTENTSLENGTH, (long)size, CURLFORM_END );
+        ret = source.waitFor( size ) && performMultiPartPost( url, post, eTwitTrafficBulk, &range );
+        curl_formfree( post );
+        if( ret )
         {
-            getLastWebResponse(response);
-            picojson::parse(json, response);
-            if (json.contains("media_id_string")) {
-                media_id = json.get("media_id_string").get<std::string>();
+            getLastWebResponse( response );
+            picojson::parse( json, response );
+            if( json.is<picojson::object>() && json.contains( "media_id_string" ) )
+            {
+                o_media_id = json.get( "media_id_string" ).get<std::string>();
+                m_lastMediaExpiresAt = parseMediaExpiry( json );
             }
-            else {
+            else
+            {
                 ret = false;
             }
         }
-        curl_formfree(post);
     }
 
-    curl_slist_free_all(pOAuthHeaderList);
+    if( !ret && json.is<picojson::object>() && json.contains( "error" ) && json.get( "error" ).is<std::string>() )
+    {
+        o_error_message = json.get( "error" ).get<std::string>();
+    }
+    return ret;
+}
 
-    if (!ret) {
-        if (json.contains("error")) {
-            error_message = json.get("error").get<std::string>();
+/*++
+* @method: twitCurl::mediaStatus
+*
+* @description: method to ask how far twitter got processing an uploaded
+*               media. meant to be called no earlier than checkAfterSecs
+*               after the previous report.
+*
+* @input: mediaId - media id returned by uploadMedia
+*
+* @output: outProcessing - processing state,
+*          true if twitter answered with a state
+*
+*--*/
+bool twitCurl::mediaStatus( const std::string& mediaId, twitMediaProcessing& outProcessing )
+{
+    if( mediaId.empty() )
+    {
+        return false;
+    }
+
+    /* Prepare URL */
+    std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                           twitterDefaults::TWITCURL_MEDIAUPLOAD_URL +
+                           twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] +
+                           twitCurlDefaults::TWITCURL_URL_SEP_QUES + twitCurlDefaults::TWITCURL_MEDIASTATUS +
+                           twitCurlDefaults::TWITCURL_URL_SEP_AMP + twitCurlDefaults::TWITCURL_MEDIAID + mediaId;
+
+    /* Perform GET */
+    if( !performGet( buildUrl ) || ( 2 != getLastHttpStatus() / 100 ) )
+    {
+        return false;
+    }
+    std::string response;
+    picojson::value json;
+    getLastWebResponse( response );
+    if( !picojson::parse( json, response ).empty() || !json.is<picojson::object>() || !json.contains( "processing_info" ) )
+    {
+        return false;
+    }
+    parseMediaProcessing( json, m_lastMediaProcessing );
+    outProcessing = m_lastMediaProcessing;
+    return true;
+}
+
+/*++
+* @method: twitCurl::getLastMediaProcessing
+*
+* @description: method to get the processing state reported for the media
+*               of the last uploadMedia or mediaStatus call
+*
+* @input: none
+*
+* @output: outProcessing - processing state, None if twitter reported none
+*
+*--*/
+void twitCurl::getLastMediaProcessing( twitMediaProcessing& outProcessing )
+{
+    outProcessing = m_lastMediaProcessing;
+}
+
+/*++
+* @method: twitCurl::getLastMediaExpiry
+*
+* @description: method to get when the media id of the last uploadMedia
+*               call expires and can no longer be attached
+*
+* @input: none
+*
+* @output: time the media id expires, 0 if the upload failed
+*
+*--*/
+time_t twitCurl::getLastMediaExpiry()
+{
+    return m_lastMediaExpiresAt;
+}
+
+/*++
+* @method: twitCurl::setCancelFlag
+*
+* @description: method to give a flag that aborts requests of this object
+*               and of its clones, including those already under way, as
+*               soon as it is set. e.g. one flag can stop every upload of a
+*               group once one of them failed. the flag must outlive the
+*               requests.
+*
+* @input: cancel - flag to watch, NULL to stop watching
+*
+* @output: none
+*
+*--*/
+void twitCurl::setCancelFlag( const std::atomic<bool>* cancel )
+{
+    m_cancelFlag = cancel;
+}
+
+/*++
+* @method: twitCurl::setMaxSendSpeed
+*
+* @description: method to cap the upload rate of each request of this
+*               object and of its clones, i.e. of each connection
+*
+* @input: bytesPerSec - upload rate, 0 for no limit
+*
+* @output: none
+*
+*--*/
+void twitCurl::setMaxSendSpeed( unsigned long long bytesPerSec )
+{
+    m_maxSendSpeed = bytesPerSec;
+}
+
+/*++
+* @method: twitCurl::setBandwidth
+*
+* @description: method to make requests of this object and of its clones
+*               share an upload budget, usually with every other twitCurl
+*               object of the process. media bytes are throttled to the
+*               budget; API requests go first.
+*
+* @input: bandwidth - budget to share, NULL for none. it must outlive the
+*                     requests.
+*
+* @output: none
+*
+*--*/
+void twitCurl::setBandwidth( twitBandwidth* bandwidth )
+{
+    m_bandwidth = bandwidth;
+}
+
+/*++
+* @method: twitCurl::setUploadParallelism
+*
+* @description: method to set how many segments of a chunked upload are sent
+*               at once, each over its own connection
+*
+* @input: parallelism - number of connections, 1 to send segments one by one
+*
+* @output: none
+*
+*--*/
+void twitCurl::setUploadParallelism( unsigned int parallelism )
+{
+    m_uploadParallelism = std::max( parallelism, 1u );
+}
+
+/*++
+* @method: twitCurl::getUploadParallelism
+*
+* @description: method to get how many segments of a chunked upload are sent
+*               at once
+*
+* @input: none
+*
+* @output: number of connections
+*
+*--*/
+unsigned int twitCurl::getUploadParallelism()
+{
+    return m_uploadParallelism;
+}
+
+/*++
+* @method: twitCurl::setChunkedUpload
+*
+* @description: method to upload every media type in segments, so that a
+*               failure only resends one segment. mp4 is always chunked.
+*
+* @input: chunked - true to chunk every type
+*
+* @output: none
+*
+*--*/
+void twitCurl::setChunkedUpload( bool chunked )
+{
+    m_chunkedUpload = chunked;
+}
+
+/*++
+* @method: twitCurl::getChunkSizer
+*
+* @description: method to get the sizer of upload segments, shared with the
+*               clones of this object, e.g. to change its bounds or look at
+*               the measured throughput
+*
+* @input: none
+*
+* @output: chunk sizer
+*
+*--*/
+twitChunkSizer& twitCurl::getChunkSizer()
+{
+    return *m_chunkSizer;
+}
+
+/*++
+* @method: twitCurl::appendMediaSegments
+*
+* @description: method to send the APPEND segments of a chunked upload the
+*               session does not have yet. a new segment is sized by the
+*               chunk sizer when it is taken, and every segment is retried
+*               on transport errors and 5xx, 408 and 429 responses: for
+*               429 once the rate limit window reset, else after an
+*               exponential backoff. a segment is sent once the source has
+*               all of its bytes. with
+*               an upload parallelism above 1, workers on clones of this
+*               object take segments in turn, and no new segment is
+*               started once one failed. this is an internal method.
+*
+* @input: source - media bytes,
+*         session - session of the upload, begun or resumed
+*
+* @output: outResponse - response to the failed segment,
+*          outHttpStatus - http status of the failed segment,
+*          true if every segment was accepted
+*
+* @remarks: internal method
+*
+*--*/
+bool twitCurl::appendMediaSegments( twitMediaSource& source, twitUploadSession& session,
+                                    std::string& outResponse, long& outHttpStatus )
+{
+    const std::string mediaId = session.getMediaId();
+    twitChunkSizer& sizer = *m_chunkSizer;
+    std::mutex errorMutex;              /* guards the error */
+    std::atomic<bool> failed( false );
+
+    auto appendSegments = [&]( twitCurl* twitObj )
+    {
+        twitUploadSegment segment;
+        while( !failed && !twitObj->isCancelled() && session.takeSegment( sizer.getChunkSize(), segment ) )
+        {
+            bool ok = false;
+            const bool ready = source.waitFor( segment.end );
+            for( int attempt = 0; ready && !ok && !failed && !twitObj->isCancelled() && attempt < twitCurlDefaults::TWITCURL_MEDIA_SEGMENT_ATTEMPTS; ++attempt )
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                ok = twitObj->appendMediaSegment( source, mediaId, segment.index, segment.offset, segment.end );
+                if( ok )
+                {
+                    sizer.recordSuccess( (size_t)( segment.end - segment.offset ),
+                                         std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+                    break;
+                }
+                if( twitObj->isCancelled() )
+                {
+                    break;
+                }
+                sizer.recordFailure();
+                long httpStatus = twitObj->getLastHttpStatus();
+                if( 4 == httpStatus / 100 && 408 != httpStatus && 429 != httpStatus )
+                {
+                    break;
+                }
+                if( attempt + 1 < twitCurlDefaults::TWITCURL_MEDIA_SEGMENT_ATTEMPTS )
+                {
+                    double delaySecs = twitCurlDefaults::TWITCURL_MEDIA_RETRY_DELAY_SECS * ( 1 << attempt );
+                    twitRateLimit rateLimit;
+                    twitObj->getLastRateLimit( rateLimit );
+                    unsigned long long now = (unsigned long long)time( NULL );
+                    if( ( 429 == httpStatus ) && ( rateLimit.reset > now ) )
+                    {
+                        delaySecs = std::max( delaySecs, (double)( rateLimit.reset - now ) );
+                    }
+                    delaySecs = std::min( delaySecs, twitCurlDefaults::TWITCURL_MEDIA_RETRY_MAX_SECS );
+                    if( !twitObj->waitToRetry( delaySecs, failed ) )
+                    {
+                        break;
+                    }
+                }
+            }
+            session.finishSegment( segment.index, ok );
+            if( !ok )
+            {
+                std::lock_guard<std::mutex> lock( errorMutex );
+                if( !failed )
+                {
+                    outResponse.clear();
+                    outHttpStatus = 0;
+                    if( ready )
+                    {
+                        twitObj->getLastWebResponse( outResponse );
+                        outHttpStatus = twitObj->getLastHttpStatus();
+                    }
+                    failed = true;
+                }
+            }
         }
+    };
+
+    /* Workers beyond the segments a full sized chunking of what is left needs would idle */
+    const unsigned long long left = source.getSize() - session.getBytesDone();
+    size_t maxSegments = (size_t)std::min( (unsigned long long)twitCurlDefaults::MAX_MEDIA_SEGMENT_COUNT,
+                                           ( left + sizer.getChunkSize() - 1 ) / sizer.getChunkSize() );
+    size_t workerCount = std::min( (size_t)m_uploadParallelism, maxSegments );
+    std::vector<std::unique_ptr<twitCurl> > clones;
+    std::vector<std::thread> workers;
+    for( size_t i = 1; i < workerCount; ++i )
+    {
+        clones.push_back( std::unique_ptr<twitCurl>( clone() ) );
+        workers.push_back( std::thread( appendSegments, clones.back().get() ) );
     }
+    appendSegments( this );
+    for( size_t i = 0; i < workers.size(); ++i )
+    {
+        workers[i].join();
+    }
+    return !failed && session.isComplete();
+}
+
+/*++
+* @method: twitCurl::appendMediaSegment
+*
+* @description: method to send one APPEND segment, streamed from its range
+*               of the source. this is an internal method.
+*
+* @input: source - media bytes,
+*         mediaId - media id returned by INIT,
+*         segment - segment index,
+*         offset, end - byte range of the segment
+*
+* @output: true if the segment was accepted
+*
+* @remarks: internal method
+*
+*--*/
+bool twitCurl::appendMediaSegment( twitMediaSource& source, const std::string& mediaId, size_t segment,
+                                   unsigned long long offset, unsigned long long end )
+{
+    std::string url = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                      twitterDefaults::TWITCURL_MEDIAUPLOAD_URL +
+                      twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
+    twitMediaRange range = { &source, offset, offset, end, m_bandwidth };
+    std::string segmentIndex = std::to_string( segment );
+
+    struct curl_httppost* post = NULL;
+    struct curl_httppost* last = NULL;
+    curl_formadd( &post, &last, CURLFORM_COPYNAME, "command", CURLFORM_COPYCONTENTS, "APPEND", CURLFORM_END );
+    curl_formadd( &post, &last, CURLFORM_COPYNAME, "media_id", CURLFORM_COPYCONTENTS, mediaId.c_str(), CURLFORM_END );
+    curl_formadd( &post, &last, CURLFORM_COPYNAME, "segment_index", CURLFORM_COPYCONTENTS, segmentIndex.c_str(), CURLFORM_END );
+    curl_formadd( &post, &last, CURLFORM_COPYNAME, "media", CURLFORM_FILENAME, "data",
+                  CURLFORM_STREAM, &range, CURLFORM_CONTENTSLENGTH, (long)( end - offset ), CURLFORM_END );
+    bool ret = performMultiPartPost( url, post, eTwitTrafficBulk, &range ) && ( 2 == getLastHttpStatus() / 100 );
+    curl_formfree( post );
     return ret;
 }
 
+/*++
+* @method: twitCurl::mediaMetadataCreate
+*
+* @description: method to attach alt text to an uploaded media
+*
+* @input: mediaId - media id returned by uploadMedia,
+*         altText - description of the media
+*
+* @output: true if POST is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::mediaMetadataCreate( const std::string& mediaId, const std::string& altText )
+{
+    if( mediaId.empty() )
+    {
+        return false;
+    }
+
+    /* Prepare JSON body in the reusable send buffer */
+    twitJsonWriter body( m_sendBuffer );
+    body.reset();
+    body.beginObject()
+            .key( "media_id" ).value( mediaId )
+            .key( "alt_text" ).beginObject().key( "text" ).value( altText ).endObject()
+        .endObject();
+
+    /* Perform POST */
+    return performPost( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                        twitterDefaults::TWITCURL_MEDIAMETADATA_URL +
+                        twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType],
+                        m_sendBuffer, twitCurlTypes::eTwitCurlContentJson );
+}
+
 /*++
 * @method: twitCurl::statusShowById
 *
@@ -659,21 +1234,20 @@ bool twitCurl::retweetById( const std::string& statusId )
 *
 * @description: method to get home timeline
 *
-* @input: none
+* @input: sinceId - String specifying since id parameter,
+*         maxId - String specifying max id parameter, to page backwards,
+*         tweetCount - Number of tweets to get. Max 200, 0 for default.
 *
 * @output: true if GET is success, otherwise false. This does not check http
 *          response by twitter. Use getLastWebResponse() for that.
 *
 *--*/
-bool twitCurl::timelineHomeGet( const std::string sinceId )
+bool twitCurl::timelineHomeGet( const std::string sinceId, const std::string maxId, const unsigned int tweetCount )
 {
     std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
                            twitterDefaults::TWITCURL_HOME_TIMELINE_URL +
                            twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
-    if( sinceId.length() )
-    {
-        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_QUES + twitCurlDefaults::TWITCURL_SINCEID + sinceId;
-    }
+    utilAppendTimelineParams( buildUrl, sinceId, maxId, tweetCount );
 
     /* Perform GET */
     return performGet( buildUrl );
@@ -741,21 +1315,20 @@ bool twitCurl::timelineFriendsGet()
 *
 * @description: method to get mentions
 *
-* @input: sinceId - String specifying since id parameter
+* @input: sinceId - String specifying since id parameter,
+*         maxId - String specifying max id parameter, to page backwards,
+*         tweetCount - Number of tweets to get. Max 200, 0 for default.
 *
 * @output: true if GET is success, otherwise false. This does not check http
 *          response by twitter. Use getLastWebResponse() for that.
 *
 *--*/
-bool twitCurl::mentionsGet( const std::string sinceId )
+bool twitCurl::mentionsGet( const std::string sinceId, const std::string maxId, const unsigned int tweetCount )
 {
     std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
                            twitterDefaults::TWITCURL_MENTIONS_URL +
                            twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
-    if( sinceId.length() )
-    {
-        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_QUES + twitCurlDefaults::TWITCURL_SINCEID + sinceId;
-    }
+    utilAppendTimelineParams( buildUrl, sinceId, maxId, tweetCount );
 
     /* Perform GET */
     return performGet( buildUrl );
@@ -764,12 +1337,14 @@ bool twitCurl::mentionsGet( const std::string sinceId )
 /*++
 * @method: twitCurl::timelineUserGet
 *
-* @description: method to get mentions
+* @description: method to get a user's timeline
 *
 * @input: trimUser - Trim user name if true
 *         tweetCount - Number of tweets to get. Max 200.
 *         userInfo - screen name or user id in string format,
-*         isUserId - true if userInfo contains an id
+*         isUserId - true if userInfo contains an id,
+*         sinceId - String specifying since id parameter,
+*         maxId - String specifying max id parameter, to page backwards
 *
 * @output: true if GET is success, otherwise false. This does not check http
 *          response by twitter. Use getLastWebResponse() for that.
@@ -779,7 +1354,9 @@ bool twitCurl::timelineUserGet( const bool trimUser,
                                 const bool includeRetweets,
                                 const unsigned int tweetCount,
                                 const std::string userInfo,
-                                const bool isUserId )
+                                const bool isUserId,
+                                const std::string sinceId,
+                                const std::string maxId )
 {
     /* Prepare URL */
     std::string buildUrl;
@@ -819,6 +1396,16 @@ bool twitCurl::timelineUserGet( const bool trimUser,
         buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_AMP + twitCurlDefaults::TWITCURL_TRIMUSER;
     }
 
+    if( sinceId.length() )
+    {
+        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_AMP + twitCurlDefaults::TWITCURL_SINCEID + sinceId;
+    }
+
+    if( maxId.length() )
+    {
+        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_AMP + twitCurlDefaults::TWITCURL_MAXID + maxId;
+    }
+
     /* Perform GET */
     return performGet( buildUrl );
 }
@@ -828,7 +1415,8 @@ bool twitCurl::timelineUserGet( const bool trimUser,
 *
 * @description: method to get a number of user's profiles
 *
-* @input: userInfo - vector of screen names or user ids
+* @input: userInfo - vector of screen names or user ids, only the first
+*                    100 are looked up; see twitBulkUserLookup for more
 *         isUserId - true if userInfo contains an id
 *
 * @output: true if POST is success, otherwise false. This does not check http
@@ -844,7 +1432,7 @@ bool twitCurl::userLookup( const std::vector<std::string> &userInfo, const bool
 
     std::string userIds = "";
     std::string sep = "";
-    for( unsigned int i = 0 ; i < std::min((size_t)100, userInfo.size()); i++, sep = "," )
+    for( unsigned int i = 0 ; i < std::min( (size_t)twitCurlDefaults::MAX_USERLOOKUP_USER_COUNT, userInfo.size() ); i++, sep = "," )
     {
         userIds += sep + userInfo[i];
     }
@@ -945,22 +1533,20 @@ bool twitCurl::followersGet( const std::string userInfo, const bool isUserId )
 *
 * @description: method to get direct messages
 *
-* @input: since id
+* @input: sinceId - String specifying since id parameter,
+*         maxId - String specifying max id parameter, to page backwards,
+*         messageCount - Number of messages to get. Max 200, 0 for default.
 *
 * @output: true if GET is success, otherwise false. This does not check http
 *          response by twitter. Use getLastWebResponse() for that.
 *
 *--*/
-bool twitCurl::directMessageGet( const std::string sinceId )
+bool twitCurl::directMessageGet( const std::string sinceId, const std::string maxId, const unsigned int messageCount )
 {
     std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
                            twitterDefaults::TWITCURL_DIRECTMESSAGES_URL +
                            twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
-
-    if( sinceId.length() )
-    {
-        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_QUES + twitCurlDefaults::TWITCURL_SINCEID + sinceId;
-    }
+    utilAppendTimelineParams( buildUrl, sinceId, maxId, messageCount );
 
     /* Perform GET */
     return performGet( buildUrl );
@@ -1046,6 +1632,52 @@ bool twitCurl::directMessageDestroyById( const std::string& dMsgId )
     return performDelete( buildUrl );
 }
 
+/*++
+* @method: twitCurl::directMessageEventSend
+*
+* @description: method to send a direct message through the direct message
+*               events API, which takes a JSON body
+*
+* @input: recipientId - user id of the recipient,
+*         dMsg - message text,
+*         mediaId - optional media id of an uploaded attachment
+*
+* @output: true if POST is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::directMessageEventSend( const std::string& recipientId, const std::string& dMsg, const std::string& mediaId )
+{
+    if( recipientId.empty() || dMsg.empty() )
+    {
+        return false;
+    }
+
+    /* Prepare JSON body in the reusable send buffer */
+    twitJsonWriter body( m_sendBuffer );
+    body.reset();
+    body.beginObject().key( "event" ).beginObject()
+            .key( "type" ).value( "message_create" )
+            .key( "message_create" ).beginObject()
+                .key( "target" ).beginObject().key( "recipient_id" ).value( recipientId ).endObject()
+                .key( "message_data" ).beginObject()
+                    .key( "text" ).value( dMsg );
+    if( mediaId.length() )
+    {
+        body.key( "attachment" ).beginObject()
+                .key( "type" ).value( "media" )
+                .key( "media" ).beginObject().key( "id" ).value( mediaId ).endObject()
+            .endObject();
+    }
+    body.endObject().endObject().endObject().endObject();
+
+    /* Perform POST */
+    return performPost( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                        twitterDefaults::TWITCURL_DIRECTMESSAGEEVENTNEW_URL +
+                        twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType],
+                        m_sendBuffer, twitCurlTypes::eTwitCurlContentJson );
+}
+
 /*++
 * @method: twitCurl::friendshipCreate
 *
@@ -1170,9 +1802,10 @@ bool twitCurl::friendsIdsGet( const std::string& nextCursor, const std::string&
                         twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType],
                         userInfo, isUserId );
 
-    if( buildUrl.length() && nextCursor.length() )
+    if( nextCursor.length() )
     {
-        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_AMP +
+        /* Without a user there is no query string to append to yet */
+        buildUrl += ( userInfo.length() ? twitCurlDefaults::TWITCURL_URL_SEP_AMP : twitCurlDefaults::TWITCURL_URL_SEP_QUES ) +
                     twitCurlDefaults::TWITCURL_NEXT_CURSOR +
                     nextCursor;
     }
@@ -1204,9 +1837,10 @@ bool twitCurl::followersIdsGet( const std::string& nextCursor, const std::string
                         twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType],
                         userInfo, isUserId );
 
-    if( buildUrl.length() && nextCursor.length() )
+    if( nextCursor.length() )
     {
-        buildUrl += twitCurlDefaults::TWITCURL_URL_SEP_AMP +
+        /* Without a user there is no query string to append to yet */
+        buildUrl += ( userInfo.length() ? twitCurlDefaults::TWITCURL_URL_SEP_AMP : twitCurlDefaults::TWITCURL_URL_SEP_QUES ) +
                     twitCurlDefaults::TWITCURL_NEXT_CURSOR +
                     nextCursor;
     }
@@ -1515,202 +2149,492 @@ bool twitCurl::savedSearchShow( const std::string& searchId )
 *          response by twitter. Use getLastWebResponse() for that.
 *
 *--*/
-bool twitCurl::savedSearchCreate( const std::string& query )
+bool twitCurl::savedSearchCreate( const std::string& query )
+{
+    /* Prepare URL */
+    std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                           twitterDefaults::TWITCURL_SAVEDSEARCHCREATE_URL +
+                           twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
+
+    /* Send some dummy data in POST */
+    std::string queryStr = twitCurlDefaults::TWITCURL_QUERYSTRING + urlencode( query );
+
+    /* Perform POST */
+    return performPost( buildUrl, queryStr );
+}
+
+
+/*++
+* @method: twitCurl::savedSearchDestroy
+*
+* @description: method to destroy a saved search for the authenticated user. The search specified
+*               by id must be owned by the authenticating user.
+*
+* @input: searchId - search id of item to be deleted
+*
+* @output: true if DELETE is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::savedSearchDestroy( const std::string& searchId )
+{
+    /* Prepare URL */
+    std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                           twitterDefaults::TWITCURL_SAVEDSEARCHDESTROY_URL + searchId +
+                           twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
+
+    /* Perform DELETE */
+    return performDelete( buildUrl );
+}
+
+
+/*++
+* @method: twitCurl::trendsGet()
+*
+* @description: gets trends.
+*
+* @input: none
+*
+* @output: true if GET is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::trendsGet()
+{
+    /* Perform GET */
+    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                       twitterDefaults::TWITCURL_TRENDS_URL +
+                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+}
+
+
+/*++
+* @method: twitCurl::trendsDailyGet()
+*
+* @description: gets daily trends.
+*
+* @input: none
+*
+* @output: true if GET is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::trendsDailyGet()
+{
+    /* Perform GET */
+    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                       twitterDefaults::TWITCURL_TRENDSDAILY_URL +
+                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+}
+
+/*++
+* @method: twitCurl::trendsWeeklyGet()
+*
+* @description: gets weekly trends.
+*
+* @input: none
+*
+* @output: true if GET is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::trendsWeeklyGet()
+{
+    /* Perform GET */
+    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                       twitterDefaults::TWITCURL_TRENDSWEEKLY_URL +
+                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+}
+
+/*++
+* @method: twitCurl::trendsCurrentGet()
+*
+* @description: gets current trends.
+*
+* @input: none
+*
+* @output: true if GET is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::trendsCurrentGet()
+{
+    /* Perform GET */
+    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                       twitterDefaults::TWITCURL_TRENDSCURRENT_URL +
+                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+}
+
+/*++
+* @method: twitCurl::trendsAvailableGet()
+*
+* @description: gets available trends.
+*
+* @input: none
+*
+* @output: true if GET is success, otherwise false. This does not check http
+*          response by twitter. Use getLastWebResponse() for that.
+*
+*--*/
+bool twitCurl::trendsAvailableGet()
+{
+    /* Perform GET */
+    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
+                       twitterDefaults::TWITCURL_TRENDSAVAILABLE_URL +
+                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+}
+
+/*++
+* @method: twitCurl::getLastWebResponse
+*
+* @description: method to get http response for the most recent request sent.
+*               twitcurl users need to call this method and parse the XML
+*               data returned by twitter to see what has happened.
+*
+* @input: outWebResp - string in which twitter's response is supplied back to caller
+*
+* @output: none
+*
+*--*/
+void twitCurl::getLastWebResponse( std::string& outWebResp )
+{
+    outWebResp = "";
+    if( m_callbackData.length() )
+    {
+        outWebResp = m_callbackData;
+    }
+}
+
+/*++
+* @method: twitCurl::takeLastWebResponse
+*
+* @description: method to move twitter response for most recent web request
+*               out of twitcurl without copying it. after this call
+*               getLastWebResponse() returns an empty string.
+*
+* @input: outWebResp - string that receives twitter's response
+*
+* @output: none
+*
+*--*/
+void twitCurl::takeLastWebResponse( std::string& outWebResp )
+{
+    outWebResp.clear();
+    outWebResp.swap( m_callbackData );
+}
+
+/*++
+* @method: twitCurl::getLastCurlError
+*
+* @description: method to get cURL error response for most recent http request.
+*               twitcurl users can call this method if any of the APIs return
+*               false.
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitCurl::getLastCurlError( std::string& outErrResp )
+{
+    m_errorBuffer[twitCurlDefaults::TWITCURL_DEFAULT_BUFFSIZE-1] = twitCurlDefaults::TWITCURL_EOS;
+    outErrResp.assign( m_errorBuffer );
+}
+
+/*++
+* @method: twitCurl::curlCallback
+*
+* @description: static method to get http response back from cURL.
+*               this is an internal method, users of twitcurl need not
+*               use this.
+*
+* @input: as per cURL convention.
+*
+* @output: size of data stored in our buffer
+*
+* @remarks: internal method
+*
+*--*/
+int twitCurl::curlCallback( char* data, size_t size, size_t nmemb, twitCurl* pTwitCurlObj )
+{
+    if( pTwitCurlObj && data )
+    {
+        /* Save http response in twitcurl object's buffer */
+        return pTwitCurlObj->saveLastWebResponse( data, ( size*nmemb ) );
+    }
+    return 0;
+}
+
+/*++
+* @method: twitCurl::curlHeaderCallback
+*
+* @description: static method to get http response headers back from cURL.
+*               this is an internal method, users of twitcurl need not
+*               use this.
+*
+* @input: as per cURL convention.
+*
+* @output: size of header data consumed
+*
+* @remarks: internal method
+*
+*--*/
+size_t twitCurl::curlHeaderCallback( char* data, size_t size, size_t nmemb, twitCurl* pTwitCurlObj )
 {
-    /* Prepare URL */
-    std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                           twitterDefaults::TWITCURL_SAVEDSEARCHCREATE_URL +
-                           twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
-
-    /* Send some dummy data in POST */
-    std::string queryStr = twitCurlDefaults::TWITCURL_QUERYSTRING + urlencode( query );
-
-    /* Perform POST */
-    return performPost( buildUrl, queryStr );
+    if( pTwitCurlObj && data )
+    {
+        pTwitCurlObj->saveLastResponseHeader( data, size*nmemb );
+    }
+    return size*nmemb;
 }
 
-
 /*++
-* @method: twitCurl::savedSearchDestroy
+* @method: twitCurl::curlReadCallback
 *
-* @description: method to destroy a saved search for the authenticated user. The search specified
-*               by id must be owned by the authenticating user.
+* @description: static method to feed a media range to cURL as a request
+*               body is sent. this is an internal method, users of twitcurl
+*               need not use this.
 *
-* @input: searchId - search id of item to be deleted
+* @input: as per cURL convention, the range given with CURLFORM_STREAM.
 *
-* @output: true if DELETE is success, otherwise false. This does not check http
-*          response by twitter. Use getLastWebResponse() for that.
+* @output: number of bytes provided, 0 at the end of the range
+*
+* @remarks: internal method
 *
 *--*/
-bool twitCurl::savedSearchDestroy( const std::string& searchId )
+size_t twitCurl::curlReadCallback( char* data, size_t size, size_t nmemb, twitMediaRange* pRange )
 {
-    /* Prepare URL */
-    std::string buildUrl = twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                           twitterDefaults::TWITCURL_SAVEDSEARCHDESTROY_URL + searchId +
-                           twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType];
-
-    /* Perform DELETE */
-    return performDelete( buildUrl );
+    if( !pRange || pRange->offset >= pRange->end )
+    {
+        return 0;
+    }
+    size_t length = (size_t)std::min( (unsigned long long)( size*nmemb ), pRange->end - pRange->offset );
+    if( pRange->bandwidth )
+    {
+        /* Blocks while the shared budget is used up */
+        length = pRange->bandwidth->acquire( eTwitTrafficBulk, length );
+    }
+    size_t count = pRange->source->readAt( pRange->offset, data, length );
+    if( !count )
+    {
+        /* The source ended early, the body would not match its length */
+        return CURL_READFUNC_ABORT;
+    }
+    pRange->offset += count;
+    return count;
 }
 
-
 /*++
-* @method: twitCurl::trendsGet()
+* @method: twitCurl::curlSeekCallback
 *
-* @description: gets trends.
+* @description: static method to rewind a media range when cURL sends its
+*               body again, e.g. over a new connection after a kept alive
+*               one turned out dead. this is an internal method, users of
+*               twitcurl need not use this.
 *
-* @input: none
+* @input: as per cURL convention, the range given with CURLOPT_SEEKDATA.
 *
-* @output: true if GET is success, otherwise false. This does not check http
-*          response by twitter. Use getLastWebResponse() for that.
+* @output: CURL_SEEKFUNC_OK if moved
+*
+* @remarks: internal method
 *
 *--*/
-bool twitCurl::trendsGet()
+int twitCurl::curlSeekCallback( twitMediaRange* pRange, curl_off_t offset, int origin )
 {
-    /* Perform GET */
-    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                       twitterDefaults::TWITCURL_TRENDS_URL +
-                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+    if( !pRange || ( SEEK_SET != origin ) || ( offset < 0 ) ||
+        ( (unsigned long long)offset > pRange->end - pRange->start ) )
+    {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    pRange->offset = pRange->start + (unsigned long long)offset;
+    return CURL_SEEKFUNC_OK;
 }
 
-
 /*++
-* @method: twitCurl::trendsDailyGet()
+* @method: twitCurl::curlSockoptCallback
 *
-* @description: gets daily trends.
+* @description: static method called by cURL for every new connection,
+*               which rewinds a media range. cURL rebuilds a form when it
+*               retries a request over a new connection after a kept alive
+*               one died, and then reads stream parts again from their
+*               callback without seeking them. this is an internal method,
+*               users of twitcurl need not use this.
 *
-* @input: none
+* @input: as per cURL convention, the range given with CURLOPT_SOCKOPTDATA.
 *
-* @output: true if GET is success, otherwise false. This does not check http
-*          response by twitter. Use getLastWebResponse() for that.
+* @output: CURL_SOCKOPT_OK
+*
+* @remarks: internal method
 *
 *--*/
-bool twitCurl::trendsDailyGet()
+int twitCurl::curlSockoptCallback( twitMediaRange* pRange, curl_socket_t /* curlfd */, curlsocktype /* purpose */ )
 {
-    /* Perform GET */
-    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                       twitterDefaults::TWITCURL_TRENDSDAILY_URL +
-                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+    if( pRange )
+    {
+        pRange->offset = pRange->start;
+    }
+    return CURL_SOCKOPT_OK;
 }
 
 /*++
-* @method: twitCurl::trendsWeeklyGet()
+* @method: twitCurl::isCancelled
 *
-* @description: gets weekly trends.
+* @description: method to check the cancel flag. this is an internal method.
 *
 * @input: none
 *
-* @output: true if GET is success, otherwise false. This does not check http
-*          response by twitter. Use getLastWebResponse() for that.
+* @output: true if requests are to be aborted
+*
+* @remarks: internal method
 *
 *--*/
-bool twitCurl::trendsWeeklyGet()
+bool twitCurl::isCancelled()
 {
-    /* Perform GET */
-    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                       twitterDefaults::TWITCURL_TRENDSWEEKLY_URL +
-                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+    return m_cancelFlag && *m_cancelFlag;
 }
 
 /*++
-* @method: twitCurl::trendsCurrentGet()
+* @method: twitCurl::waitToRetry
 *
-* @description: gets current trends.
+* @description: method to sleep before a request is retried, waking up as
+*               soon as the cancel flag or abort is set. this is an
+*               internal method.
 *
-* @input: none
+* @input: seconds - time to wait,
+*         abort - flag that also ends the wait
 *
-* @output: true if GET is success, otherwise false. This does not check http
-*          response by twitter. Use getLastWebResponse() for that.
+* @output: true if the whole time passed
+*
+* @remarks: internal method
 *
 *--*/
-bool twitCurl::trendsCurrentGet()
+bool twitCurl::waitToRetry( double seconds, const std::atomic<bool>& abort )
 {
-    /* Perform GET */
-    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                       twitterDefaults::TWITCURL_TRENDSCURRENT_URL +
-                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+    std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( seconds ) );
+    while( !abort && !isCancelled() )
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if( now >= until )
+        {
+            return true;
+        }
+        std::this_thread::sleep_for( std::min<std::chrono::steady_clock::duration>(
+            until - now, std::chrono::milliseconds( twitCurlDefaults::TWITCURL_RETRY_POLL_MS ) ) );
+    }
+    return false;
 }
 
 /*++
-* @method: twitCurl::trendsAvailableGet()
+* @method: twitCurl::curlProgressCallback
 *
-* @description: gets available trends.
+* @description: static method called by cURL during transfers, which aborts
+*               them once the cancel flag is set. this is an internal
+*               method, users of twitcurl need not use this.
 *
-* @input: none
+* @input: as per cURL convention.
 *
-* @output: true if GET is success, otherwise false. This does not check http
-*          response by twitter. Use getLastWebResponse() for that.
+* @output: non-zero to abort the transfer
+*
+* @remarks: internal method
 *
 *--*/
-bool twitCurl::trendsAvailableGet()
+int twitCurl::curlProgressCallback( twitCurl* pTwitCurlObj, double /* dltotal */, double /* dlnow */,
+                                    double /* ultotal */, double /* ulnow */ )
 {
-    /* Perform GET */
-    return performGet( twitCurlDefaults::TWITCURL_PROTOCOLS[m_eProtocolType] +
-                       twitterDefaults::TWITCURL_TRENDSAVAILABLE_URL +
-                       twitCurlDefaults::TWITCURL_EXTENSIONFORMATS[m_eApiFormatType] );
+    return ( pTwitCurlObj && pTwitCurlObj->isCancelled() ) ? 1 : 0;
 }
 
 /*++
-* @method: twitCurl::getLastWebResponse
+* @method: twitCurl::saveLastResponseHeader
 *
-* @description: method to get http response for the most recent request sent.
-*               twitcurl users need to call this method and parse the XML
-*               data returned by twitter to see what has happened.
+* @description: method to pick rate limit information out of a response
+*               header line. this is an internal method and twitcurl users
+*               need not use this.
 *
-* @input: outWebResp - string in which twitter's response is supplied back to caller
+* @input: data - header line from cURL,
+*         size - size of header line
 *
 * @output: none
 *
+* @remarks: internal method
+*
 *--*/
-void twitCurl::getLastWebResponse( std::string& outWebResp )
+void twitCurl::saveLastResponseHeader( const char* data, size_t size )
 {
-    outWebResp = "";
-    if( m_callbackData.length() )
+    static const char* rateLimitPrefix = "x-rate-limit-";
+    const size_t prefixLength = strlen( rateLimitPrefix );
+    if( size <= prefixLength )
     {
-        outWebResp = m_callbackData;
+        return;
+    }
+    for( size_t i = 0; i < prefixLength; ++i )
+    {
+        if( tolower( (unsigned char)data[i] ) != rateLimitPrefix[i] )
+        {
+            return;
+        }
+    }
+
+    std::string line( data + prefixLength, size - prefixLength );
+    size_t colon = line.find( ':' );
+    if( std::string::npos == colon )
+    {
+        return;
+    }
+    std::string name = line.substr( 0, colon );
+    std::transform( name.begin(), name.end(), name.begin(), ::tolower );
+    unsigned long long value = strtoull( line.c_str() + colon + 1, NULL, 10 );
+
+    if( name == "limit" )
+    {
+        m_lastRateLimit.limit = (int)value;
+    }
+    else if( name == "remaining" )
+    {
+        m_lastRateLimit.remaining = (int)value;
+    }
+    else if( name == "reset" )
+    {
+        m_lastRateLimit.reset = value;
     }
 }
 
 /*++
-* @method: twitCurl::getLastCurlError
+* @method: twitCurl::getLastRateLimit
 *
-* @description: method to get cURL error response for most recent http request.
-*               twitcurl users can call this method if any of the APIs return
-*               false.
+* @description: method to get the rate limit window twitter reported for the
+*               most recent web request
 *
 * @input: none
 *
-* @output: none
+* @output: outRateLimit - rate limit, fields are -1/0 if not reported
 *
 *--*/
-void twitCurl::getLastCurlError( std::string& outErrResp )
+void twitCurl::getLastRateLimit( twitRateLimit& outRateLimit )
 {
-    m_errorBuffer[twitCurlDefaults::TWITCURL_DEFAULT_BUFFSIZE-1] = twitCurlDefaults::TWITCURL_EOS;
-    outErrResp.assign( m_errorBuffer );
+    outRateLimit = m_lastRateLimit;
 }
 
 /*++
-* @method: twitCurl::curlCallback
-*
-* @description: static method to get http response back from cURL.
-*               this is an internal method, users of twitcurl need not
-*               use this.
+* @method: twitCurl::getLastHttpStatus
 *
-* @input: as per cURL convention.
+* @description: method to get the http status code of the most recent web
+*               request
 *
-* @output: size of data stored in our buffer
+* @input: none
 *
-* @remarks: internal method
+* @output: http status code, 0 if no response was received
 *
 *--*/
-int twitCurl::curlCallback( char* data, size_t size, size_t nmemb, twitCurl* pTwitCurlObj )
+long twitCurl::getLastHttpStatus()
 {
-    if( pTwitCurlObj && data )
+    long httpStatus = 0;
+    if( isCurlInit() )
     {
-        /* Save http response in twitcurl object's buffer */
-        return pTwitCurlObj->saveLastWebResponse( data, ( size*nmemb ) );
+        curl_easy_getinfo( m_curlHandle, CURLINFO_RESPONSE_CODE, &httpStatus );
     }
-    return 0;
+    return httpStatus;
 }
 
 /*++
@@ -1755,6 +2679,9 @@ void twitCurl::clearCurlCallbackBuffers()
 {
     m_callbackData = "";
     memset( m_errorBuffer, 0, twitCurlDefaults::TWITCURL_DEFAULT_BUFFSIZE );
+    m_lastRateLimit.limit = -1;
+    m_lastRateLimit.remaining = -1;
+    m_lastRateLimit.reset = 0;
 }
 
 /*++
@@ -1830,6 +2757,10 @@ void twitCurl::prepareCurlCallback()
     curl_easy_setopt( m_curlHandle, CURLOPT_WRITEFUNCTION, curlCallback );
     curl_easy_setopt( m_curlHandle, CURLOPT_WRITEDATA, this );
 
+    /* Set callback function to get response headers */
+    curl_easy_setopt( m_curlHandle, CURLOPT_HEADERFUNCTION, curlHeaderCallback );
+    curl_easy_setopt( m_curlHandle, CURLOPT_HEADERDATA, this );
+
     /* Set the flag to true indicating that callback info is set in cURL */
     m_curlCallbackParamsSet = true;
 }
@@ -1904,6 +2835,14 @@ void twitCurl::prepareStandardParams()
 
     /* Prepare username and password for twitter */
     prepareCurlUserPass();
+
+    /* Per connection upload cap, 0 for none */
+    curl_easy_setopt( m_curlHandle, CURLOPT_MAX_SEND_SPEED_LARGE, (curl_off_t)m_maxSendSpeed );
+
+    /* Watch the cancel flag while a transfer is under way */
+    curl_easy_setopt( m_curlHandle, CURLOPT_NOPROGRESS, m_cancelFlag ? 0L : 1L );
+    curl_easy_setopt( m_curlHandle, CURLOPT_PROGRESSFUNCTION, curlProgressCallback );
+    curl_easy_setopt( m_curlHandle, CURLOPT_PROGRESSDATA, this );
 }
 
 /*++
@@ -1950,7 +2889,7 @@ bool twitCurl::performGet( const std::string& getUrl )
     curl_easy_setopt( m_curlHandle, CURLOPT_URL, getUrl.c_str() );
 
     /* Send http request */
-    if( CURLE_OK == curl_easy_perform( m_curlHandle ) )
+    if( CURLE_OK == performRequest( eTwitTrafficInteractive ) )
     {
         if( pOAuthHeaderList )
         {
@@ -2007,7 +2946,7 @@ bool twitCurl::performGetInternal( const std::string& getUrl,
     }
 
     /* Send http request */
-    if( CURLE_OK == curl_easy_perform( m_curlHandle ) )
+    if( CURLE_OK == performRequest( eTwitTrafficInteractive ) )
     {
         if( pOAuthHeaderList )
         {
@@ -2067,7 +3006,7 @@ bool twitCurl::performDelete( const std::string& deleteUrl )
     curl_easy_setopt( m_curlHandle, CURLOPT_COPYPOSTFIELDS, dataStrDummy.c_str() );
 
     /* Send http request */
-    if( CURLE_OK == curl_easy_perform( m_curlHandle ) )
+    if( CURLE_OK == performRequest( eTwitTrafficInteractive ) )
     {
         if( pOAuthHeaderList )
         {
@@ -2089,17 +3028,24 @@ bool twitCurl::performDelete( const std::string& deleteUrl )
 *               twitcurl users should not use this method.
 *
 * @input: postUrl - url,
-*         dataStr - url encoded data to be posted
+*         dataStr - data to be posted,
+*         contentType - how dataStr is encoded
 *
 * @output: none
 *
 * @remarks: internal method
-*           data value in dataStr must already be url encoded.
-*           ex: dataStr = "key=urlencode(value)"
+*           for eTwitCurlContentUrlEncoded, data value in dataStr must already
+*           be url encoded. ex: dataStr = "key=urlencode(value)"
+*           for eTwitCurlContentJson, dataStr is a JSON document. it is not
+*           part of the OAuth signature and is sent without being copied,
+*           so it must stay untouched until this method returns.
 *
 *--*/
-bool twitCurl::performPost( const std::string& postUrl, std::string dataStr )
+bool twitCurl::performPost( const std::string& postUrl, const std::string& dataStr,
+                            const twitCurlTypes::eTwitCurlContentType contentType )
 {
+    const bool isJson = ( twitCurlTypes::eTwitCurlContentJson == contentType );
+
     /* Return if cURL is not initialized */
     if( !isCurlInit() )
     {
@@ -2112,39 +3058,152 @@ bool twitCurl::performPost( const std::string& postUrl, std::string dataStr )
     /* Prepare standard params */
     prepareStandardParams();
 
-    /* Set OAuth header */
-    m_oAuth.getOAuthHeader( eOAuthHttpPost, postUrl, dataStr, oAuthHttpHeader );
+    /* Set OAuth header, only form encoded bodies take part in the signature */
+    m_oAuth.getOAuthHeader( eOAuthHttpPost, postUrl, isJson ? "" : dataStr, oAuthHttpHeader );
     if( oAuthHttpHeader.length() )
     {
         pOAuthHeaderList = curl_slist_append( pOAuthHeaderList, oAuthHttpHeader.c_str() );
-        if( pOAuthHeaderList )
-        {
-            curl_easy_setopt( m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList );
-        }
+    }
+    if( isJson )
+    {
+        pOAuthHeaderList = curl_slist_append( pOAuthHeaderList, twitCurlDefaults::TWITCURL_CONTENTTYPE_JSON.c_str() );
+    }
+    if( pOAuthHeaderList )
+    {
+        curl_easy_setopt( m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList );
     }
 
     /* Set http request, url and data */
     curl_easy_setopt( m_curlHandle, CURLOPT_POST, 1 );
     curl_easy_setopt( m_curlHandle, CURLOPT_URL, postUrl.c_str() );
-    if( dataStr.length() )
+    if( isJson )
+    {
+        /* Send the caller's buffer as is, cURL does not copy it */
+        curl_easy_setopt( m_curlHandle, CURLOPT_POSTFIELDSIZE, (long)dataStr.length() );
+        curl_easy_setopt( m_curlHandle, CURLOPT_POSTFIELDS, dataStr.c_str() );
+    }
+    else if( dataStr.length() )
     {
         curl_easy_setopt( m_curlHandle, CURLOPT_COPYPOSTFIELDS, dataStr.c_str() );
     }
 
     /* Send http request */
-    if( CURLE_OK == curl_easy_perform( m_curlHandle ) )
+    bool ret = ( CURLE_OK == performRequest( eTwitTrafficInteractive ) );
+
+    if( isJson )
     {
-        if( pOAuthHeaderList )
-        {
-            curl_slist_free_all( pOAuthHeaderList );
-        }
-        return true;
+        /* Do not leave cURL pointing at a buffer we do not own */
+        curl_easy_setopt( m_curlHandle, CURLOPT_POSTFIELDSIZE, -1L );
+        curl_easy_setopt( m_curlHandle, CURLOPT_COPYPOSTFIELDS, "" );
     }
     if( pOAuthHeaderList )
     {
         curl_slist_free_all( pOAuthHeaderList );
     }
-    return false;
+    return ret;
+}
+
+/*++
+* @method: twitCurl::performMultiPartPost
+*
+* @description: method to send a multipart/form-data POST request. parts
+*               added with CURLFORM_STREAM are read through their
+*               twitMediaRange while the request is sent. this is an
+*               internal method. twitcurl users should not use this method.
+*
+* @input: postUrl - url,
+*         post - form, still owned by the caller,
+*         trafficClass - bulk if the form streams media,
+*         range - range of the part added with CURLFORM_STREAM, rewound
+*                 when cURL sends the body again, so that a dead kept alive
+*                 connection does not cost a segment attempt; NULL if none
+*
+* @output: true if the request completed
+*
+* @remarks: internal method
+*
+*--*/
+bool twitCurl::performMultiPartPost( const std::string& postUrl, struct curl_httppost* post,
+                                     const eTwitTrafficClass trafficClass, twitMediaRange* range )
+{
+    /* Return if cURL is not initialized */
+    if( !isCurlInit() )
+    {
+        return false;
+    }
+
+    std::string oAuthHttpHeader;
+    struct curl_slist* pOAuthHeaderList = NULL;
+
+    /* Prepare standard params */
+    prepareStandardParams();
+
+    /* Set OAuth header, multipart bodies take no part in the signature */
+    m_oAuth.getOAuthHeader( eOAuthHttpPost, postUrl, "", oAuthHttpHeader );
+    if( oAuthHttpHeader.length() )
+    {
+        pOAuthHeaderList = curl_slist_append( pOAuthHeaderList, oAuthHttpHeader.c_str() );
+        curl_easy_setopt( m_curlHandle, CURLOPT_HTTPHEADER, pOAuthHeaderList );
+    }
+
+    /* Set http request, url and form */
+    curl_easy_setopt( m_curlHandle, CURLOPT_URL, postUrl.c_str() );
+    curl_easy_setopt( m_curlHandle, CURLOPT_READFUNCTION, curlReadCallback );
+    if( range )
+    {
+        curl_easy_setopt( m_curlHandle, CURLOPT_SEEKFUNCTION, curlSeekCallback );
+        curl_easy_setopt( m_curlHandle, CURLOPT_SEEKDATA, range );
+        curl_easy_setopt( m_curlHandle, CURLOPT_SOCKOPTFUNCTION, curlSockoptCallback );
+        curl_easy_setopt( m_curlHandle, CURLOPT_SOCKOPTDATA, range );
+    }
+    curl_easy_setopt( m_curlHandle, CURLOPT_HTTPPOST, post );
+
+    /* Send http request */
+    bool ret = ( CURLE_OK == performRequest( trafficClass ) );
+
+    /* Do not leave cURL pointing at a form or headers about to be freed,
+       nor at callbacks that take their data for a twitMediaRange */
+    curl_easy_setopt( m_curlHandle, CURLOPT_HTTPPOST, NULL );
+    curl_easy_setopt( m_curlHandle, CURLOPT_HTTPHEADER, NULL );
+    curl_easy_setopt( m_curlHandle, CURLOPT_READFUNCTION, NULL );
+    curl_easy_setopt( m_curlHandle, CURLOPT_SEEKFUNCTION, NULL );
+    curl_easy_setopt( m_curlHandle, CURLOPT_SEEKDATA, NULL );
+    curl_easy_setopt( m_curlHandle, CURLOPT_SOCKOPTFUNCTION, NULL );
+    curl_easy_setopt( m_curlHandle, CURLOPT_SOCKOPTDATA, NULL );
+    if( pOAuthHeaderList )
+    {
+        curl_slist_free_all( pOAuthHeaderList );
+    }
+    return ret;
+}
+
+/*++
+* @method: twitCurl::performRequest
+*
+* @description: method to send the request set up in cURL, accounted for in
+*               the shared upload budget if there is one. this is an
+*               internal method. twitcurl users should not use this method.
+*
+* @input: trafficClass - kind of the request
+*
+* @output: result of cURL
+*
+* @remarks: internal method
+*
+*--*/
+CURLcode twitCurl::performRequest( const eTwitTrafficClass trafficClass )
+{
+    if( !m_bandwidth )
+    {
+        return curl_easy_perform( m_curlHandle );
+    }
+
+    m_bandwidth->beginTransfer( trafficClass );
+    CURLcode ret = curl_easy_perform( m_curlHandle );
+    double bytesSent = 0.0;
+    curl_easy_getinfo( m_curlHandle, CURLINFO_SIZE_UPLOAD, &bytesSent );
+    m_bandwidth->endTransfer( trafficClass, (unsigned long long)bytesSent );
+    return ret;
 }
 
 /*++
@@ -2204,6 +3263,45 @@ void utilMakeUrlForUser( std::string& outUrl, const std::string& baseUrl, const
     }
 }
 
+/*++
+* @method: utilAppendTimelineParams
+*
+* @description: utility function to append the paging parameters of the
+*               timeline APIs to a url without a query string. twitcurl
+*               users should not use this function.
+*
+* @input: sinceId - since id, empty to leave out,
+*         maxId - max id, empty to leave out,
+*         count - number of items, capped to MAX_TIMELINE_TWEET_COUNT,
+*                 0 to leave out
+*
+* @output: outUrl - url with parameters appended
+*
+* @remarks: internal method
+*
+*--*/
+void utilAppendTimelineParams( std::string& outUrl, const std::string& sinceId, const std::string& maxId, const unsigned int count )
+{
+    std::string sep = twitCurlDefaults::TWITCURL_URL_SEP_QUES;
+    if( sinceId.length() )
+    {
+        outUrl += sep + twitCurlDefaults::TWITCURL_SINCEID + sinceId;
+        sep = twitCurlDefaults::TWITCURL_URL_SEP_AMP;
+    }
+    if( maxId.length() )
+    {
+        outUrl += sep + twitCurlDefaults::TWITCURL_MAXID + maxId;
+        sep = twitCurlDefaults::TWITCURL_URL_SEP_AMP;
+    }
+    if( count )
+    {
+        std::stringstream tmpStrm;
+        tmpStrm << sep << twitCurlDefaults::TWITCURL_COUNT
+                << std::min( count, twitCurlDefaults::MAX_TIMELINE_TWEET_COUNT );
+        outUrl += tmpStrm.str();
+    }
+}
+
 /*++
 * @method: twitCurl::getOAuth
 *
@@ -2360,7 +3458,7 @@ bool twitCurl::oAuthHandlePIN( const std::string& authorizeUrl /* in */ )
     curl_easy_setopt( m_curlHandle, CURLOPT_URL, authorizeUrl.c_str() );
 
     /* Send http request */
-    if( CURLE_OK == curl_easy_perform( m_curlHandle ) )
+    if( CURLE_OK == performRequest( eTwitTrafficInteractive ) )
     {
         if( pOAuthHeaderList )
         {
@@ -2434,7 +3532,7 @@ bool twitCurl::oAuthHandlePIN( const std::string& authorizeUrl /* in */ )
     curl_easy_setopt( m_curlHandle, CURLOPT_COPYPOSTFIELDS, dataStr.c_str() );
 
     /* Send http request */
-    if( CURLE_OK == curl_easy_perform( m_curlHandle ) )
+    if( CURLE_OK == performRequest( eTwitTrafficInteractive ) )
     {
         if( pOAuthHeaderList )
         {
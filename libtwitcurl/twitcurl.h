@@ -5,7 +5,14 @@
 #include <sstream>
 #include <cstring>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include "oauthlib.h"
+#include "twitjsonwriter.h"
+#include "twitmediasource.h"
+#include "twitchunksizer.h"
+#include "twitbandwidth.h"
+#include "twituploadsession.h"
 #include "curl/curl.h"
 
 
@@ -35,6 +42,39 @@ namespace twitCurlTypes
         eTwitCurlMediaWEBP,
         eTwitCurlMediaMP4,
     };
+
+    enum eTwitCurlMediaState
+    {
+        eTwitCurlMediaStateNone = 0,        /* no processing, usable at once */
+        eTwitCurlMediaStatePending,
+        eTwitCurlMediaStateInProgress,
+        eTwitCurlMediaStateSucceeded,
+        eTwitCurlMediaStateFailed
+    };
+
+    enum eTwitCurlContentType
+    {
+        eTwitCurlContentUrlEncoded = 0,
+        eTwitCurlContentJson
+    };
+};
+
+/* Rate limit window reported by twitter in the response headers */
+struct twitRateLimit
+{
+    int limit;                  /* -1 if not reported */
+    int remaining;              /* -1 if not reported */
+    unsigned long long reset;   /* seconds since epoch, 0 if not reported */
+};
+
+/* Processing of uploaded media reported by FINALIZE and STATUS. Media can
+   be attached once its state is None or Succeeded. */
+struct twitMediaProcessing
+{
+    twitCurlTypes::eTwitCurlMediaState state;
+    int checkAfterSecs;         /* wait before the next STATUS, 0 if not reported */
+    int progressPercent;        /* -1 if not reported */
+    std::string errorMessage;   /* reason given when processing failed */
 };
 
 struct twitStatus
@@ -64,7 +104,9 @@ public:
     void setTwitterPassword( const std::string& passWord /* in */ );
 
     /* Twitter search APIs */
-    bool search( const std::string& searchQuery /* in */, const std::string resultCount = "" /* in */ );
+    bool search( const std::string& searchQuery /* in */,
+                 const std::string resultCount = "" /* in */,
+                 const std::string maxId = "" /* in */ );
 
     /* Twitter status APIs */
     bool statusUpdate(const std::string& newStatus /* in */);
@@ -74,16 +116,22 @@ public:
     bool retweetById( const std::string& statusId /* in */ );
 
     /* Twitter timeline APIs */
-    bool timelineHomeGet( const std::string sinceId = ""  /* in */ );
+    bool timelineHomeGet( const std::string sinceId = ""  /* in */,
+                          const std::string maxId = "" /* in */,
+                          const unsigned int tweetCount = 0 /* in */ );
     bool timelinePublicGet();
     bool timelineFriendsGet();
     bool timelineUserGet( const bool trimUser /* in */,
                           const bool includeRetweets /* in */,
                           const unsigned int tweetCount /* in */,
                           const std::string userInfo = "" /* in */,
-                          const bool isUserId = false /* in */ );
+                          const bool isUserId = false /* in */,
+                          const std::string sinceId = "" /* in */,
+                          const std::string maxId = "" /* in */ );
     bool featuredUsersGet();
-    bool mentionsGet( const std::string sinceId = "" /* in */ );
+    bool mentionsGet( const std::string sinceId = "" /* in */,
+                      const std::string maxId = "" /* in */,
+                      const unsigned int tweetCount = 0 /* in */ );
 
     /* Twitter user APIs */
     bool userLookup( const std::vector<std::string> &userInfo /* in */,  const bool isUserId = false /* in */ );
@@ -92,10 +140,15 @@ public:
     bool followersGet( const std::string userInfo = "" /* in */, const bool isUserId = false /* in */ );
 
     /* Twitter direct message APIs */
-    bool directMessageGet( const std::string sinceId = "" /* in */ );
+    bool directMessageGet( const std::string sinceId = "" /* in */,
+                           const std::string maxId = "" /* in */,
+                           const unsigned int messageCount = 0 /* in */ );
     bool directMessageSend( const std::string& userInfo /* in */, const std::string& dMsg /* in */, const bool isUserId = false /* in */ );
     bool directMessageGetSent();
     bool directMessageDestroyById( const std::string& dMsgId /* in */ );
+    bool directMessageEventSend( const std::string& recipientId /* in */,
+                                 const std::string& dMsg /* in */,
+                                 const std::string& mediaId = "" /* in */ );
 
     /* Twitter friendships APIs */
     bool friendshipCreate( const std::string& userInfo /* in */, const bool isUserId = false /* in */ );
@@ -141,16 +194,39 @@ public:
     bool trendsAvailableGet();
 
     /* Upload Media */
-    bool uploadMedia(std::istream& is, twitCurlTypes::eTwitCurlMediaType mtype, std::string& o_media_id, std::string& o_error_message);
+    bool uploadMedia( std::istream& is /* in */, twitCurlTypes::eTwitCurlMediaType mtype /* in */,
+                      std::string& o_media_id /* out */, std::string& o_error_message /* out */,
+                      twitUploadSession* session = NULL /* in */ );
+    bool uploadMedia( twitMediaSource& source /* in */, twitCurlTypes::eTwitCurlMediaType mtype /* in */,
+                      std::string& o_media_id /* out */, std::string& o_error_message /* out */,
+                      twitUploadSession* session = NULL /* in */ );
+    bool uploadMediaStream( std::istream& is /* in */, twitCurlTypes::eTwitCurlMediaType mtype /* in */,
+                            std::string& o_media_id /* out */, std::string& o_error_message /* out */,
+                            unsigned long long expectedSize = 0 /* in */ );
+    bool mediaMetadataCreate( const std::string& mediaId /* in */, const std::string& altText /* in */ );
+    bool mediaStatus( const std::string& mediaId /* in */, twitMediaProcessing& outProcessing /* out */ );
+    void getLastMediaProcessing( twitMediaProcessing& outProcessing /* out */ );
+    time_t getLastMediaExpiry();
+    void setCancelFlag( const std::atomic<bool>* cancel /* in */ );
+    void setMaxSendSpeed( unsigned long long bytesPerSec /* in */ );
+    void setBandwidth( twitBandwidth* bandwidth /* in */ );
+    void setUploadParallelism( unsigned int parallelism /* in */ );
+    unsigned int getUploadParallelism();
+    void setChunkedUpload( bool chunked /* in */ );
+    twitChunkSizer& getChunkSizer();
 
 
     /* cURL APIs */
     bool isCurlInit();
     void getLastWebResponse( std::string& outWebResp /* out */ );
+    void takeLastWebResponse( std::string& outWebResp /* out */ );
     void getLastCurlError( std::string& outErrResp /* out */);
+    void getLastRateLimit( twitRateLimit& outRateLimit /* out */ );
+    long getLastHttpStatus();
 
     /* Internal cURL related methods */
     int saveLastWebResponse( char*& data, size_t size );
+    void saveLastResponseHeader( const char* data, size_t size );
 
     /* cURL proxy APIs */
     std::string& getProxyServerIp();
@@ -170,6 +246,8 @@ private:
     CURL* m_curlHandle;
     char* m_errorBuffer;
     std::string m_callbackData;
+    std::string m_sendBuffer;
+    twitRateLimit m_lastRateLimit;
 
     /* cURL flags */
     bool m_curlProxyParamsSet;
@@ -190,6 +268,20 @@ private:
     twitCurlTypes::eTwitCurlApiFormatType m_eApiFormatType;
     twitCurlTypes::eTwitCurlProtocolType m_eProtocolType;
 
+    /* Upload settings */
+    unsigned int m_uploadParallelism;
+    bool m_chunkedUpload;
+    std::shared_ptr<twitChunkSizer> m_chunkSizer;
+    twitMediaProcessing m_lastMediaProcessing;
+    time_t m_lastMediaExpiresAt;
+
+    /* Aborts transfers once set, NULL if none */
+    const std::atomic<bool>* m_cancelFlag;
+
+    /* Upload rate limits */
+    unsigned long long m_maxSendSpeed;
+    twitBandwidth* m_bandwidth;
+
     /* OAuth data */
     oAuth m_oAuth;
 
@@ -203,15 +295,33 @@ private:
     bool performGetInternal( const std::string& getUrl,
                              const std::string& oAuthHttpHeader );
     bool performDelete( const std::string& deleteUrl );
-    bool performPost( const std::string& postUrl, std::string dataStr = "" );
+    bool performPost( const std::string& postUrl,
+                      const std::string& dataStr = "",
+                      const twitCurlTypes::eTwitCurlContentType contentType = twitCurlTypes::eTwitCurlContentUrlEncoded );
+    bool performMultiPartPost( const std::string& postUrl, struct curl_httppost* post,
+                               const eTwitTrafficClass trafficClass = eTwitTrafficInteractive,
+                               twitMediaRange* range = NULL );
+    CURLcode performRequest( const eTwitTrafficClass trafficClass );
+    bool isCancelled();
+    bool waitToRetry( double seconds, const std::atomic<bool>& abort );
+    bool appendMediaSegments( twitMediaSource& source, twitUploadSession& session,
+                              std::string& outResponse, long& outHttpStatus );
+    bool appendMediaSegment( twitMediaSource& source, const std::string& mediaId, size_t segment,
+                             unsigned long long offset, unsigned long long end );
 
     /* Internal cURL related methods */
     static int curlCallback( char* data, size_t size, size_t nmemb, twitCurl* pTwitCurlObj );
+    static size_t curlHeaderCallback( char* data, size_t size, size_t nmemb, twitCurl* pTwitCurlObj );
+    static size_t curlReadCallback( char* data, size_t size, size_t nmemb, twitMediaRange* pRange );
+    static int curlSeekCallback( twitMediaRange* pRange, curl_off_t offset, int origin );
+    static int curlSockoptCallback( twitMediaRange* pRange, curl_socket_t curlfd, curlsocktype purpose );
+    static int curlProgressCallback( twitCurl* pTwitCurlObj, double dltotal, double dlnow, double ultotal, double ulnow );
 };
 
 
 /* Private functions */
 void utilMakeCurlParams( std::string& outStr, const std::string& inParam1, const std::string& inParam2 );
 void utilMakeUrlForUser( std::string& outUrl, const std::string& baseUrl, const std::string& userInfo, const bool isUserId );
+void utilAppendTimelineParams( std::string& outUrl, const std::string& sinceId, const std::string& maxId, const unsigned int count );
 
 #endif // _TWITCURL_H_
@@ -12,6 +12,30 @@ namespace twitCurlDefaults
     const std::string TWITCURL_COLON = ":";
     const char TWITCURL_EOS = '\0';
     const unsigned int MAX_TIMELINE_TWEET_COUNT = 200;
+    const unsigned int MAX_USERLOOKUP_USER_COUNT = 100;
+    const size_t MAX_MEDIA_SEGMENT_COUNT = 1000;
+    const int TWITCURL_MEDIA_SEGMENT_ATTEMPTS = 3;
+    const double TWITCURL_MEDIA_RETRY_DELAY_SECS = 1.0;     /* before the second attempt, doubled after */
+    const double TWITCURL_MEDIA_RETRY_MAX_SECS = 15 * 60;   /* a rate limit window */
+    const unsigned int TWITCURL_RETRY_POLL_MS = 100;        /* how soon a wait notices cancellation */
+    const std::string TWITCURL_MEDIATYPES[] = { "",
+                                                "image/png",
+                                                "image/jpeg",
+                                                "image/gif",
+                                                "image/webp",
+                                                "video/mp4"
+                                              };
+
+    /* media_category sent at INIT, indexed by eTwitCurlMediaType. The
+       category makes twitter process video and animated gif asynchronously
+       and report it through STATUS. */
+    const std::string TWITCURL_MEDIACATEGORIES[] = { "",
+                                                     "tweet_image",
+                                                     "tweet_image",
+                                                     "tweet_gif",
+                                                     "tweet_image",
+                                                     "tweet_video"
+                                                   };
 
     /* Miscellaneous data used to build twitter URLs*/
     const std::string TWITCURL_STATUSSTRING = "status=";
@@ -30,6 +54,7 @@ namespace twitCurlDefaults
     const std::string TWITCURL_TARGETSCREENNAME = "target_screen_name=";
     const std::string TWITCURL_TARGETUSERID = "target_id=";
     const std::string TWITCURL_SINCEID = "since_id=";
+    const std::string TWITCURL_MAXID = "max_id=";
     const std::string TWITCURL_TRIMUSER = "trim_user=true";
     const std::string TWITCURL_INCRETWEETS = "include_rts=true";
     const std::string TWITCURL_COUNT = "count=";
@@ -38,6 +63,11 @@ namespace twitCurlDefaults
     const std::string TWITCURL_INCLUDE_ENTITIES = "include_entities=";
     const std::string TWITCURL_STRINGIFY_IDS = "stringify_ids=";
     const std::string TWITCURL_INREPLYTOSTATUSID = "in_reply_to_status_id=";
+    const std::string TWITCURL_MEDIASTATUS = "command=STATUS";
+    const std::string TWITCURL_MEDIAID = "media_id=";
+
+    /* HTTP headers */
+    const std::string TWITCURL_CONTENTTYPE_JSON = "Content-Type: application/json";
 
     /* URL separators */
     const std::string TWITCURL_URL_SEP_AMP = "&";
@@ -79,6 +109,7 @@ namespace twitterDefaults
     const std::string TWITCURL_DIRECTMESSAGENEW_URL = TWITCURL_BASE_URL + "direct_messages/new";
     const std::string TWITCURL_DIRECTMESSAGESSENT_URL = TWITCURL_BASE_URL + "direct_messages/sent";
     const std::string TWITCURL_DIRECTMESSAGEDESTROY_URL = TWITCURL_BASE_URL + "direct_messages/destroy/";
+    const std::string TWITCURL_DIRECTMESSAGEEVENTNEW_URL = TWITCURL_BASE_URL + "direct_messages/events/new";
 
     /* Friendships URLs */
     const std::string TWITCURL_FRIENDSHIPSCREATE_URL = TWITCURL_BASE_URL + "friendships/create";
@@ -120,6 +151,7 @@ namespace twitterDefaults
 
     /* Upload URL */
     const std::string TWITCURL_MEDIAUPLOAD_URL = TWITCURL_UPLOAD_URL + "media/upload";
+    const std::string TWITCURL_MEDIAMETADATA_URL = TWITCURL_UPLOAD_URL + "media/metadata/create";
 };
 
 namespace oAuthLibDefaults
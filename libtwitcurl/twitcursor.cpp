@@ -0,0 +1,639 @@
+#include <picojson/picojson.h>
+#include "twitcursor.h"
+#include "twitcurlurls.h"
+#include "twitmodel.h"
+
+namespace
+{
+    const int TWITCURSOR_MAX_ATTEMPTS = 4;
+    const std::string TWITCURSOR_FIRST_PAGE = "-1";
+    const std::string TWITCURSOR_LAST_PAGE = "0";
+
+    /* Returns position just past "key": in response, npos if absent */
+    size_t findJsonKey( const std::string& response, const char* key )
+    {
+        std::string quoted = std::string( "\"" ) + key + "\"";
+        size_t pos = response.find( quoted );
+        if( std::string::npos == pos )
+        {
+            return std::string::npos;
+        }
+        pos = response.find( ':', pos + quoted.size() );
+        return ( std::string::npos == pos ) ? pos : pos + 1;
+    }
+}
+
+/*++
+* @method: twitScanIdsResponse
+*
+* @description: extracts ids and next cursor from a friends/ids,
+*               followers/ids or blocks/ids response. ids are read as 64 bit
+*               integers whether or not they were stringified, so nothing is
+*               lost to double precision.
+*
+* @input: response - JSON response
+*
+* @output: outIds - ids are appended,
+*          outNextCursor - next cursor, "0" if absent,
+*          true if the response holds an ids array
+*
+*--*/
+bool twitScanIdsResponse( const std::string& response, std::vector<unsigned long long>& outIds, std::string& outNextCursor )
+{
+    outNextCursor = TWITCURSOR_LAST_PAGE;
+    size_t pos = findJsonKey( response, "ids" );
+    if( std::string::npos == pos )
+    {
+        return false;
+    }
+    pos = response.find( '[', pos );
+    if( std::string::npos == pos )
+    {
+        return false;
+    }
+
+    const char* cur = response.c_str() + pos + 1;
+    const char* end = response.c_str() + response.size();
+    outIds.reserve( outIds.size() + 5000 );
+    while( cur < end && *cur != ']' )
+    {
+        if( *cur >= '0' && *cur <= '9' )
+        {
+            unsigned long long id = 0;
+            while( cur < end && *cur >= '0' && *cur <= '9' )
+            {
+                id = id * 10 + (unsigned long long)( *cur - '0' );
+                ++cur;
+            }
+            outIds.push_back( id );
+        }
+        else
+        {
+            /* Quotes, commas and white space */
+            ++cur;
+        }
+    }
+
+    pos = findJsonKey( response, "next_cursor_str" );
+    if( std::string::npos != pos )
+    {
+        size_t open = response.find( '"', pos );
+        size_t close = ( std::string::npos == open ) ? open : response.find( '"', open + 1 );
+        if( std::string::npos != close )
+        {
+            outNextCursor = response.substr( open + 1, close - open - 1 );
+        }
+    }
+    else if( std::string::npos != ( pos = findJsonKey( response, "next_cursor" ) ) )
+    {
+        size_t first = response.find_first_not_of( " \t\r\n", pos );
+        size_t last = response.find_first_not_of( "0123456789", first );
+        if( std::string::npos != first && last > first )
+        {
+            outNextCursor = response.substr( first, last - first );
+        }
+    }
+    return true;
+}
+
+/*++
+* @method: twitIdCursor::twitIdCursor
+*
+* @description: constructor, starts fetching the first page right away
+*
+* @input: twitObj - authorized twitCurl object, it is cloned and not used
+*                   by the cursor afterwards,
+*         source - endpoint to walk,
+*         userInfo - user id or screen name, empty for the authenticated
+*                    user; ignored by the block endpoints,
+*         isUserId - true if userInfo contains a user id,
+*         budget - rate budget shared with other users of the same
+*                  credentials, NULL to use a private one
+*
+* @output: none
+*
+*--*/
+twitIdCursor::twitIdCursor( twitCurl& twitObj, const eTwitIdCursorSource source, const std::string& userInfo,
+                            const bool isUserId, twitRateBudget* budget ):
+m_twit( twitObj.clone() ),
+m_source( source ),
+m_userInfo( userInfo ),
+m_isUserId( isUserId ),
+m_budget( budget ? budget : &m_ownBudget ),
+m_cancelled( false ),
+m_done( false )
+{
+    switch( m_source )
+    {
+    case eTwitIdCursorFriendsIds:   m_resource = twitRateResources::TWITRATE_FRIENDS_IDS; break;
+    case eTwitIdCursorFollowersIds: m_resource = twitRateResources::TWITRATE_FOLLOWERS_IDS; break;
+    case eTwitIdCursorBlockIds:     m_resource = twitRateResources::TWITRATE_BLOCKS_IDS; break;
+    case eTwitIdCursorBlockList:    m_resource = twitRateResources::TWITRATE_BLOCKS_LIST; break;
+    }
+    startFetch( TWITCURSOR_FIRST_PAGE );
+}
+
+/*++
+* @method: twitIdCursor::~twitIdCursor
+*
+* @description: destructor, abandons a prefetch waiting on the rate budget
+*               and waits for a request already on the wire
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitIdCursor::~twitIdCursor()
+{
+    m_cancelled = true;
+    if( m_prefetch.valid() )
+    {
+        m_prefetch.wait();
+    }
+}
+
+/*++
+* @method: twitIdCursor::next
+*
+* @description: returns the next page and starts fetching the one after it
+*
+* @input: none
+*
+* @output: outPage - ids of the page, contiguous in outPage.ids,
+*          true if a page was returned, false once all pages were walked or
+*          on error; use getErrorMessage() to tell the two apart
+*
+*--*/
+bool twitIdCursor::next( twitIdPage& outPage )
+{
+    if( m_done || !m_prefetch.valid() )
+    {
+        return false;
+    }
+
+    bool ok = m_prefetch.get();
+    if( !ok )
+    {
+        m_errorMessage = m_prefetchError;
+        m_done = true;
+        return false;
+    }
+
+    outPage.ids.swap( m_prefetchPage.ids );
+    outPage.nextCursor.swap( m_prefetchPage.nextCursor );
+    m_prefetchPage.ids.clear();
+
+    if( outPage.nextCursor.empty() || outPage.nextCursor == TWITCURSOR_LAST_PAGE )
+    {
+        m_done = true;
+    }
+    else
+    {
+        /* Page N+1 goes on the wire while the caller works on page N */
+        startFetch( outPage.nextCursor );
+    }
+    return true;
+}
+
+/*++
+* @method: twitIdCursor::isDone
+*
+* @description: tells whether next() will return another page
+*
+* @input: none
+*
+* @output: true once the last page was returned or an error occurred
+*
+*--*/
+bool twitIdCursor::isDone()
+{
+    return m_done;
+}
+
+/*++
+* @method: twitIdCursor::getErrorMessage
+*
+* @description: returns why the walk stopped early
+*
+* @input: none
+*
+* @output: error message, empty if no error occurred
+*
+*--*/
+const std::string& twitIdCursor::getErrorMessage()
+{
+    return m_errorMessage;
+}
+
+/*++
+* @method: twitIdCursor::startFetch
+*
+* @description: fetches a page in the background. this is an internal method.
+*
+* @input: cursor - cursor of the page
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitIdCursor::startFetch( const std::string& cursor )
+{
+    m_prefetch = std::async( std::launch::async, [this, cursor]()
+    {
+        return fetchPage( cursor, m_prefetchPage, m_prefetchError );
+    } );
+}
+
+/*++
+* @method: twitIdCursor::requestPage
+*
+* @description: issues the request of the walked endpoint. this is an
+*               internal method.
+*
+* @input: cursor - cursor of the page
+*
+* @output: true if the request completed
+*
+* @remarks: internal method
+*
+*--*/
+bool twitIdCursor::requestPage( const std::string& cursor )
+{
+    switch( m_source )
+    {
+    case eTwitIdCursorFriendsIds:
+        return m_twit->friendsIdsGet( cursor, m_userInfo, m_isUserId );
+    case eTwitIdCursorFollowersIds:
+        return m_twit->followersIdsGet( cursor, m_userInfo, m_isUserId );
+    case eTwitIdCursorBlockIds:
+        return m_twit->blockIdsGet( cursor, true );
+    case eTwitIdCursorBlockList:
+        return m_twit->blockListGet( cursor, false, true );
+    }
+    return false;
+}
+
+/*++
+* @method: twitIdCursor::fetchPage
+*
+* @description: fetches and decodes one page, waiting on the rate budget and
+*               retrying rate limited requests. runs on the prefetch thread.
+*               this is an internal method.
+*
+* @input: cursor - cursor of the page
+*
+* @output: outPage - decoded page,
+*          outError - reason of failure,
+*          true if the page was fetched
+*
+* @remarks: internal method
+*
+*--*/
+bool twitIdCursor::fetchPage( const std::string& cursor, twitIdPage& outPage, std::string& outError )
+{
+    std::string response;
+    for( int attempt = 0; attempt < TWITCURSOR_MAX_ATTEMPTS; ++attempt )
+    {
+        if( !m_budget->acquire( m_resource, &m_cancelled ) )
+        {
+            outError = "cancelled while waiting for the rate limit window";
+            return false;
+        }
+        if( !requestPage( cursor ) )
+        {
+            m_twit->getLastCurlError( outError );
+            return false;
+        }
+        if( !m_budget->recordResponse( m_resource, *m_twit ) )
+        {
+            /* Out of calls, wait for the window to reset and try again */
+            continue;
+        }
+        m_twit->takeLastWebResponse( response );
+        if( 200 != m_twit->getLastHttpStatus() )
+        {
+            outError = response;
+            return false;
+        }
+
+        outPage.ids.clear();
+        if( eTwitIdCursorBlockList != m_source )
+        {
+            if( !twitScanIdsResponse( response, outPage.ids, outPage.nextCursor ) )
+            {
+                outError = response;
+                return false;
+            }
+            return true;
+        }
+
+        /* blocks/list returns user objects, keep their ids */
+        picojson::value json;
+        std::string parseError = picojson::parse( json, response );
+        if( parseError.length() || !json.contains( "users" ) || !json.get( "users" ).is<picojson::array>() )
+        {
+            outError = parseError.length() ? parseError : response;
+            return false;
+        }
+        const picojson::array& users = json.get( "users" ).get<picojson::array>();
+        outPage.ids.reserve( users.size() );
+        for( size_t i = 0; i < users.size(); ++i )
+        {
+            unsigned long long id = twitGetJsonId( users[i], "id" );
+            if( id )
+            {
+                outPage.ids.push_back( id );
+            }
+        }
+        unsigned long long nextCursor = twitGetJsonId( json, "next_cursor" );
+        outPage.nextCursor = std::to_string( nextCursor );
+        return true;
+    }
+    outError = "rate limited";
+    return false;
+}
+
+/*++
+* @method: twitSearchCursor::twitSearchCursor
+*
+* @description: constructor, starts fetching the first page right away
+*
+* @input: twitObj - authorized twitCurl object, it is cloned and not used
+*                   by the cursor afterwards,
+*         searchQuery - search query, url encoded as for twitCurl::search,
+*         maxTweets - number of tweets to stop after, 0 for no limit,
+*         oldestCreatedAt - time horizon, seconds since epoch; tweets
+*                           created before it end the walk, 0 for none,
+*         budget - rate budget shared with other users of the same
+*                  credentials, NULL to use a private one,
+*         pool - intern pool of the returned tweets' strings
+*
+* @output: none
+*
+*--*/
+twitSearchCursor::twitSearchCursor( twitCurl& twitObj, const std::string& searchQuery, size_t maxTweets,
+                                    unsigned long long oldestCreatedAt, twitRateBudget* budget, twitInternPool& pool ):
+m_twit( twitObj.clone() ),
+m_query( searchQuery ),
+m_maxTweets( maxTweets ),
+m_oldestCreatedAt( oldestCreatedAt ),
+m_budget( budget ? budget : &m_ownBudget ),
+m_pool( pool ),
+m_seenFilter( NULL ),
+m_cancelled( false ),
+m_tweetCount( 0 ),
+m_done( false )
+{
+    startFetch( 0 );
+}
+
+/*++
+* @method: twitSearchCursor::~twitSearchCursor
+*
+* @description: destructor, abandons a prefetch waiting on the rate budget
+*               and waits for a request already on the wire
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitSearchCursor::~twitSearchCursor()
+{
+    m_cancelled = true;
+    if( m_prefetch.valid() )
+    {
+        m_prefetch.wait();
+    }
+}
+
+/*++
+* @method: twitSearchCursor::setSeenFilter
+*
+* @description: sets a filter consulted before tweets are returned, so that
+*               repeated searches over overlapping windows return each tweet
+*               once. dropped tweets do not count towards maxTweets.
+*
+* @input: seenFilter - filter, may be shared with other pollers and must
+*                      outlive the cursor; NULL for none
+*
+* @output: none
+*
+*--*/
+void twitSearchCursor::setSeenFilter( twitSeenFilter* seenFilter )
+{
+    m_seenFilter = seenFilter;
+}
+
+/*++
+* @method: twitSearchCursor::next
+*
+* @description: returns the next page of results and starts fetching the one
+*               after it
+*
+* @input: none
+*
+* @output: outTweets - tweets of the page not returned before, newest first;
+*                      may be empty if the whole page was already seen,
+*          true if a page was returned, false once the walk ended or on
+*          error; use getErrorMessage() to tell the two apart
+*
+*--*/
+bool twitSearchCursor::next( std::vector<twitTweet>& outTweets )
+{
+    outTweets.clear();
+    if( m_done || !m_prefetch.valid() )
+    {
+        return false;
+    }
+    if( !m_prefetch.get() )
+    {
+        m_errorMessage = m_prefetchError;
+        m_done = true;
+        return false;
+    }
+
+    /* Pages overlap when tweets arrive while paging, drop the repeats */
+    std::unordered_set<unsigned long long> pageIds;
+    bool reachedHorizon = false;
+    std::vector<twitTweet>& tweets = m_prefetchPage.tweets;
+    for( size_t i = 0; i < tweets.size(); ++i )
+    {
+        if( m_oldestCreatedAt && tweets[i].createdAt && tweets[i].createdAt < m_oldestCreatedAt )
+        {
+            reachedHorizon = true;
+            continue;
+        }
+        if( m_lastPageIds.count( tweets[i].id ) || !pageIds.insert( tweets[i].id ).second )
+        {
+            continue;
+        }
+        if( m_maxTweets && m_tweetCount >= m_maxTweets )
+        {
+            break;
+        }
+        if( m_seenFilter && m_seenFilter->testAndInsert( tweets[i].id ) )
+        {
+            continue;
+        }
+        outTweets.push_back( tweets[i] );
+        ++m_tweetCount;
+    }
+    m_lastPageIds.swap( pageIds );
+    tweets.clear();
+
+    unsigned long long nextMaxId = m_prefetchPage.nextMaxId;
+    if( !nextMaxId || reachedHorizon || ( m_maxTweets && m_tweetCount >= m_maxTweets ) )
+    {
+        m_done = true;
+    }
+    else
+    {
+        startFetch( nextMaxId );
+    }
+    return true;
+}
+
+/*++
+* @method: twitSearchCursor::isDone
+*
+* @description: tells whether next() will return another page
+*
+* @input: none
+*
+* @output: true once the walk ended or an error occurred
+*
+*--*/
+bool twitSearchCursor::isDone()
+{
+    return m_done;
+}
+
+/*++
+* @method: twitSearchCursor::getTweetCount
+*
+* @description: returns the number of tweets returned so far
+*
+* @input: none
+*
+* @output: tweet count
+*
+*--*/
+size_t twitSearchCursor::getTweetCount()
+{
+    return m_tweetCount;
+}
+
+/*++
+* @method: twitSearchCursor::getErrorMessage
+*
+* @description: returns why the walk stopped early
+*
+* @input: none
+*
+* @output: error message, empty if no error occurred
+*
+*--*/
+const std::string& twitSearchCursor::getErrorMessage()
+{
+    return m_errorMessage;
+}
+
+/*++
+* @method: twitSearchCursor::startFetch
+*
+* @description: fetches a page in the background. this is an internal method.
+*
+* @input: maxId - max id of the page, 0 for the first page
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitSearchCursor::startFetch( unsigned long long maxId )
+{
+    m_prefetch = std::async( std::launch::async, [this, maxId]()
+    {
+        return fetchPage( maxId, m_prefetchPage, m_prefetchError );
+    } );
+}
+
+/*++
+* @method: twitSearchCursor::fetchPage
+*
+* @description: fetches and decodes one page of results, waiting on the rate
+*               budget and retrying rate limited requests. runs on the
+*               prefetch thread. this is an internal method.
+*
+* @input: maxId - max id of the page, 0 for the first page
+*
+* @output: outPage - decoded page,
+*          outError - reason of failure,
+*          true if the page was fetched
+*
+* @remarks: internal method
+*
+*--*/
+bool twitSearchCursor::fetchPage( unsigned long long maxId, twitSearchPage& outPage, std::string& outError )
+{
+    const std::string& resource = twitRateResources::TWITRATE_SEARCH_TWEETS;
+    std::string response;
+    for( int attempt = 0; attempt < TWITCURSOR_MAX_ATTEMPTS; ++attempt )
+    {
+        if( !m_budget->acquire( resource, &m_cancelled ) )
+        {
+            outError = "cancelled while waiting for the rate limit window";
+            return false;
+        }
+        if( !m_twit->search( m_query, twitSearchDefaults::TWITSEARCH_PAGE_SIZE, maxId ? std::to_string( maxId ) : "" ) )
+        {
+            m_twit->getLastCurlError( outError );
+            return false;
+        }
+        if( !m_budget->recordResponse( resource, *m_twit ) )
+        {
+            continue;
+        }
+        m_twit->takeLastWebResponse( response );
+        if( 200 != m_twit->getLastHttpStatus() )
+        {
+            outError = response;
+            return false;
+        }
+
+        picojson::value json;
+        std::string parseError = picojson::parse( json, response );
+        if( parseError.length() || !json.is<picojson::object>() )
+        {
+            outError = parseError.length() ? parseError : response;
+            return false;
+        }
+        outPage.tweets.clear();
+        twitParseTweets( json, outPage.tweets, m_pool );
+
+        /* next_results is "?max_id=...&q=...", absent on the last page */
+        outPage.nextMaxId = 0;
+        if( json.contains( "search_metadata" ) && json.get( "search_metadata" ).contains( "next_results" ) &&
+            json.get( "search_metadata" ).get( "next_results" ).is<std::string>() )
+        {
+            const std::string& nextResults = json.get( "search_metadata" ).get( "next_results" ).get<std::string>();
+            size_t pos = nextResults.find( twitCurlDefaults::TWITCURL_MAXID );
+            if( std::string::npos != pos )
+            {
+                outPage.nextMaxId = twitParseId( nextResults.substr( pos + twitCurlDefaults::TWITCURL_MAXID.size(),
+                                                                     nextResults.find( '&', pos ) - pos - twitCurlDefaults::TWITCURL_MAXID.size() ) );
+            }
+        }
+        if( maxId && outPage.nextMaxId >= maxId )
+        {
+            /* Not moving backwards, stop rather than loop */
+            outPage.nextMaxId = 0;
+        }
+        return true;
+    }
+    outError = "rate limited";
+    return false;
+}
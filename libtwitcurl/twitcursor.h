@@ -0,0 +1,151 @@
+#ifndef _TWITCURSOR_H_
+#define _TWITCURSOR_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <unordered_set>
+#include "twitcurl.h"
+#include "twitidkernels.h"
+#include "twitmodel.h"
+#include "twitratelimit.h"
+#include "twitseenfilter.h"
+
+/* Cursored endpoints twitIdCursor can walk */
+enum eTwitIdCursorSource
+{
+    eTwitIdCursorFriendsIds = 0,
+    eTwitIdCursorFollowersIds,
+    eTwitIdCursorBlockIds,
+    eTwitIdCursorBlockList
+};
+
+/* One page of a cursored id list */
+struct twitIdPage
+{
+    std::vector<unsigned long long> ids;
+    std::string nextCursor;     /* "0" on the last page */
+
+    const unsigned long long* data() const { return ids.empty() ? NULL : &ids[0]; }
+    size_t size() const { return ids.size(); }
+};
+
+/* twitIdCursor class
+*
+* Walks every page of friends/ids, followers/ids, blocks/ids or blocks/list.
+* While the caller works on page N, page N+1 is already being fetched on a
+* clone of the twitCurl object passed in, so the connection is never idle
+* between pages. Calls are taken from a twitRateBudget, and rate limited
+* responses are retried once the window resets.
+*/
+class twitIdCursor
+{
+public:
+    twitIdCursor( twitCurl& twitObj /* in */,
+                  const eTwitIdCursorSource source /* in */,
+                  const std::string& userInfo = "" /* in */,
+                  const bool isUserId = false /* in */,
+                  twitRateBudget* budget = NULL /* in */ );
+    ~twitIdCursor();
+
+    bool next( twitIdPage& outPage /* out */ );
+    bool isDone();
+    const std::string& getErrorMessage();
+
+private:
+    std::unique_ptr<twitCurl> m_twit;
+    eTwitIdCursorSource m_source;
+    std::string m_userInfo;
+    bool m_isUserId;
+    std::string m_resource;
+    twitRateBudget m_ownBudget;
+    twitRateBudget* m_budget;
+
+    std::future<bool> m_prefetch;
+    twitIdPage m_prefetchPage;
+    std::string m_prefetchError;
+    std::atomic<bool> m_cancelled;
+    bool m_done;
+    std::string m_errorMessage;
+
+    void startFetch( const std::string& cursor );
+    bool fetchPage( const std::string& cursor, twitIdPage& outPage, std::string& outError );
+    bool requestPage( const std::string& cursor );
+
+    twitIdCursor( const twitIdCursor& );
+    twitIdCursor& operator=( const twitIdCursor& );
+};
+
+namespace twitSearchDefaults
+{
+    const std::string TWITSEARCH_PAGE_SIZE = "100";
+};
+
+/* One page of search results */
+struct twitSearchPage
+{
+    std::vector<twitTweet> tweets;
+    unsigned long long nextMaxId;   /* 0 on the last page */
+};
+
+/* twitSearchCursor class
+*
+* Walks the pages of a search by following the max_id of
+* search_metadata.next_results. Like twitIdCursor, the next page is fetched
+* on a clone of the twitCurl object while the caller works on the current
+* one. Tweets already returned on the previous page are dropped, and so are
+* those a seen filter knows about, if one is set. The walk
+* ends after maxTweets tweets, or at the first tweet older than the time
+* horizon, whichever comes first.
+*/
+class twitSearchCursor
+{
+public:
+    twitSearchCursor( twitCurl& twitObj /* in */,
+                      const std::string& searchQuery /* in */,
+                      size_t maxTweets = 0 /* in */,
+                      unsigned long long oldestCreatedAt = 0 /* in */,
+                      twitRateBudget* budget = NULL /* in */,
+                      twitInternPool& pool = twitInternPool::global() /* in */ );
+    ~twitSearchCursor();
+
+    void setSeenFilter( twitSeenFilter* seenFilter /* in */ );
+    bool next( std::vector<twitTweet>& outTweets /* out */ );
+    bool isDone();
+    size_t getTweetCount();
+    const std::string& getErrorMessage();
+
+private:
+    std::unique_ptr<twitCurl> m_twit;
+    std::string m_query;
+    size_t m_maxTweets;
+    unsigned long long m_oldestCreatedAt;
+    twitRateBudget m_ownBudget;
+    twitRateBudget* m_budget;
+    twitInternPool& m_pool;
+    twitSeenFilter* m_seenFilter;
+
+    std::future<bool> m_prefetch;
+    twitSearchPage m_prefetchPage;
+    std::string m_prefetchError;
+    std::atomic<bool> m_cancelled;
+    std::unordered_set<unsigned long long> m_lastPageIds;
+    size_t m_tweetCount;
+    bool m_done;
+    std::string m_errorMessage;
+
+    void startFetch( unsigned long long maxId );
+    bool fetchPage( unsigned long long maxId, twitSearchPage& outPage, std::string& outError );
+
+    twitSearchCursor( const twitSearchCursor& );
+    twitSearchCursor& operator=( const twitSearchCursor& );
+};
+
+/* Scans a cursored ids response without building a JSON tree */
+bool twitScanIdsResponse( const std::string& response /* in */,
+                          std::vector<unsigned long long>& outIds /* out */,
+                          std::string& outNextCursor /* out */ );
+
+#endif // _TWITCURSOR_H_
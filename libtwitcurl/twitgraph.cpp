@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <cstring>
+#include "twitgraph.h"
+#include "twitcursor.h"
+#include "twitidkernels.h"
+
+using namespace twitGraphFormat;
+
+/*++
+* @method: twitGraphWriter::twitGraphWriter
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitGraphWriter::twitGraphWriter():
+m_relation( eRelationFriends ),
+m_edgeCount( 0 )
+{
+}
+
+/*++
+* @method: twitGraphWriter::~twitGraphWriter
+*
+* @description: destructor, nodes added since the last finalize() are
+*               dropped and the graph file is left as it was
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitGraphWriter::~twitGraphWriter()
+{
+}
+
+/*++
+* @method: twitGraphWriter::open
+*
+* @description: starts a new graph. it replaces the graph file only once
+*               finalize() succeeds.
+*
+* @input: path - graph file,
+*         relation - what an edge means
+*
+* @output: errorMessage - reason of failure,
+*          true if created
+*
+*--*/
+bool twitGraphWriter::open( const std::string& path, twitGraphRelation relation, std::string& errorMessage )
+{
+    m_nodes.clear();
+    m_edgeCount = 0;
+    m_path = path;
+    m_relation = relation;
+
+    /* The header is only filled in by finalize() */
+    m_file.reset( new twitAtomicFile( path, true ) );
+    if( !m_file->stream() )
+    {
+        m_file.reset();
+        errorMessage = "cannot create " + path;
+        return false;
+    }
+    twitGraphHeader header;
+    memset( &header, 0, sizeof( header ) );
+    m_file->stream().write( (const char*)&header, sizeof( header ) );
+    return true;
+}
+
+/*++
+* @method: twitGraphWriter::append
+*
+* @description: starts a new session on a finalized graph file. its nodes
+*               are carried over, and adding one of them again replaces
+*               its edge list. the file is replaced once finalize()
+*               succeeds.
+*
+* @input: path - finalized graph file
+*
+* @output: errorMessage - reason of failure,
+*          true if the graph was read and can be added to
+*
+*--*/
+bool twitGraphWriter::append( const std::string& path, std::string& errorMessage )
+{
+    twitGraph graph;
+    if( !graph.open( path, errorMessage ) || !open( path, graph.getRelation(), errorMessage ) )
+    {
+        return false;
+    }
+
+    /* Copying the lists also drops those replaced in earlier sessions */
+    const unsigned long long* nodeIds = graph.getNodeIds();
+    for( size_t i = 0; i < graph.getNodeCount(); ++i )
+    {
+        const unsigned long long* edges = NULL;
+        size_t count = 0;
+        graph.getEdges( nodeIds[i], edges, count );
+
+        twitGraphNode node;
+        node.id = nodeIds[i];
+        node.begin = m_edgeCount;
+        node.end = m_edgeCount + count;
+        node.sequence = m_nodes.size();
+        if( count )
+        {
+            m_file->stream().write( (const char*)edges, (std::streamsize)( count * sizeof( unsigned long long ) ) );
+        }
+        m_nodes.push_back( node );
+        m_edgeCount = node.end;
+    }
+    if( !m_file->stream() )
+    {
+        m_file.reset();
+        errorMessage = "write failed on " + m_path;
+        return false;
+    }
+    return true;
+}
+
+/*++
+* @method: twitGraphWriter::addNode
+*
+* @description: appends the edge list of a node. adding a node again
+*               replaces its earlier list.
+*
+* @input: nodeId - node id,
+*         edges - ids the node is connected to, any order, sorted and
+*                 deduplicated in place
+*
+* @output: errorMessage - reason of failure,
+*          true if written
+*
+*--*/
+bool twitGraphWriter::addNode( unsigned long long nodeId, std::vector<unsigned long long>& edges, std::string& errorMessage )
+{
+    if( !m_file )
+    {
+        errorMessage = "graph file is not open";
+        return false;
+    }
+    std::sort( edges.begin(), edges.end() );
+    edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+
+    twitGraphNode node;
+    node.id = nodeId;
+    node.begin = m_edgeCount;
+    node.end = m_edgeCount + edges.size();
+    node.sequence = m_nodes.size();
+    std::ostream& out = m_file->stream();
+    if( edges.size() )
+    {
+        out.write( (const char*)&edges[0], (std::streamsize)( edges.size() * sizeof( unsigned long long ) ) );
+    }
+    if( !out )
+    {
+        errorMessage = "write failed on " + m_path;
+        return false;
+    }
+    m_nodes.push_back( node );
+    m_edgeCount = node.end;
+    return true;
+}
+
+/*++
+* @method: twitGraphWriter::addNode
+*
+* @description: walks a cursor and appends everything it returns as the
+*               edge list of a node
+*
+* @input: nodeId - node id, normally the user the cursor walks,
+*         cursor - cursor that was not walked yet
+*
+* @output: errorMessage - reason of failure,
+*          true if the cursor was walked and the list written
+*
+*--*/
+bool twitGraphWriter::addNode( unsigned long long nodeId, twitIdCursor& cursor, std::string& errorMessage )
+{
+    std::vector<unsigned long long> edges;
+    twitIdPage page;
+    while( cursor.next( page ) )
+    {
+        edges.insert( edges.end(), page.ids.begin(), page.ids.end() );
+    }
+    if( cursor.getErrorMessage().length() )
+    {
+        errorMessage = cursor.getErrorMessage();
+        return false;
+    }
+    return addNode( nodeId, edges, errorMessage );
+}
+
+/*++
+* @method: twitGraphWriter::finalize
+*
+* @description: writes the node table and the header and puts the file in
+*               place of the graph file. readers that mapped the old one
+*               keep it.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if the file is complete
+*
+*--*/
+bool twitGraphWriter::finalize( std::string& errorMessage )
+{
+    if( !m_file )
+    {
+        errorMessage = "graph file is not open";
+        return false;
+    }
+
+    /* Sort by id, keeping only the last list added for each node */
+    std::vector<twitGraphNode>& nodes = m_nodes;
+    std::sort( nodes.begin(), nodes.end(), []( const twitGraphNode& a, const twitGraphNode& b )
+    {
+        return ( a.id != b.id ) ? a.id < b.id : a.sequence < b.sequence;
+    } );
+    size_t kept = 0;
+    for( size_t i = 0; i < nodes.size(); ++i )
+    {
+        if( i + 1 < nodes.size() && nodes[i + 1].id == nodes[i].id )
+        {
+            continue;
+        }
+        nodes[kept++] = nodes[i];
+    }
+    nodes.resize( kept );
+
+    std::vector<unsigned long long> column( nodes.size() );
+    for( int pass = 0; pass < 3; ++pass )
+    {
+        for( size_t i = 0; i < nodes.size(); ++i )
+        {
+            column[i] = ( 0 == pass ) ? nodes[i].id : ( 1 == pass ) ? nodes[i].begin : nodes[i].end;
+        }
+        if( column.size() )
+        {
+            m_file->stream().write( (const char*)&column[0], (std::streamsize)( column.size() * sizeof( unsigned long long ) ) );
+        }
+    }
+
+    twitGraphHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, MAGIC, sizeof( header.magic ) );
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.relation = m_relation;
+    header.nodeCount = nodes.size();
+    header.edgeCount = m_edgeCount;
+    m_file->stream().seekp( 0 );
+    m_file->stream().write( (const char*)&header, sizeof( header ) );
+    bool committed = m_file->commit( errorMessage );
+    m_file.reset();
+    m_nodes.clear();
+    return committed;
+}
+
+/*++
+* @method: twitGraph::twitGraph
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitGraph::twitGraph():
+m_relation( eRelationFriends ),
+m_nodeCount( 0 ),
+m_edgeCount( 0 ),
+m_edges( NULL ),
+m_nodeIds( NULL ),
+m_edgeBegin( NULL ),
+m_edgeEnd( NULL )
+{
+}
+
+/*++
+* @method: twitGraph::open
+*
+* @description: maps a graph file and validates its layout
+*
+* @input: path - graph file
+*
+* @output: errorMessage - reason of failure, true if the graph is usable
+*
+*--*/
+bool twitGraph::open( const std::string& path, std::string& errorMessage )
+{
+    close();
+    errorMessage.clear();
+    if( !m_file.open( path ) )
+    {
+        errorMessage = "cannot map " + path;
+        return false;
+    }
+
+    const char* data = m_file.getData();
+    const size_t fileSize = m_file.getSize();
+    if( fileSize < sizeof( twitGraphHeader ) )
+    {
+        errorMessage = "graph file is truncated";
+        close();
+        return false;
+    }
+    const twitGraphHeader* header = (const twitGraphHeader*)data;
+    if( memcmp( header->magic, MAGIC, sizeof( header->magic ) ) != 0 )
+    {
+        errorMessage = "not a graph file, or not finalized";
+    }
+    else if( header->byteOrderMark != BYTE_ORDER_MARK )
+    {
+        errorMessage = "graph file was written with a different byte order";
+    }
+    else if( header->version != VERSION )
+    {
+        errorMessage = "unsupported graph file version";
+    }
+    else if( header->edgeCount > fileSize / sizeof( unsigned long long ) ||
+             header->nodeCount > fileSize / sizeof( unsigned long long ) ||
+             sizeof( twitGraphHeader ) + ( header->edgeCount + 3 * header->nodeCount ) * sizeof( unsigned long long ) != fileSize )
+    {
+        errorMessage = "graph file size does not match its header";
+    }
+    if( errorMessage.length() )
+    {
+        close();
+        return false;
+    }
+
+    const unsigned long long* words = (const unsigned long long*)( data + sizeof( twitGraphHeader ) );
+    m_relation = (twitGraphRelation)header->relation;
+    m_nodeCount = (size_t)header->nodeCount;
+    m_edgeCount = header->edgeCount;
+    m_edges = words;
+    m_nodeIds = m_edges + m_edgeCount;
+    m_edgeBegin = m_nodeIds + m_nodeCount;
+    m_edgeEnd = m_edgeBegin + m_nodeCount;
+
+    for( size_t i = 0; i < m_nodeCount; ++i )
+    {
+        if( m_edgeBegin[i] > m_edgeEnd[i] || m_edgeEnd[i] > m_edgeCount || ( i && m_nodeIds[i - 1] >= m_nodeIds[i] ) )
+        {
+            errorMessage = "graph node table is corrupt";
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+/*++
+* @method: twitGraph::close
+*
+* @description: unmaps the graph. edge lists handed out before become
+*               invalid.
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitGraph::close()
+{
+    m_file.close();
+    m_nodeCount = 0;
+    m_edgeCount = 0;
+    m_edges = NULL;
+    m_nodeIds = NULL;
+    m_edgeBegin = NULL;
+    m_edgeEnd = NULL;
+}
+
+/*++
+* @method: twitGraph::getEdges
+*
+* @description: returns the edge list of a node
+*
+* @input: nodeId - node id
+*
+* @output: outEdges - sorted ids, pointing into the mapped file,
+*          outCount - number of ids,
+*          true if the node is in the graph
+*
+*--*/
+bool twitGraph::getEdges( unsigned long long nodeId, const unsigned long long*& outEdges, size_t& outCount ) const
+{
+    outEdges = NULL;
+    outCount = 0;
+    const unsigned long long* end = m_nodeIds + m_nodeCount;
+    const unsigned long long* it = std::lower_bound( m_nodeIds, end, nodeId );
+    if( it == end || *it != nodeId )
+    {
+        return false;
+    }
+    size_t index = it - m_nodeIds;
+    outEdges = m_edges + m_edgeBegin[index];
+    outCount = (size_t)( m_edgeEnd[index] - m_edgeBegin[index] );
+    return true;
+}
+
+/*++
+* @method: twitGraph::hasEdge
+*
+* @description: tells whether a node's edge list holds an id
+*
+* @input: fromId - node id,
+*         toId - id to look for
+*
+* @output: true if found
+*
+*--*/
+bool twitGraph::hasEdge( unsigned long long fromId, unsigned long long toId ) const
+{
+    const unsigned long long* edges = NULL;
+    size_t count = 0;
+    if( !getEdges( fromId, edges, count ) )
+    {
+        return false;
+    }
+    return std::binary_search( edges, edges + count, toId );
+}
+
+/*++
+* @method: twitGraph::commonEdges
+*
+* @description: returns the ids in the edge lists of both nodes, e.g. the
+*               accounts both users follow in a friends graph
+*
+* @input: firstId, secondId - node ids
+*
+* @output: outIds - common ids, ascending,
+*          number of common ids
+*
+*--*/
+size_t twitGraph::commonEdges( unsigned long long firstId, unsigned long long secondId,
+                               std::vector<unsigned long long>& outIds ) const
+{
+    outIds.clear();
+    const unsigned long long* first = NULL;
+    const unsigned long long* second = NULL;
+    size_t firstCount = 0;
+    size_t secondCount = 0;
+    if( getEdges( firstId, first, firstCount ) && getEdges( secondId, second, secondCount ) )
+    {
+        outIds.resize( std::min( firstCount, secondCount ) );
+        outIds.resize( twitIntersectIds( first, firstCount, second, secondCount, outIds.data() ) );
+    }
+    return outIds.size();
+}
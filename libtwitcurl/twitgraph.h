@@ -0,0 +1,139 @@
+#ifndef _TWITGRAPH_H_
+#define _TWITGRAPH_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "twitatomicfile.h"
+#include "twitmmap.h"
+
+class twitIdCursor;
+
+/* Graph file layout (version 1, host byte order, checked on open)
+*
+*   header      magic "TWITGRPH", version, byte order mark, relation,
+*               node count, edge count
+*   edges       uint64 ids, the sorted edge list of each node in the order
+*               the nodes were added
+*   node ids    uint64, ascending
+*   edge begin  uint64 index into edges of each node's first edge
+*   edge end    uint64 index past each node's last edge
+*
+* This is CSR adjacency with separate begin and end offsets, which lets the
+* writer stream edge lists to disk as they are crawled and sort only the
+* small node table when it finishes. Readers map the file and use it in
+* place.
+*/
+namespace twitGraphFormat
+{
+    const char MAGIC[8] = { 'T', 'W', 'I', 'T', 'G', 'R', 'P', 'H' };
+    const unsigned int VERSION = 1;
+    const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+    enum twitGraphRelation
+    {
+        eRelationFriends = 0,       /* node follows its edges */
+        eRelationFollowers,         /* node is followed by its edges */
+        eRelationOther
+    };
+
+    struct twitGraphHeader
+    {
+        char magic[8];
+        unsigned int version;
+        unsigned int byteOrderMark;
+        unsigned int relation;
+        unsigned int reserved;
+        unsigned long long nodeCount;
+        unsigned long long edgeCount;
+    };
+};
+
+/* twitGraphWriter class
+*
+* Writes a graph file one node at a time. Edge lists go to a temporary file
+* as they are added; only the node table is kept in memory until
+* finalize() puts the file in place. Until then the graph file, which
+* readers may have mapped, is left as it was, and a crash loses only the
+* nodes added since the last finalize(). append() starts a new session on a
+* finalized file, so a crawl can add to it across sessions.
+*/
+class twitGraphWriter
+{
+public:
+    twitGraphWriter();
+    ~twitGraphWriter();
+
+    bool open( const std::string& path /* in */,
+               twitGraphFormat::twitGraphRelation relation /* in */,
+               std::string& errorMessage /* out */ );
+    bool append( const std::string& path /* in */, std::string& errorMessage /* out */ );
+    bool addNode( unsigned long long nodeId /* in */,
+                  std::vector<unsigned long long>& edges /* in, sorted in place */,
+                  std::string& errorMessage /* out */ );
+    bool addNode( unsigned long long nodeId /* in */,
+                  twitIdCursor& cursor /* in */,
+                  std::string& errorMessage /* out */ );
+    bool finalize( std::string& errorMessage /* out */ );
+
+private:
+    struct twitGraphNode
+    {
+        unsigned long long id;
+        unsigned long long begin;
+        unsigned long long end;
+        unsigned long long sequence;    /* later additions of a node win */
+    };
+
+    std::unique_ptr<twitAtomicFile> m_file;
+    std::string m_path;
+    twitGraphFormat::twitGraphRelation m_relation;
+    std::vector<twitGraphNode> m_nodes;
+    unsigned long long m_edgeCount;
+
+    twitGraphWriter( const twitGraphWriter& );
+    twitGraphWriter& operator=( const twitGraphWriter& );
+};
+
+/* twitGraph class
+*
+* Read-only view of a graph file. Edge lists are sorted, so membership is a
+* binary search and common neighbours are a merge of two lists, all on the
+* mapped pages; the operating system only pages in what a query touches.
+*/
+class twitGraph
+{
+public:
+    twitGraph();
+
+    bool open( const std::string& path /* in */, std::string& errorMessage /* out */ );
+    void close();
+
+    twitGraphFormat::twitGraphRelation getRelation() const { return m_relation; }
+    size_t getNodeCount() const { return m_nodeCount; }
+    unsigned long long getEdgeCount() const { return m_edgeCount; }
+    const unsigned long long* getNodeIds() const { return m_nodeIds; }
+
+    bool getEdges( unsigned long long nodeId /* in */,
+                   const unsigned long long*& outEdges /* out */,
+                   size_t& outCount /* out */ ) const;
+    bool hasEdge( unsigned long long fromId /* in */, unsigned long long toId /* in */ ) const;
+    size_t commonEdges( unsigned long long firstId /* in */,
+                        unsigned long long secondId /* in */,
+                        std::vector<unsigned long long>& outIds /* out */ ) const;
+
+private:
+    twitMappedFile m_file;
+    twitGraphFormat::twitGraphRelation m_relation;
+    size_t m_nodeCount;
+    unsigned long long m_edgeCount;
+    const unsigned long long* m_edges;
+    const unsigned long long* m_nodeIds;
+    const unsigned long long* m_edgeBegin;
+    const unsigned long long* m_edgeEnd;
+
+    twitGraph( const twitGraph& );
+    twitGraph& operator=( const twitGraph& );
+};
+
+#endif // _TWITGRAPH_H_
@@ -0,0 +1,275 @@
+#include <cstring>
+#include <vector>
+#include "twithash.h"
+#include "twitmediasource.h"
+
+namespace
+{
+    const unsigned long long PRIME1 = 0x9E3779B185EBCA87ULL;
+    const unsigned long long PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const unsigned long long PRIME3 = 0x165667B19E3779F9ULL;
+    const unsigned long long PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    const unsigned long long PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    /* Bytes hashed at a time by twitHashSource, and per fingerprint sample */
+    const size_t TWITHASH_READ_SIZE = 256 * 1024;
+    const size_t TWITHASH_SAMPLE_SIZE = 64 * 1024;
+    const unsigned int TWITHASH_SAMPLE_COUNT = 16;
+
+    unsigned long long rotl( unsigned long long x, int bits )
+    {
+        return ( x << bits ) | ( x >> ( 64 - bits ) );
+    }
+
+    /* Little endian loads, independent of alignment and host byte order */
+    unsigned long long read64( const unsigned char* p )
+    {
+        unsigned long long v = 0;
+        for( int i = 7; i >= 0; --i )
+        {
+            v = ( v << 8 ) | p[i];
+        }
+        return v;
+    }
+
+    unsigned long long read32( const unsigned char* p )
+    {
+        return (unsigned long long)p[0] | ( (unsigned long long)p[1] << 8 ) |
+               ( (unsigned long long)p[2] << 16 ) | ( (unsigned long long)p[3] << 24 );
+    }
+
+    unsigned long long round( unsigned long long acc, unsigned long long input )
+    {
+        acc += input * PRIME2;
+        acc = rotl( acc, 31 );
+        return acc * PRIME1;
+    }
+
+    unsigned long long mergeRound( unsigned long long acc, unsigned long long lane )
+    {
+        acc ^= round( 0, lane );
+        return acc * PRIME1 + PRIME4;
+    }
+}
+
+/*++
+* @method: twitHasher::twitHasher
+*
+* @description: constructor
+*
+* @input: seed - hash seed, different seeds give unrelated hashes
+*
+* @output: none
+*
+*--*/
+twitHasher::twitHasher( unsigned long long seed ):
+m_seed( seed ),
+m_length( 0 ),
+m_pendingLength( 0 )
+{
+    m_lanes[0] = seed + PRIME1 + PRIME2;
+    m_lanes[1] = seed + PRIME2;
+    m_lanes[2] = seed;
+    m_lanes[3] = seed - PRIME1;
+}
+
+/*++
+* @method: twitHasher::update
+*
+* @description: adds bytes to the hash
+*
+* @input: data - bytes,
+*         length - byte count
+*
+* @output: none
+*
+*--*/
+void twitHasher::update( const void* data, size_t length )
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + length;
+    m_length += length;
+
+    if( m_pendingLength + length < sizeof( m_pending ) )
+    {
+        if( length )
+        {
+            memcpy( m_pending + m_pendingLength, p, length );
+        }
+        m_pendingLength += length;
+        return;
+    }
+    if( m_pendingLength )
+    {
+        size_t fill = sizeof( m_pending ) - m_pendingLength;
+        memcpy( m_pending + m_pendingLength, p, fill );
+        p += fill;
+        for( int i = 0; i < 4; ++i )
+        {
+            m_lanes[i] = round( m_lanes[i], read64( m_pending + 8 * i ) );
+        }
+        m_pendingLength = 0;
+    }
+    while( p + 32 <= end )
+    {
+        m_lanes[0] = round( m_lanes[0], read64( p ) );
+        m_lanes[1] = round( m_lanes[1], read64( p + 8 ) );
+        m_lanes[2] = round( m_lanes[2], read64( p + 16 ) );
+        m_lanes[3] = round( m_lanes[3], read64( p + 24 ) );
+        p += 32;
+    }
+    m_pendingLength = end - p;
+    if( m_pendingLength )
+    {
+        memcpy( m_pending, p, m_pendingLength );
+    }
+}
+
+/*++
+* @method: twitHasher::finish
+*
+* @description: returns the hash of the bytes added so far. more bytes may
+*               be added afterwards.
+*
+* @input: none
+*
+* @output: 64 bit hash
+*
+*--*/
+unsigned long long twitHasher::finish() const
+{
+    unsigned long long h;
+    if( m_length >= 32 )
+    {
+        h = rotl( m_lanes[0], 1 ) + rotl( m_lanes[1], 7 ) + rotl( m_lanes[2], 12 ) + rotl( m_lanes[3], 18 );
+        for( int i = 0; i < 4; ++i )
+        {
+            h = mergeRound( h, m_lanes[i] );
+        }
+    }
+    else
+    {
+        h = m_seed + PRIME5;
+    }
+    h += m_length;
+
+    const unsigned char* p = m_pending;
+    const unsigned char* end = m_pending + m_pendingLength;
+    for( ; p + 8 <= end; p += 8 )
+    {
+        h ^= round( 0, read64( p ) );
+        h = rotl( h, 27 ) * PRIME1 + PRIME4;
+    }
+    if( p + 4 <= end )
+    {
+        h ^= read32( p ) * PRIME1;
+        h = rotl( h, 23 ) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for( ; p < end; ++p )
+    {
+        h ^= *p * PRIME5;
+        h = rotl( h, 11 ) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*++
+* @method: twitHash64
+*
+* @description: hashes a buffer in one go
+*
+* @input: data - bytes,
+*         length - byte count,
+*         seed - hash seed
+*
+* @output: 64 bit hash
+*
+*--*/
+unsigned long long twitHash64( const void* data, size_t length, unsigned long long seed )
+{
+    twitHasher hasher( seed );
+    hasher.update( data, length );
+    return hasher.finish();
+}
+
+/*++
+* @method: twitHashSource
+*
+* @description: hashes every byte of a media source, in place when its bytes
+*               are in memory
+*
+* @input: source - media bytes
+*
+* @output: ok - false if the source ended early,
+*          64 bit hash
+*
+*--*/
+unsigned long long twitHashSource( twitMediaSource& source, bool& ok )
+{
+    const unsigned long long size = source.getSize();
+    if( source.getData() )
+    {
+        ok = true;
+        return twitHash64( source.getData(), (size_t)size );
+    }
+
+    twitHasher hasher;
+    std::vector<char> buffer( TWITHASH_READ_SIZE );
+    unsigned long long offset = 0;
+    while( offset < size )
+    {
+        size_t count = source.readAt( offset, &buffer[0], buffer.size() );
+        if( !count )
+        {
+            ok = false;
+            return 0;
+        }
+        hasher.update( &buffer[0], count );
+        offset += count;
+    }
+    ok = true;
+    return hasher.finish();
+}
+
+/*++
+* @method: twitFingerprintSource
+*
+* @description: hashes the size of a source and samples of its bytes taken
+*               at evenly spread positions, including its start and end
+*
+* @input: source - media bytes
+*
+* @output: 64 bit fingerprint
+*
+*--*/
+unsigned long long twitFingerprintSource( twitMediaSource& source )
+{
+    const unsigned long long size = source.getSize();
+    twitHasher hasher;
+    hasher.update( &size, sizeof( size ) );
+
+    std::vector<char> buffer( TWITHASH_SAMPLE_SIZE );
+    unsigned long long span = ( size > TWITHASH_SAMPLE_SIZE ) ? size - TWITHASH_SAMPLE_SIZE : 0;
+    for( unsigned int i = 0; i < TWITHASH_SAMPLE_COUNT; ++i )
+    {
+        unsigned long long offset = span / ( TWITHASH_SAMPLE_COUNT - 1 ) * i;
+        if( TWITHASH_SAMPLE_COUNT - 1 == i )
+        {
+            offset = span;
+        }
+        size_t count = source.readAt( offset, &buffer[0], buffer.size() );
+        hasher.update( &buffer[0], count );
+        if( !span )
+        {
+            break;
+        }
+    }
+    return hasher.finish();
+}
@@ -0,0 +1,42 @@
+#ifndef _TWITHASH_H_
+#define _TWITHASH_H_
+
+#include <cstddef>
+
+class twitMediaSource;
+
+/* twitHasher class
+*
+* Streaming 64 bit hash with the XXH64 algorithm: fast, well distributed,
+* and the same for any split of the input into update() calls. Not a
+* cryptographic hash; it identifies content, it does not authenticate it.
+*/
+class twitHasher
+{
+public:
+    explicit twitHasher( unsigned long long seed = 0 /* in */ );
+
+    void update( const void* data /* in */, size_t length /* in */ );
+    unsigned long long finish() const;
+
+private:
+    unsigned long long m_lanes[4];
+    unsigned long long m_seed;
+    unsigned long long m_length;
+    unsigned char m_pending[32];
+    size_t m_pendingLength;
+};
+
+/* Hash of a buffer */
+unsigned long long twitHash64( const void* data /* in */, size_t length /* in */, unsigned long long seed = 0 /* in */ );
+
+/* Hash of every byte of a source. ok is false if the source could not be
+   read to its end. */
+unsigned long long twitHashSource( twitMediaSource& source /* in */, bool& ok /* out */ );
+
+/* Quick fingerprint of a source from its size and evenly spread samples of
+   its bytes, cheap even for files of gigabytes. Tells apart different
+   files, not every edit within one. */
+unsigned long long twitFingerprintSource( twitMediaSource& source /* in */ );
+
+#endif // _TWITHASH_H_
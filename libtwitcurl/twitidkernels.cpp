@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "twitidkernels.h"
+
+/* The AVX2 kernel is built for every x86 target and picked at run time, so
+   a build for the baseline instruction set still uses it where it can */
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define TWITKERNEL_AVX2
+#define TWITKERNEL_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#include <immintrin.h>
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#define TWITKERNEL_AVX2
+#define TWITKERNEL_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    /* Galloping pays off once one list is this many times longer */
+    const size_t TWITKERNEL_GALLOP_RATIO = 32;
+
+    /* First position in [first, last) not less than id, searching forward
+       with doubling steps so that nearby hits stay cheap */
+    const unsigned long long* gallop( const unsigned long long* first, const unsigned long long* last, unsigned long long id )
+    {
+        size_t step = 1;
+        while( first + step < last && first[step] < id )
+        {
+            step <<= 1;
+        }
+        return std::lower_bound( first, std::min( first + step + 1, last ), id );
+    }
+
+#ifdef TWITKERNEL_AVX2
+    /* True if the CPU and the OS support AVX2 */
+    bool detectAvx2()
+    {
+#if defined( _MSC_VER )
+        int info[4];
+        __cpuid( info, 0 );
+        if( info[0] < 7 )
+        {
+            return false;
+        }
+        /* AVX registers must also be saved by the OS */
+        __cpuid( info, 1 );
+        const int osxsaveAndAvx = ( 1 << 27 ) | ( 1 << 28 );
+        if( ( info[2] & osxsaveAndAvx ) != osxsaveAndAvx || ( _xgetbv( 0 ) & 6 ) != 6 )
+        {
+            return false;
+        }
+        __cpuidex( info, 7, 0 );
+        return ( info[1] & ( 1 << 5 ) ) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+    }
+
+    bool hasAvx2()
+    {
+        static const bool supported = detectAvx2();
+        return supported;
+    }
+
+    /* Compare four ids of a with four of b in every rotation, then drop the
+       window with the smaller maximum. Matches of the current a window are
+       collected in mask until it is dropped. Leaves i, j and mask for the
+       scalar loop of visitMatches to finish. */
+    template <class Visitor>
+    TWITKERNEL_TARGET_AVX2
+    void visitWindowsAvx2( const unsigned long long* a, size_t aCount,
+                           const unsigned long long* b, size_t bCount, Visitor& visit,
+                           size_t& i, size_t& j, unsigned int& mask )
+    {
+        while( i + 4 <= aCount && j + 4 <= bCount )
+        {
+            __m256i va = _mm256_loadu_si256( (const __m256i*)( a + i ) );
+            __m256i vb = _mm256_loadu_si256( (const __m256i*)( b + j ) );
+            __m256i eq = _mm256_cmpeq_epi64( va, vb );
+            vb = _mm256_permute4x64_epi64( vb, _MM_SHUFFLE( 0, 3, 2, 1 ) );
+            eq = _mm256_or_si256( eq, _mm256_cmpeq_epi64( va, vb ) );
+            vb = _mm256_permute4x64_epi64( vb, _MM_SHUFFLE( 0, 3, 2, 1 ) );
+            eq = _mm256_or_si256( eq, _mm256_cmpeq_epi64( va, vb ) );
+            vb = _mm256_permute4x64_epi64( vb, _MM_SHUFFLE( 0, 3, 2, 1 ) );
+            eq = _mm256_or_si256( eq, _mm256_cmpeq_epi64( va, vb ) );
+            mask |= (unsigned int)_mm256_movemask_pd( _mm256_castsi256_pd( eq ) );
+
+            unsigned long long aMax = a[i + 3];
+            unsigned long long bMax = b[j + 3];
+            if( aMax <= bMax )
+            {
+                visit( i, ( mask & 1 ) != 0 );
+                visit( i + 1, ( mask & 2 ) != 0 );
+                visit( i + 2, ( mask & 4 ) != 0 );
+                visit( i + 3, ( mask & 8 ) != 0 );
+                i += 4;
+                mask = 0;
+            }
+            if( bMax <= aMax )
+            {
+                j += 4;
+            }
+        }
+    }
+#endif
+
+    /* Calls visit( i, matched ) for every id of a, in order, telling whether
+       it is also in b. Both lists are sorted and unique. */
+    template <class Visitor>
+    void visitMatches( const unsigned long long* a, size_t aCount,
+                       const unsigned long long* b, size_t bCount, Visitor& visit )
+    {
+        size_t i = 0;
+        size_t j = 0;
+        unsigned int mask = 0;
+#ifdef TWITKERNEL_AVX2
+        if( hasAvx2() )
+        {
+            visitWindowsAvx2( a, aCount, b, bCount, visit, i, j, mask );
+        }
+#endif
+        /* Ids of b already passed can only have matched the window in mask */
+        size_t window = i;
+        for( ; i < aCount; ++i )
+        {
+            while( j < bCount && b[j] < a[i] )
+            {
+                ++j;
+            }
+            bool inMask = ( i - window < 4 ) && ( ( mask >> ( i - window ) ) & 1 );
+            visit( i, inMask || ( j < bCount && b[j] == a[i] ) );
+        }
+    }
+
+    struct twitCollectMatches
+    {
+        const unsigned long long* ids;
+        unsigned long long* out;
+        size_t count;
+        bool wanted;                    /* true to collect matches, false for the rest */
+
+        void operator()( size_t i, bool matched )
+        {
+            if( matched == wanted )
+            {
+                out[count++] = ids[i];
+            }
+        }
+    };
+
+    struct twitCountMatches
+    {
+        size_t count;
+
+        void operator()( size_t, bool matched )
+        {
+            count += matched ? 1 : 0;
+        }
+    };
+
+    struct twitFlagMatches
+    {
+        unsigned char* matched;
+
+        void operator()( size_t i, bool isMatched )
+        {
+            matched[i] = isMatched ? 1 : 0;
+        }
+    };
+
+    /* Intersection of a short list with a much longer one */
+    template <class Visitor>
+    void gallopMatches( const unsigned long long* shortList, size_t shortCount,
+                        const unsigned long long* longList, size_t longCount, Visitor& visit )
+    {
+        const unsigned long long* cur = longList;
+        const unsigned long long* end = longList + longCount;
+        for( size_t i = 0; i < shortCount; ++i )
+        {
+            cur = gallop( cur, end, shortList[i] );
+            visit( i, cur < end && *cur == shortList[i] );
+        }
+    }
+}
+
+/*++
+* @method: twitSortIds
+*
+* @description: sorts ids and drops duplicates, making a list usable by the
+*               other kernels
+*
+* @input: ids - ids in any order
+*
+* @output: ids - sorted unique ids
+*
+*--*/
+void twitSortIds( std::vector<unsigned long long>& ids )
+{
+    std::sort( ids.begin(), ids.end() );
+    ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+}
+
+/*++
+* @method: twitIntersectIds
+*
+* @description: computes the ids in both lists
+*
+* @input: a, b - sorted unique ids,
+*         aCount, bCount - list sizes
+*
+* @output: out - common ids, ascending,
+*          number of common ids
+*
+*--*/
+size_t twitIntersectIds( const unsigned long long* a, size_t aCount,
+                         const unsigned long long* b, size_t bCount,
+                         unsigned long long* out )
+{
+    if( aCount > bCount )
+    {
+        std::swap( a, b );
+        std::swap( aCount, bCount );
+    }
+    twitCollectMatches collect = { a, out, 0, true };
+    if( !aCount )
+    {
+        return 0;
+    }
+    if( bCount / aCount >= TWITKERNEL_GALLOP_RATIO )
+    {
+        gallopMatches( a, aCount, b, bCount, collect );
+    }
+    else
+    {
+        visitMatches( a, aCount, b, bCount, collect );
+    }
+    return collect.count;
+}
+
+/*++
+* @method: twitIntersectCount
+*
+* @description: counts the ids in both lists
+*
+* @input: a, b - sorted unique ids,
+*         aCount, bCount - list sizes
+*
+* @output: number of common ids
+*
+*--*/
+size_t twitIntersectCount( const unsigned long long* a, size_t aCount,
+                           const unsigned long long* b, size_t bCount )
+{
+    if( aCount > bCount )
+    {
+        std::swap( a, b );
+        std::swap( aCount, bCount );
+    }
+    twitCountMatches counter = { 0 };
+    if( !aCount )
+    {
+        return 0;
+    }
+    if( bCount / aCount >= TWITKERNEL_GALLOP_RATIO )
+    {
+        gallopMatches( a, aCount, b, bCount, counter );
+    }
+    else
+    {
+        visitMatches( a, aCount, b, bCount, counter );
+    }
+    return counter.count;
+}
+
+/*++
+* @method: twitMergeIds
+*
+* @description: computes the ids in either list. when one list is much
+*               longer, the runs of it between ids of the short one are
+*               found by galloping and copied as blocks.
+*
+* @input: a, b - sorted unique ids,
+*         aCount, bCount - list sizes
+*
+* @output: out - union, ascending,
+*          number of ids in the union
+*
+*--*/
+size_t twitMergeIds( const unsigned long long* a, size_t aCount,
+                     const unsigned long long* b, size_t bCount,
+                     unsigned long long* out )
+{
+    if( aCount > bCount )
+    {
+        std::swap( a, b );
+        std::swap( aCount, bCount );
+    }
+    size_t count = 0;
+    const unsigned long long* cur = b;
+    const unsigned long long* end = b + bCount;
+
+    if( aCount && bCount / aCount >= TWITKERNEL_GALLOP_RATIO )
+    {
+        for( size_t i = 0; i < aCount; ++i )
+        {
+            const unsigned long long* next = gallop( cur, end, a[i] );
+            std::copy( cur, next, out + count );
+            count += next - cur;
+            out[count++] = a[i];
+            cur = ( next < end && *next == a[i] ) ? next + 1 : next;
+        }
+    }
+    else
+    {
+        size_t i = 0;
+        while( i < aCount && cur < end )
+        {
+            unsigned long long x = a[i];
+            unsigned long long y = *cur;
+            out[count++] = ( x < y ) ? x : y;
+            i += ( x <= y ) ? 1 : 0;
+            cur += ( y <= x ) ? 1 : 0;
+        }
+        std::copy( a + i, a + aCount, out + count );
+        count += aCount - i;
+    }
+    std::copy( cur, end, out + count );
+    return count + ( end - cur );
+}
+
+/*++
+* @method: twitDifferenceIds
+*
+* @description: computes the ids of a that are not in b
+*
+* @input: a - sorted unique ids to subtract from,
+*         b - sorted unique ids to remove,
+*         aCount, bCount - list sizes
+*
+* @output: out - difference, ascending,
+*          number of ids in the difference
+*
+*--*/
+size_t twitDifferenceIds( const unsigned long long* a, size_t aCount,
+                          const unsigned long long* b, size_t bCount,
+                          unsigned long long* out )
+{
+    twitCollectMatches collect = { a, out, 0, false };
+    if( aCount && bCount / aCount >= TWITKERNEL_GALLOP_RATIO )
+    {
+        gallopMatches( a, aCount, b, bCount, collect );
+    }
+    else
+    {
+        visitMatches( a, aCount, b, bCount, collect );
+    }
+    return collect.count;
+}
+
+/*++
+* @method: twitMatchIds
+*
+* @description: flags the ids of a that are also in b
+*
+* @input: a, b - sorted unique ids,
+*         aCount, bCount - list sizes
+*
+* @output: matched - 1 for each id of a found in b, 0 otherwise
+*
+*--*/
+void twitMatchIds( const unsigned long long* a, size_t aCount,
+                   const unsigned long long* b, size_t bCount,
+                   unsigned char* matched )
+{
+    twitFlagMatches flags = { matched };
+    visitMatches( a, aCount, b, bCount, flags );
+}
+
+/*++
+* @method: twitOverlapMatrix
+*
+* @description: counts the common ids of every pair of lists, replacing one
+*               friendshipShow call per pair with local work
+*
+* @input: sortedLists - sorted unique id lists,
+*         threadCount - number of threads sharing the rows
+*
+* @output: outCounts - N x N overlap counts, row major
+*
+*--*/
+void twitOverlapMatrix( const std::vector<std::vector<unsigned long long> >& sortedLists,
+                        std::vector<size_t>& outCounts, unsigned int threadCount )
+{
+    const size_t listCount = sortedLists.size();
+    outCounts.assign( listCount * listCount, 0 );
+    std::atomic<size_t> nextRow( 0 );
+
+    /* Each row fills ( i, j > i ) and its mirror, rows never share an entry */
+    auto fillRows = [&]()
+    {
+        for( size_t i = nextRow++; i < listCount; i = nextRow++ )
+        {
+            const std::vector<unsigned long long>& first = sortedLists[i];
+            outCounts[i * listCount + i] = first.size();
+            for( size_t j = i + 1; j < listCount; ++j )
+            {
+                const std::vector<unsigned long long>& second = sortedLists[j];
+                size_t common = ( first.empty() || second.empty() ) ? 0 :
+                                twitIntersectCount( &first[0], first.size(), &second[0], second.size() );
+                outCounts[i * listCount + j] = common;
+                outCounts[j * listCount + i] = common;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for( unsigned int t = 1; t < threadCount && t < listCount; ++t )
+    {
+        threads.push_back( std::thread( fillRows ) );
+    }
+    fillRows();
+    for( size_t t = 0; t < threads.size(); ++t )
+    {
+        threads[t].join();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef _TWITIDKERNELS_H_
+#define _TWITIDKERNELS_H_
+
+#include <cstddef>
+#include <vector>
+
+/* Kernels on sorted lists of unique 64 bit ids, as kept by twitIdSet and
+*  twitGraph or made from cursor pages with twitSortIds.
+*
+*  Intersections switch to galloping search when one list is much longer
+*  than the other and otherwise compare four ids at a time with AVX2 where
+*  the CPU supports it, checked at run time, falling back to a scalar
+*  merge. Output buffers
+*  are sized by the caller and must not alias the inputs.
+*/
+
+/* Sorts and deduplicates ids in place, e.g. ids collected from a cursor */
+void twitSortIds( std::vector<unsigned long long>& ids /* in, out */ );
+
+/* a & b, out needs room for min( aCount, bCount ) ids. returns the count */
+size_t twitIntersectIds( const unsigned long long* a /* in */, size_t aCount /* in */,
+                         const unsigned long long* b /* in */, size_t bCount /* in */,
+                         unsigned long long* out /* out */ );
+
+/* Size of a & b, without writing it out */
+size_t twitIntersectCount( const unsigned long long* a /* in */, size_t aCount /* in */,
+                           const unsigned long long* b /* in */, size_t bCount /* in */ );
+
+/* a | b, out needs room for aCount + bCount ids. returns the count */
+size_t twitMergeIds( const unsigned long long* a /* in */, size_t aCount /* in */,
+                     const unsigned long long* b /* in */, size_t bCount /* in */,
+                     unsigned long long* out /* out */ );
+
+/* a - b, out needs room for aCount ids. returns the count */
+size_t twitDifferenceIds( const unsigned long long* a /* in */, size_t aCount /* in */,
+                          const unsigned long long* b /* in */, size_t bCount /* in */,
+                          unsigned long long* out /* out */ );
+
+/* Flags each id of a found in b, matched needs room for aCount flags */
+void twitMatchIds( const unsigned long long* a /* in */, size_t aCount /* in */,
+                   const unsigned long long* b /* in */, size_t bCount /* in */,
+                   unsigned char* matched /* out */ );
+
+/* Overlap of every pair of N sorted lists, e.g. the follower lists of N
+   accounts. outCounts is N x N, row major; entry ( i, j ) is the size of
+   list i & list j and the diagonal holds the list sizes. */
+void twitOverlapMatrix( const std::vector<std::vector<unsigned long long> >& sortedLists /* in */,
+                        std::vector<size_t>& outCounts /* out */,
+                        unsigned int threadCount = 1 /* in */ );
+
+#endif // _TWITIDKERNELS_H_
@@ -0,0 +1,631 @@
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include "twitatomicfile.h"
+#include "twitidset.h"
+#include "twitcursor.h"
+#include "twitidkernels.h"
+
+namespace
+{
+    const char TWITIDSET_MAGIC[8] = { 'T', 'W', 'I', 'T', 'I', 'D', 'S', '1' };
+
+    /* Streams the ids of a set block by block */
+    struct twitIdSetReader
+    {
+        const twitIdSet& set;
+        size_t block;
+        size_t pos;
+        size_t length;
+        unsigned long long ids[twitIdSet::BLOCK_SIZE];
+
+        explicit twitIdSetReader( const twitIdSet& idSet ) : set( idSet ), block( 0 ), pos( 0 ), length( 0 )
+        {
+            refill();
+        }
+
+        bool done() const { return pos >= length; }
+        unsigned long long current() const { return ids[pos]; }
+
+        void advance()
+        {
+            if( ++pos >= length )
+            {
+                ++block;
+                refill();
+            }
+        }
+
+        void refill()
+        {
+            pos = 0;
+            length = ( block < set.getBlockCount() ) ? set.decodeBlock( block, ids ) : 0;
+        }
+    };
+}
+
+/*++
+* @method: twitIdSet::twitIdSet
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitIdSet::twitIdSet():
+m_size( 0 ),
+m_last( 0 )
+{
+}
+
+/*++
+* @method: twitIdSet::clear
+*
+* @description: removes all ids
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitIdSet::clear()
+{
+    m_bases.clear();
+    m_offsets.clear();
+    m_gaps.clear();
+    m_size = 0;
+    m_last = 0;
+}
+
+/*++
+* @method: twitIdSet::assign
+*
+* @description: replaces the set with the given ids
+*
+* @input: ids - ids in any order, duplicates allowed,
+*         count - number of ids
+*
+* @output: none
+*
+*--*/
+void twitIdSet::assign( const unsigned long long* ids, size_t count )
+{
+    std::vector<unsigned long long> sorted( ids, ids + count );
+    assign( sorted );
+}
+
+/*++
+* @method: twitIdSet::assign
+*
+* @description: replaces the set with the given ids, sorting them in place
+*               to avoid a copy
+*
+* @input: ids - ids in any order, duplicates allowed
+*
+* @output: none
+*
+*--*/
+void twitIdSet::assign( std::vector<unsigned long long>& ids )
+{
+    clear();
+    std::sort( ids.begin(), ids.end() );
+    ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+
+    m_bases.reserve( ( ids.size() + BLOCK_SIZE - 1 ) / BLOCK_SIZE );
+    m_offsets.reserve( m_bases.capacity() );
+    m_gaps.reserve( ids.size() * 3 );
+    for( size_t i = 0; i < ids.size(); ++i )
+    {
+        appendSorted( ids[i] );
+    }
+}
+
+/*++
+* @method: twitIdSet::fill
+*
+* @description: replaces the set with every id a cursor returns
+*
+* @input: cursor - cursor that was not walked yet
+*
+* @output: errorMessage - error of the cursor,
+*          true if all pages were walked
+*
+*--*/
+bool twitIdSet::fill( twitIdCursor& cursor, std::string& errorMessage )
+{
+    std::vector<unsigned long long> ids;
+    twitIdPage page;
+    while( cursor.next( page ) )
+    {
+        ids.insert( ids.end(), page.ids.begin(), page.ids.end() );
+    }
+    errorMessage = cursor.getErrorMessage();
+    if( errorMessage.length() )
+    {
+        return false;
+    }
+    assign( ids );
+    return true;
+}
+
+/*++
+* @method: twitIdSet::appendSorted
+*
+* @description: appends an id greater than every id of the set
+*
+* @input: id - id to append
+*
+* @output: none
+*
+*--*/
+void twitIdSet::appendSorted( unsigned long long id )
+{
+    if( 0 == m_size % BLOCK_SIZE )
+    {
+        m_bases.push_back( id );
+        m_offsets.push_back( (unsigned int)m_gaps.size() );
+    }
+    else
+    {
+        unsigned long long gap = id - m_last;
+        while( gap >= 0x80 )
+        {
+            m_gaps.push_back( (unsigned char)( gap | 0x80 ) );
+            gap >>= 7;
+        }
+        m_gaps.push_back( (unsigned char)gap );
+    }
+    m_last = id;
+    ++m_size;
+}
+
+/*++
+* @method: twitIdSet::contains
+*
+* @description: tells whether an id is in the set
+*
+* @input: id - id to look for
+*
+* @output: true if found
+*
+*--*/
+bool twitIdSet::contains( unsigned long long id ) const
+{
+    std::vector<unsigned long long>::const_iterator it = std::upper_bound( m_bases.begin(), m_bases.end(), id );
+    if( it == m_bases.begin() || id > m_last )
+    {
+        return false;
+    }
+    size_t block = ( it - m_bases.begin() ) - 1;
+    size_t length = blockLength( block );
+    const unsigned char* gaps = m_gaps.empty() ? NULL : &m_gaps[m_offsets[block]];
+    unsigned long long current = m_bases[block];
+    for( size_t i = 1; i < length && current < id; ++i )
+    {
+        unsigned long long gap = 0;
+        for( int shift = 0; ; shift += 7 )
+        {
+            unsigned char byte = *gaps++;
+            gap |= (unsigned long long)( byte & 0x7f ) << shift;
+            if( !( byte & 0x80 ) )
+            {
+                break;
+            }
+        }
+        current += gap;
+    }
+    return current == id;
+}
+
+/*++
+* @method: twitIdSet::getBytes
+*
+* @description: returns the memory used by the encoded ids
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+size_t twitIdSet::getBytes() const
+{
+    return m_bases.size() * sizeof( unsigned long long ) +
+           m_offsets.size() * sizeof( unsigned int ) +
+           m_gaps.size();
+}
+
+/*++
+* @method: twitIdSet::toVector
+*
+* @description: decodes every id
+*
+* @input: none
+*
+* @output: outIds - ids in ascending order
+*
+*--*/
+void twitIdSet::toVector( std::vector<unsigned long long>& outIds ) const
+{
+    outIds.resize( m_size );
+    for( size_t block = 0; block < m_bases.size(); ++block )
+    {
+        decodeBlock( block, &outIds[block * BLOCK_SIZE] );
+    }
+}
+
+/*++
+* @method: twitIdSet::decodeBlock
+*
+* @description: decodes the ids of one block
+*
+* @input: block - block index, less than getBlockCount()
+*
+* @output: out - ids in ascending order, room for BLOCK_SIZE ids needed,
+*          number of ids in the block
+*
+*--*/
+size_t twitIdSet::decodeBlock( size_t block, unsigned long long* out ) const
+{
+    size_t length = blockLength( block );
+    const unsigned char* gaps = m_gaps.empty() ? NULL : &m_gaps[m_offsets[block]];
+    unsigned long long current = m_bases[block];
+    out[0] = current;
+    for( size_t i = 1; i < length; ++i )
+    {
+        unsigned long long gap = 0;
+        for( int shift = 0; ; shift += 7 )
+        {
+            unsigned char byte = *gaps++;
+            gap |= (unsigned long long)( byte & 0x7f ) << shift;
+            if( !( byte & 0x80 ) )
+            {
+                break;
+            }
+        }
+        current += gap;
+        out[i] = current;
+    }
+    return length;
+}
+
+/*++
+* @method: twitIdSet::setUnion
+*
+* @description: computes a | b
+*
+* @input: a, b - sets to combine
+*
+* @output: out - union
+*
+*--*/
+void twitIdSet::setUnion( const twitIdSet& a, const twitIdSet& b, twitIdSet& out )
+{
+    out.clear();
+    twitIdSetReader ra( a );
+    twitIdSetReader rb( b );
+    while( !ra.done() && !rb.done() )
+    {
+        unsigned long long x = ra.current();
+        unsigned long long y = rb.current();
+        if( x <= y )
+        {
+            out.appendSorted( x );
+            ra.advance();
+            if( x == y )
+            {
+                rb.advance();
+            }
+        }
+        else
+        {
+            out.appendSorted( y );
+            rb.advance();
+        }
+    }
+    for( ; !ra.done(); ra.advance() )
+    {
+        out.appendSorted( ra.current() );
+    }
+    for( ; !rb.done(); rb.advance() )
+    {
+        out.appendSorted( rb.current() );
+    }
+}
+
+/*++
+* @method: twitIdSet::setIntersection
+*
+* @description: computes a & b
+*
+* @input: a, b - sets to intersect
+*
+* @output: out - intersection
+*
+*--*/
+void twitIdSet::setIntersection( const twitIdSet& a, const twitIdSet& b, twitIdSet& out )
+{
+    intersectOrSubtract( a, b, out, true );
+}
+
+/*++
+* @method: twitIdSet::setDifference
+*
+* @description: computes a - b, e.g. new followers are
+*               setDifference( now, before ) and lost ones are
+*               setDifference( before, now )
+*
+* @input: a - set to subtract from,
+*         b - ids to remove
+*
+* @output: out - difference
+*
+*--*/
+void twitIdSet::setDifference( const twitIdSet& a, const twitIdSet& b, twitIdSet& out )
+{
+    intersectOrSubtract( a, b, out, false );
+}
+
+/*++
+* @method: twitIdSet::save
+*
+* @description: writes the encoded set to a file. the file is replaced as
+*               a whole so a crash leaves either the old or the new set.
+*
+* @input: path - file path
+*
+* @output: errorMessage - reason of failure,
+*          true if written
+*
+*--*/
+bool twitIdSet::save( const std::string& path, std::string& errorMessage ) const
+{
+    twitAtomicFile atomicFile( path, true );
+    std::ostream& file = atomicFile.stream();
+    if( !file )
+    {
+        errorMessage = "cannot create " + path;
+        return false;
+    }
+    unsigned long long counts[3] = { m_size, m_bases.size(), m_gaps.size() };
+    file.write( TWITIDSET_MAGIC, sizeof( TWITIDSET_MAGIC ) );
+    file.write( (const char*)counts, sizeof( counts ) );
+    if( m_size )
+    {
+        file.write( (const char*)&m_bases[0], m_bases.size() * sizeof( unsigned long long ) );
+        file.write( (const char*)&m_offsets[0], m_offsets.size() * sizeof( unsigned int ) );
+    }
+    if( m_gaps.size() )
+    {
+        file.write( (const char*)&m_gaps[0], m_gaps.size() );
+    }
+    return atomicFile.commit( errorMessage );
+}
+
+/*++
+* @method: twitIdSet::load
+*
+* @description: reads a set written by save()
+*
+* @input: path - file path
+*
+* @output: errorMessage - reason of failure,
+*          true if read
+*
+*--*/
+bool twitIdSet::load( const std::string& path, std::string& errorMessage )
+{
+    clear();
+    std::ifstream file( path.c_str(), std::ios::binary );
+    if( !file )
+    {
+        errorMessage = "cannot open " + path;
+        return false;
+    }
+    char magic[sizeof( TWITIDSET_MAGIC )];
+    unsigned long long counts[3] = { 0, 0, 0 };
+    file.read( magic, sizeof( magic ) );
+    file.read( (char*)counts, sizeof( counts ) );
+    if( !file || memcmp( magic, TWITIDSET_MAGIC, sizeof( magic ) ) )
+    {
+        errorMessage = "not an id set file";
+        return false;
+    }
+    if( counts[1] != ( counts[0] + BLOCK_SIZE - 1 ) / BLOCK_SIZE || ( !counts[0] && counts[2] ) ||
+        counts[2] > 0xffffffffULL )
+    {
+        errorMessage = "id set file is corrupt";
+        return false;
+    }
+
+    /* Sizes come from the file, so check them before allocating */
+    std::streamoff headerSize = file.tellg();
+    file.seekg( 0, std::ios::end );
+    unsigned long long payload = (unsigned long long)( file.tellg() - headerSize );
+    file.seekg( headerSize );
+    const unsigned long long blockBytes = sizeof( unsigned long long ) + sizeof( unsigned int );
+    if( counts[1] > payload / blockBytes || counts[2] != payload - counts[1] * blockBytes )
+    {
+        errorMessage = "id set file size does not match its header";
+        return false;
+    }
+
+    m_bases.resize( (size_t)counts[1] );
+    m_offsets.resize( (size_t)counts[1] );
+    m_gaps.resize( (size_t)counts[2] );
+    if( counts[1] )
+    {
+        file.read( (char*)&m_bases[0], m_bases.size() * sizeof( unsigned long long ) );
+        file.read( (char*)&m_offsets[0], m_offsets.size() * sizeof( unsigned int ) );
+    }
+    if( counts[2] )
+    {
+        file.read( (char*)&m_gaps[0], m_gaps.size() );
+    }
+    if( !file )
+    {
+        clear();
+        errorMessage = "id set file is truncated";
+        return false;
+    }
+
+    m_size = (size_t)counts[0];
+    if( !isValid() )
+    {
+        clear();
+        errorMessage = "id set file is corrupt";
+        return false;
+    }
+    if( m_size )
+    {
+        unsigned long long ids[BLOCK_SIZE];
+        size_t length = decodeBlock( m_bases.size() - 1, ids );
+        m_last = ids[length - 1];
+    }
+    return true;
+}
+
+/*++
+* @method: twitIdSet::blockLength
+*
+* @description: returns the number of ids in a block. this is an internal
+*               method.
+*
+* @input: block - block index
+*
+* @output: number of ids
+*
+* @remarks: internal method
+*
+*--*/
+size_t twitIdSet::blockLength( size_t block ) const
+{
+    return ( block + 1 < m_bases.size() ) ? BLOCK_SIZE : m_size - block * BLOCK_SIZE;
+}
+
+/*++
+* @method: twitIdSet::isValid
+*
+* @description: checks that every block decodes within its own gap bytes
+*               to ids increasing across the whole set, so a set read from
+*               a file can be decoded without bounds checks. this is an
+*               internal method.
+*
+* @input: none
+*
+* @output: true if the encoding is sound
+*
+* @remarks: internal method
+*
+*--*/
+bool twitIdSet::isValid() const
+{
+    unsigned long long previous = 0;
+    for( size_t block = 0; block < m_bases.size(); ++block )
+    {
+        size_t pos = m_offsets[block];
+        size_t end = ( block + 1 < m_offsets.size() ) ? m_offsets[block + 1] : m_gaps.size();
+        if( ( !block && pos ) || pos > end || end > m_gaps.size() || ( block && m_bases[block] <= previous ) )
+        {
+            return false;
+        }
+        unsigned long long current = m_bases[block];
+        size_t length = blockLength( block );
+        for( size_t i = 1; i < length; ++i )
+        {
+            unsigned long long gap = 0;
+            for( int shift = 0; ; shift += 7 )
+            {
+                if( pos >= end || shift > 63 )
+                {
+                    return false;
+                }
+                unsigned char byte = m_gaps[pos++];
+                gap |= (unsigned long long)( byte & 0x7f ) << shift;
+                if( !( byte & 0x80 ) )
+                {
+                    break;
+                }
+            }
+            if( !gap || current + gap < current )
+            {
+                return false;
+            }
+            current += gap;
+        }
+        if( pos != end )
+        {
+            return false;
+        }
+        previous = current;
+    }
+    return true;
+}
+
+/*++
+* @method: twitIdSet::intersectOrSubtract
+*
+* @description: computes a & b or a - b. blocks of b whose range cannot meet
+*               the current block of a are never decoded. this is an
+*               internal method.
+*
+* @input: a, b - operands,
+*         intersect - true for a & b, false for a - b
+*
+* @output: out - result
+*
+* @remarks: internal method
+*
+*--*/
+void twitIdSet::intersectOrSubtract( const twitIdSet& a, const twitIdSet& b, twitIdSet& out, bool intersect )
+{
+    out.clear();
+    unsigned long long aIds[BLOCK_SIZE];
+    unsigned char matched[BLOCK_SIZE];
+    std::vector<unsigned long long> bIds;
+    size_t bBlock = 0;
+    for( size_t aBlock = 0; aBlock < a.m_bases.size(); ++aBlock )
+    {
+        size_t aCount = a.decodeBlock( aBlock, aIds );
+        unsigned long long low = aIds[0];
+        unsigned long long high = aIds[aCount - 1];
+
+        /* Skip blocks of b ending before this block of a starts */
+        while( bBlock < b.m_bases.size() &&
+               ( ( bBlock + 1 < b.m_bases.size() ) ? b.m_bases[bBlock + 1] - 1 : b.m_last ) < low )
+        {
+            ++bBlock;
+        }
+
+        /* Decode the blocks of b that may overlap it */
+        bIds.clear();
+        for( size_t block = bBlock; block < b.m_bases.size() && b.m_bases[block] <= high; ++block )
+        {
+            size_t used = bIds.size();
+            bIds.resize( used + BLOCK_SIZE );
+            bIds.resize( used + b.decodeBlock( block, &bIds[used] ) );
+        }
+
+        if( bIds.empty() )
+        {
+            if( !intersect )
+            {
+                for( size_t i = 0; i < aCount; ++i )
+                {
+                    out.appendSorted( aIds[i] );
+                }
+            }
+            continue;
+        }
+
+        twitMatchIds( aIds, aCount, &bIds[0], bIds.size(), matched );
+        for( size_t i = 0; i < aCount; ++i )
+        {
+            if( ( matched[i] != 0 ) == intersect )
+            {
+                out.appendSorted( aIds[i] );
+            }
+        }
+    }
+}
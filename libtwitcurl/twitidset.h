@@ -0,0 +1,65 @@
+#ifndef _TWITIDSET_H_
+#define _TWITIDSET_H_
+
+#include <string>
+#include <vector>
+
+class twitIdCursor;
+
+/* twitIdSet class
+*
+* Compact sorted set of 64 bit ids, e.g. an account's followers.
+*
+* Ids are kept in blocks of BLOCK_SIZE. Each block stores its first id in
+* full and the gaps to the following ids as varints, so a set of follower
+* ids takes a few bytes per id instead of a std::string node each. Set
+* operations skip blocks whose ranges cannot meet and run the rest through
+* the kernels of twitidkernels.h.
+*/
+class twitIdSet
+{
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    twitIdSet();
+
+    /* Building */
+    void assign( const unsigned long long* ids /* in */, size_t count /* in */ );
+    void assign( std::vector<unsigned long long>& ids /* in */ );
+    bool fill( twitIdCursor& cursor /* in */, std::string& errorMessage /* out */ );
+    void appendSorted( unsigned long long id /* in */ );
+    void clear();
+
+    /* Queries */
+    size_t size() const { return m_size; }
+    bool empty() const { return 0 == m_size; }
+    bool contains( unsigned long long id /* in */ ) const;
+    size_t getBytes() const;
+    void toVector( std::vector<unsigned long long>& outIds /* out */ ) const;
+
+    /* Block access, ids of a block are decoded into out[0..BLOCK_SIZE) */
+    size_t getBlockCount() const { return m_bases.size(); }
+    size_t decodeBlock( size_t block /* in */, unsigned long long* out /* out */ ) const;
+
+    /* Set operations, out must not alias a or b */
+    static void setUnion( const twitIdSet& a /* in */, const twitIdSet& b /* in */, twitIdSet& out /* out */ );
+    static void setIntersection( const twitIdSet& a /* in */, const twitIdSet& b /* in */, twitIdSet& out /* out */ );
+    static void setDifference( const twitIdSet& a /* in */, const twitIdSet& b /* in */, twitIdSet& out /* out */ );
+
+    /* Persistence */
+    bool save( const std::string& path /* in */, std::string& errorMessage /* out */ ) const;
+    bool load( const std::string& path /* in */, std::string& errorMessage /* out */ );
+
+private:
+    std::vector<unsigned long long> m_bases;    /* first id of each block */
+    std::vector<unsigned int> m_offsets;        /* start of each block's gaps */
+    std::vector<unsigned char> m_gaps;          /* varint gaps */
+    size_t m_size;
+    unsigned long long m_last;
+
+    size_t blockLength( size_t block ) const;
+    bool isValid() const;
+    static void intersectOrSubtract( const twitIdSet& a, const twitIdSet& b, twitIdSet& out, bool intersect );
+};
+
+#endif // _TWITIDSET_H_
@@ -0,0 +1,177 @@
+#include "twitintern.h"
+
+/*++
+* @method: twitInternPool::twitInternPool
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitInternPool::twitInternPool()
+{
+}
+
+/*++
+* @method: twitInternPool::~twitInternPool
+*
+* @description: destructor, invalidates every handle of this pool
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitInternPool::~twitInternPool()
+{
+}
+
+/*++
+* @method: twitInternPool::intern
+*
+* @description: returns the stable handle for a string, adding it to the
+*               pool on first use
+*
+* @input: str - string to intern
+*
+* @output: interned string handle
+*
+*--*/
+twitInternStr twitInternPool::intern( const std::string& str )
+{
+    if( str.empty() )
+    {
+        return emptyString();
+    }
+
+    size_t hash = std::hash<std::string>()( str );
+    twitInternShard& shard = m_shards[hash % TWITINTERN_SHARD_COUNT];
+
+    std::unique_lock<std::mutex> lock( shard.mutex );
+    std::pair<std::unordered_set<std::string>::iterator, bool> res = shard.strings.insert( str );
+    if( res.second )
+    {
+        shard.bytes += str.size();
+    }
+
+    /* unordered_set nodes never move, so the address is a stable handle */
+    return &*res.first;
+}
+
+/*++
+* @method: twitInternPool::intern
+*
+* @description: returns the stable handle for a character range
+*
+* @input: str - characters to intern,
+*         len - number of characters
+*
+* @output: interned string handle
+*
+*--*/
+twitInternStr twitInternPool::intern( const char* str, size_t len )
+{
+    if( !str || !len )
+    {
+        return emptyString();
+    }
+    return intern( std::string( str, len ) );
+}
+
+/*++
+* @method: twitInternPool::getCount
+*
+* @description: returns number of distinct strings in the pool
+*
+* @input: none
+*
+* @output: number of strings
+*
+*--*/
+size_t twitInternPool::getCount()
+{
+    size_t count = 0;
+    for( int i = 0; i < TWITINTERN_SHARD_COUNT; ++i )
+    {
+        std::unique_lock<std::mutex> lock( m_shards[i].mutex );
+        count += m_shards[i].strings.size();
+    }
+    return count;
+}
+
+/*++
+* @method: twitInternPool::getBytes
+*
+* @description: returns total characters stored in the pool
+*
+* @input: none
+*
+* @output: number of bytes of string data
+*
+*--*/
+size_t twitInternPool::getBytes()
+{
+    size_t bytes = 0;
+    for( int i = 0; i < TWITINTERN_SHARD_COUNT; ++i )
+    {
+        std::unique_lock<std::mutex> lock( m_shards[i].mutex );
+        bytes += m_shards[i].bytes;
+    }
+    return bytes;
+}
+
+/*++
+* @method: twitInternPool::clear
+*
+* @description: drops every string. handles handed out before are dangling
+*               afterwards, so only call this once no parsed object
+*               refers to the pool any more.
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitInternPool::clear()
+{
+    for( int i = 0; i < TWITINTERN_SHARD_COUNT; ++i )
+    {
+        std::unique_lock<std::mutex> lock( m_shards[i].mutex );
+        m_shards[i].strings.clear();
+        m_shards[i].bytes = 0;
+    }
+}
+
+/*++
+* @method: twitInternPool::emptyString
+*
+* @description: returns the handle of the empty string
+*
+* @input: none
+*
+* @output: empty string handle
+*
+*--*/
+twitInternStr twitInternPool::emptyString()
+{
+    static const std::string empty;
+    return &empty;
+}
+
+/*++
+* @method: twitInternPool::global
+*
+* @description: returns the process-wide pool
+*
+* @input: none
+*
+* @output: process-wide pool
+*
+*--*/
+twitInternPool& twitInternPool::global()
+{
+    static twitInternPool pool;
+    return pool;
+}
@@ -0,0 +1,55 @@
+#ifndef _TWITINTERN_H_
+#define _TWITINTERN_H_
+
+#include <string>
+#include <unordered_set>
+#include <mutex>
+
+/* Handle to an interned string. Two handles from the same pool are equal
+   exactly when their strings are equal, so compare them by pointer. */
+typedef const std::string* twitInternStr;
+
+/* twitInternPool class
+*
+* Stores each distinct string once. Parsers run on several threads, so the
+* table is split into independently locked shards. Handles stay valid until
+* the pool is cleared or destroyed.
+*/
+class twitInternPool
+{
+public:
+    twitInternPool();
+    ~twitInternPool();
+
+    twitInternStr intern( const std::string& str /* in */ );
+    twitInternStr intern( const char* str /* in */, size_t len /* in */ );
+
+    size_t getCount();
+    size_t getBytes();
+    void clear();
+
+    /* Handle used for absent or empty fields, shared by every pool */
+    static twitInternStr emptyString();
+
+    /* Process-wide pool for callers that do not keep one per session */
+    static twitInternPool& global();
+
+private:
+    enum { TWITINTERN_SHARD_COUNT = 16 };
+
+    struct twitInternShard
+    {
+        std::mutex mutex;
+        std::unordered_set<std::string> strings;
+        size_t bytes;
+
+        twitInternShard() : bytes( 0 ) {}
+    };
+
+    twitInternShard m_shards[TWITINTERN_SHARD_COUNT];
+
+    twitInternPool( const twitInternPool& );
+    twitInternPool& operator=( const twitInternPool& );
+};
+
+#endif // _TWITINTERN_H_
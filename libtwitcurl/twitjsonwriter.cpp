@@ -0,0 +1,261 @@
+#include <cstdio>
+#include <cstring>
+#include "twitjsonwriter.h"
+
+/*++
+* @method: twitJsonWriter::twitJsonWriter
+*
+* @description: constructor, the writer appends to buffer
+*
+* @input: buffer - string receiving the JSON text
+*
+* @output: none
+*
+*--*/
+twitJsonWriter::twitJsonWriter( std::string& buffer ):
+m_buffer( buffer ),
+m_afterKey( false )
+{
+}
+
+/*++
+* @method: twitJsonWriter::reset
+*
+* @description: empties the buffer, keeping its capacity, to start a new
+*               document
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitJsonWriter::reset()
+{
+    m_buffer.clear();
+    m_hasElements.clear();
+    m_afterKey = false;
+}
+
+twitJsonWriter& twitJsonWriter::beginObject()
+{
+    separate();
+    m_buffer += '{';
+    m_hasElements.push_back( false );
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::endObject()
+{
+    m_buffer += '}';
+    m_hasElements.pop_back();
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::beginArray()
+{
+    separate();
+    m_buffer += '[';
+    m_hasElements.push_back( false );
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::endArray()
+{
+    m_buffer += ']';
+    m_hasElements.pop_back();
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::key( const std::string& name )
+{
+    separate();
+    writeString( name.data(), name.size() );
+    m_buffer += ':';
+    m_afterKey = true;
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::key( const char* name )
+{
+    separate();
+    writeString( name, strlen( name ) );
+    m_buffer += ':';
+    m_afterKey = true;
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::value( const std::string& str )
+{
+    separate();
+    writeString( str.data(), str.size() );
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::value( const char* str )
+{
+    if( !str )
+    {
+        return nullValue();
+    }
+    separate();
+    writeString( str, strlen( str ) );
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::value( long long number )
+{
+    separate();
+    if( number < 0 )
+    {
+        m_buffer += '-';
+        writeUnsigned( 0ULL - (unsigned long long)number );
+    }
+    else
+    {
+        writeUnsigned( (unsigned long long)number );
+    }
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::value( unsigned long long number )
+{
+    separate();
+    writeUnsigned( number );
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::value( double number )
+{
+    separate();
+    /* JSON has no representation for inf and nan */
+    if( number != number || number - number != 0 )
+    {
+        m_buffer += "null";
+        return *this;
+    }
+    char tmp[32];
+    int len = snprintf( tmp, sizeof( tmp ), "%.17g", number );
+    m_buffer.append( tmp, len );
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::value( bool flag )
+{
+    separate();
+    m_buffer += flag ? "true" : "false";
+    return *this;
+}
+
+twitJsonWriter& twitJsonWriter::nullValue()
+{
+    separate();
+    m_buffer += "null";
+    return *this;
+}
+
+/*++
+* @method: twitJsonWriter::separate
+*
+* @description: writes the comma needed before a new element. this is an
+*               internal method.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitJsonWriter::separate()
+{
+    if( m_afterKey )
+    {
+        /* Value of a key, the key already took care of the comma */
+        m_afterKey = false;
+        return;
+    }
+    if( !m_hasElements.empty() )
+    {
+        if( m_hasElements.back() )
+        {
+            m_buffer += ',';
+        }
+        m_hasElements.back() = true;
+    }
+}
+
+/*++
+* @method: twitJsonWriter::writeString
+*
+* @description: writes a quoted, escaped string. UTF-8 sequences are passed
+*               through, control characters are written as \u escapes.
+*               this is an internal method.
+*
+* @input: str - characters, len - number of characters
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitJsonWriter::writeString( const char* str, size_t len )
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    m_buffer.reserve( m_buffer.size() + len + 2 );
+    m_buffer += '"';
+
+    /* Copy runs of characters that need no escaping in one go */
+    size_t runStart = 0;
+    for( size_t i = 0; i < len; ++i )
+    {
+        unsigned char c = (unsigned char)str[i];
+        if( c >= 0x20 && c != '"' && c != '\\' )
+        {
+            continue;
+        }
+        m_buffer.append( str + runStart, i - runStart );
+        runStart = i + 1;
+        switch( c )
+        {
+        case '"':  m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\b': m_buffer += "\\b"; break;
+        case '\f': m_buffer += "\\f"; break;
+        case '\n': m_buffer += "\\n"; break;
+        case '\r': m_buffer += "\\r"; break;
+        case '\t': m_buffer += "\\t"; break;
+        default:
+            m_buffer += "\\u00";
+            m_buffer += hexDigits[c >> 4];
+            m_buffer += hexDigits[c & 0xF];
+            break;
+        }
+    }
+    m_buffer.append( str + runStart, len - runStart );
+    m_buffer += '"';
+}
+
+/*++
+* @method: twitJsonWriter::writeUnsigned
+*
+* @description: writes a decimal number. this is an internal method.
+*
+* @input: number - value to write
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitJsonWriter::writeUnsigned( unsigned long long number )
+{
+    char tmp[24];
+    char* end = tmp + sizeof( tmp );
+    char* pos = end;
+    do
+    {
+        *--pos = (char)( '0' + number % 10 );
+        number /= 10;
+    } while( number );
+    m_buffer.append( pos, end - pos );
+}
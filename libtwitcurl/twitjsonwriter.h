@@ -0,0 +1,50 @@
+#ifndef _TWITJSONWRITER_H_
+#define _TWITJSONWRITER_H_
+
+#include <string>
+#include <vector>
+
+/* twitJsonWriter class
+*
+* Streaming JSON writer used to build request bodies. It appends straight to
+* a caller owned buffer, so a buffer kept across requests is reused without
+* reallocating, and no intermediate picojson::value tree is built. Commas are
+* inserted automatically; the caller is responsible for balancing begin/end.
+*/
+class twitJsonWriter
+{
+public:
+    twitJsonWriter( std::string& buffer /* in, out */ );
+
+    void reset();
+
+    twitJsonWriter& beginObject();
+    twitJsonWriter& endObject();
+    twitJsonWriter& beginArray();
+    twitJsonWriter& endArray();
+    twitJsonWriter& key( const std::string& name /* in */ );
+    twitJsonWriter& key( const char* name /* in */ );
+
+    twitJsonWriter& value( const std::string& str /* in */ );
+    twitJsonWriter& value( const char* str /* in */ );
+    twitJsonWriter& value( long long number /* in */ );
+    twitJsonWriter& value( unsigned long long number /* in */ );
+    twitJsonWriter& value( int number /* in */ ) { return value( (long long)number ); }
+    twitJsonWriter& value( unsigned int number /* in */ ) { return value( (unsigned long long)number ); }
+    twitJsonWriter& value( double number /* in */ );
+    twitJsonWriter& value( bool flag /* in */ );
+    twitJsonWriter& nullValue();
+
+    std::string& getBuffer() { return m_buffer; }
+
+private:
+    std::string& m_buffer;
+    std::vector<bool> m_hasElements;
+    bool m_afterKey;
+
+    void separate();
+    void writeString( const char* str, size_t len );
+    void writeUnsigned( unsigned long long number );
+};
+
+#endif // _TWITJSONWRITER_H_
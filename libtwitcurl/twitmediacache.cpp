@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include "twitatomicfile.h"
+#include "twitmediacache.h"
+
+using namespace twitMediaCacheDefaults;
+
+namespace
+{
+    /* First line of the state file */
+    const std::string TWITMEDIACACHE_STATE_HEADER = "twitcurl-mediacache 1";
+
+    /* Fewest lines in the state file before it is rewritten without stale lines */
+    const size_t TWITMEDIACACHE_MIN_COMPACT_LINES = 64;
+}
+
+/*++
+* @method: twitMediaCache::twitMediaKey::operator<
+*
+* @description: orders cache keys
+*
+* @input: other - key to compare with
+*
+* @output: true if this key comes first
+*
+*--*/
+bool twitMediaCache::twitMediaKey::operator<( const twitMediaKey& other ) const
+{
+    if( hash != other.hash )
+    {
+        return hash < other.hash;
+    }
+    if( size != other.size )
+    {
+        return size < other.size;
+    }
+    return mediaType < other.mediaType;
+}
+
+/*++
+* @method: twitMediaCache::twitMediaCache
+*
+* @description: constructor
+*
+* @input: statePath - file keeping the cache across restarts, empty to keep
+*                     it in memory only; call loadState() to read it,
+*         maxEntries - most media ids kept
+*
+* @output: none
+*
+*--*/
+twitMediaCache::twitMediaCache( const std::string& statePath, size_t maxEntries ):
+m_statePath( statePath ),
+m_maxEntries( std::max( maxEntries, (size_t)1 ) ),
+m_stateLines( 0 )
+{
+}
+
+/*++
+* @method: twitMediaCache::loadState
+*
+* @description: reads the entries written before. a missing file is not an
+*               error, the cache then starts empty. expired entries are
+*               skipped, as is a last line cut short by a crash.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if the file is missing or was read
+*
+*--*/
+bool twitMediaCache::loadState( std::string& errorMessage )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_entries.clear();
+    m_stateLines = 0;
+    if( m_statePath.empty() )
+    {
+        return true;
+    }
+    std::ifstream file( m_statePath.c_str() );
+    if( !file )
+    {
+        return true;
+    }
+
+    std::string line;
+    if( !std::getline( file, line ) || TWITMEDIACACHE_STATE_HEADER != line )
+    {
+        errorMessage = "not a media cache file: " + m_statePath;
+        return false;
+    }
+    while( std::getline( file, line ) )
+    {
+        std::istringstream fields( line );
+        twitMediaKey key;
+        twitMediaEntry entry;
+        long long expiresAt = 0;
+        if( file.eof() )
+        {
+            /* Every line is written with its newline; rewrite the file
+               before appending after what is left of this one */
+            m_stateLines = 0;
+            break;
+        }
+        if( line.empty() )
+        {
+            continue;
+        }
+        if( !( fields >> key.hash >> key.size >> key.mediaType >> expiresAt >> entry.mediaId ) )
+        {
+            errorMessage = "malformed line in " + m_statePath + ": " + line;
+            m_entries.clear();
+            m_stateLines = 0;
+            return false;
+        }
+        entry.expiresAt = (time_t)expiresAt;
+        m_entries[key] = entry;
+        ++m_stateLines;
+    }
+    purge();
+    return true;
+}
+
+/*++
+* @method: twitMediaCache::lookup
+*
+* @description: looks for a media id of the given media that stays valid
+*               long enough to be attached
+*
+* @input: hash - twitHashSource() of the media,
+*         size - size of the media,
+*         mediaType - twitCurlTypes::eTwitCurlMediaType of the media
+*
+* @output: outMediaId - cached media id,
+*          true if found
+*
+*--*/
+bool twitMediaCache::lookup( unsigned long long hash, unsigned long long size, int mediaType, std::string& outMediaId )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    twitMediaKey key = { hash, size, mediaType };
+    twitMediaEntries::const_iterator it = m_entries.find( key );
+    if( ( m_entries.end() == it ) || ( time( NULL ) + TWITMEDIACACHE_EXPIRY_MARGIN_SECS >= it->second.expiresAt ) )
+    {
+        return false;
+    }
+    outMediaId = it->second.mediaId;
+    return true;
+}
+
+/*++
+* @method: twitMediaCache::insert
+*
+* @description: records the media id of uploaded media
+*
+* @input: hash - twitHashSource() of the media,
+*         size - size of the media,
+*         mediaType - twitCurlTypes::eTwitCurlMediaType of the media,
+*         mediaId - media id twitter gave,
+*         expiresAt - time the media id expires
+*
+* @output: none
+*
+*--*/
+void twitMediaCache::insert( unsigned long long hash, unsigned long long size, int mediaType,
+                             const std::string& mediaId, time_t expiresAt )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    twitMediaKey key = { hash, size, mediaType };
+    twitMediaEntry entry = { mediaId, expiresAt };
+    m_entries[key] = entry;
+    purge();
+    appendState( key, entry );
+}
+
+/*++
+* @method: twitMediaCache::erase
+*
+* @description: forgets the media id of the given media, e.g. after twitter
+*               refused it
+*
+* @input: hash - twitHashSource() of the media,
+*         size - size of the media,
+*         mediaType - twitCurlTypes::eTwitCurlMediaType of the media
+*
+* @output: none
+*
+*--*/
+void twitMediaCache::erase( unsigned long long hash, unsigned long long size, int mediaType )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    twitMediaKey key = { hash, size, mediaType };
+    if( m_entries.erase( key ) )
+    {
+        /* An entry that expired long ago is dropped when read back */
+        twitMediaEntry removed = { "-", 0 };
+        appendState( key, removed );
+    }
+}
+
+/*++
+* @method: twitMediaCache::clear
+*
+* @description: forgets every media id
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitMediaCache::clear()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_entries.clear();
+    std::string errorMessage;
+    saveState( errorMessage );
+}
+
+/*++
+* @method: twitMediaCache::getCount
+*
+* @description: returns the number of cached media ids
+*
+* @input: none
+*
+* @output: entry count
+*
+*--*/
+size_t twitMediaCache::getCount()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_entries.size();
+}
+
+/*++
+* @method: twitMediaCache::purge
+*
+* @description: drops entries that can no longer be used and, past the
+*               entry limit, those expiring first. called with the lock
+*               held.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitMediaCache::purge()
+{
+    const time_t usableUntil = time( NULL ) + TWITMEDIACACHE_EXPIRY_MARGIN_SECS;
+    for( twitMediaEntries::iterator it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if( usableUntil >= it->second.expiresAt )
+        {
+            m_entries.erase( it++ );
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if( m_entries.size() <= m_maxEntries )
+    {
+        return;
+    }
+
+    std::vector<std::pair<time_t, twitMediaKey> > byExpiry;
+    byExpiry.reserve( m_entries.size() );
+    for( twitMediaEntries::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+    {
+        byExpiry.push_back( std::make_pair( it->second.expiresAt, it->first ) );
+    }
+    size_t excess = m_entries.size() - m_maxEntries;
+    std::nth_element( byExpiry.begin(), byExpiry.begin() + excess, byExpiry.end() );
+    for( size_t i = 0; i < excess; ++i )
+    {
+        m_entries.erase( byExpiry[i].second );
+    }
+}
+
+/*++
+* @method: twitMediaCache::appendState
+*
+* @description: adds a changed entry to the end of the file, which is read
+*               back in order so the last line of a key wins. the file is
+*               rewritten instead while it has no lines to append to or
+*               twice as many lines as entries. called with the lock held.
+*
+* @input: key - key of the changed entry,
+*         entry - its new value
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitMediaCache::appendState( const twitMediaKey& key, const twitMediaEntry& entry )
+{
+    /* Losing the file only costs uploads after a restart */
+    std::string errorMessage;
+    if( m_statePath.empty() )
+    {
+        return;
+    }
+    if( !m_stateLines || ( m_stateLines >= std::max( 2 * m_entries.size(), TWITMEDIACACHE_MIN_COMPACT_LINES ) ) )
+    {
+        saveState( errorMessage );
+        return;
+    }
+
+    std::ofstream file( m_statePath.c_str(), std::ios::app );
+    file << key.hash << " " << key.size << " " << key.mediaType << " "
+         << (long long)entry.expiresAt << " " << entry.mediaId << "\n";
+    file.close();
+    /* A line cut short must not have the next one appended to it */
+    m_stateLines = file ? m_stateLines + 1 : 0;
+}
+
+/*++
+* @method: twitMediaCache::saveState
+*
+* @description: writes every entry. the file is replaced as a whole so a
+*               crash leaves either the old or the new cache. called with
+*               the lock held.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if written
+*
+* @remarks: internal method
+*
+*--*/
+bool twitMediaCache::saveState( std::string& errorMessage )
+{
+    if( m_statePath.empty() )
+    {
+        return true;
+    }
+    twitAtomicFile file( m_statePath );
+    file.stream() << TWITMEDIACACHE_STATE_HEADER << "\n";
+    for( twitMediaEntries::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+    {
+        file.stream() << it->first.hash << " " << it->first.size << " " << it->first.mediaType << " "
+                      << (long long)it->second.expiresAt << " " << it->second.mediaId << "\n";
+    }
+    if( !file.commit( errorMessage ) )
+    {
+        m_stateLines = 0;
+        return false;
+    }
+    m_stateLines = m_entries.size();
+    return true;
+}
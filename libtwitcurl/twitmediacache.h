@@ -0,0 +1,75 @@
+#ifndef _TWITMEDIACACHE_H_
+#define _TWITMEDIACACHE_H_
+
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace twitMediaCacheDefaults
+{
+    const size_t TWITMEDIACACHE_MAX_ENTRIES = 10000;
+    const long TWITMEDIACACHE_EXPIRY_MARGIN_SECS = 600;   /* left to attach a cached media id */
+};
+
+/* twitMediaCache class
+*
+* Remembers the media ids of uploaded media by content, so media attached
+* again while its media id is valid is not uploaded again. Entries are
+* keyed by a hash of every byte of the media (twitHashSource), its size
+* and its type, and dropped once their media id is about to expire. The
+* cache can be kept in a file across restarts; every change is appended to
+* it as one line, and it is rewritten once it holds twice as many lines as
+* entries. When full, the entries expiring first are dropped. Safe to share
+* between threads.
+*/
+class twitMediaCache
+{
+public:
+    twitMediaCache( const std::string& statePath = "" /* in */,
+                    size_t maxEntries = twitMediaCacheDefaults::TWITMEDIACACHE_MAX_ENTRIES /* in */ );
+
+    bool loadState( std::string& errorMessage /* out */ );
+    bool lookup( unsigned long long hash /* in */, unsigned long long size /* in */, int mediaType /* in */,
+                 std::string& outMediaId /* out */ );
+    void insert( unsigned long long hash /* in */, unsigned long long size /* in */, int mediaType /* in */,
+                 const std::string& mediaId /* in */, time_t expiresAt /* in */ );
+    void erase( unsigned long long hash /* in */, unsigned long long size /* in */, int mediaType /* in */ );
+    void clear();
+
+    size_t getCount();
+
+private:
+    struct twitMediaKey
+    {
+        unsigned long long hash;
+        unsigned long long size;
+        int mediaType;
+
+        bool operator<( const twitMediaKey& other ) const;
+    };
+
+    struct twitMediaEntry
+    {
+        std::string mediaId;
+        time_t expiresAt;
+    };
+
+    typedef std::map<twitMediaKey, twitMediaEntry> twitMediaEntries;
+
+    std::mutex m_mutex;
+    std::string m_statePath;
+    size_t m_maxEntries;
+    twitMediaEntries m_entries;
+    size_t m_stateLines;
+
+    void purge();
+    void appendState( const twitMediaKey& key, const twitMediaEntry& entry );
+    bool saveState( std::string& errorMessage );
+
+    twitMediaCache( const twitMediaCache& );
+    twitMediaCache& operator=( const twitMediaCache& );
+};
+
+#endif // _TWITMEDIACACHE_H_
@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "twitmediasource.h"
+
+namespace
+{
+    /* Most bytes twitSpoolMediaSource reads from its stream at once */
+    const size_t TWITSPOOL_READ_SIZE = 64 * 1024;
+
+    /* Bytes of a buffer from offset on, copied to out */
+    size_t copyAt( const char* data, size_t size, unsigned long long offset, char* out, size_t length )
+    {
+        if( offset >= size )
+        {
+            return 0;
+        }
+        size_t count = std::min( length, (size_t)( size - offset ) );
+        memcpy( out, data + offset, count );
+        return count;
+    }
+}
+
+/*++
+* @method: twitMemoryMediaSource::twitMemoryMediaSource
+*
+* @description: constructor, borrows a buffer
+*
+* @input: data - bytes, must outlive the source,
+*         size - byte count
+*
+* @output: none
+*
+*--*/
+twitMemoryMediaSource::twitMemoryMediaSource( const char* data, size_t size ):
+m_data( data ),
+m_size( size )
+{
+}
+
+/*++
+* @method: twitMemoryMediaSource::twitMemoryMediaSource
+*
+* @description: constructor, borrows a buffer until the source is destroyed
+*
+* @input: data - bytes,
+*         size - byte count,
+*         release - called with data and size when the source is
+*                   destroyed, e.g. to free the buffer
+*
+* @output: none
+*
+*--*/
+twitMemoryMediaSource::twitMemoryMediaSource( const char* data, size_t size, const twitMediaReleaseCallback& release ):
+m_data( data ),
+m_size( size ),
+m_release( release )
+{
+}
+
+/*++
+* @method: twitMemoryMediaSource::twitMemoryMediaSource
+*
+* @description: constructor, takes over the contents of a string without
+*               copying them
+*
+* @input: data - bytes
+*
+* @output: data - emptied
+*
+*--*/
+twitMemoryMediaSource::twitMemoryMediaSource( std::string& data )
+{
+    m_owned.swap( data );
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+}
+
+/*++
+* @method: twitMemoryMediaSource::~twitMemoryMediaSource
+*
+* @description: destructor, hands a borrowed buffer back
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitMemoryMediaSource::~twitMemoryMediaSource()
+{
+    if( m_release )
+    {
+        m_release( m_data, m_size );
+    }
+}
+
+/*++
+* @method: twitMemoryMediaSource::getSize
+*
+* @description: returns the size of the buffer
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+unsigned long long twitMemoryMediaSource::getSize()
+{
+    return m_size;
+}
+
+/*++
+* @method: twitMemoryMediaSource::readAt
+*
+* @description: copies bytes of the buffer
+*
+* @input: offset - position of the first byte,
+*         length - room in buffer
+*
+* @output: buffer - bytes,
+*          number of bytes copied
+*
+*--*/
+size_t twitMemoryMediaSource::readAt( unsigned long long offset, char* buffer, size_t length )
+{
+    return copyAt( m_data, m_size, offset, buffer, length );
+}
+
+/*++
+* @method: twitMemoryMediaSource::getData
+*
+* @description: returns the buffer
+*
+* @input: none
+*
+* @output: bytes
+*
+*--*/
+const char* twitMemoryMediaSource::getData()
+{
+    return m_data;
+}
+
+/*++
+* @method: twitMappedMediaSource::twitMappedMediaSource
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitMappedMediaSource::twitMappedMediaSource()
+{
+}
+
+/*++
+* @method: twitMappedMediaSource::open
+*
+* @description: maps a file
+*
+* @input: path - media file
+*
+* @output: true if mapped. empty files cannot be mapped and fail.
+*
+*--*/
+bool twitMappedMediaSource::open( const std::string& path )
+{
+    return m_file.open( path );
+}
+
+/*++
+* @method: twitMappedMediaSource::getSize
+*
+* @description: returns the size of the file
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+unsigned long long twitMappedMediaSource::getSize()
+{
+    return m_file.getSize();
+}
+
+/*++
+* @method: twitMappedMediaSource::readAt
+*
+* @description: copies bytes of the mapped file
+*
+* @input: offset - position of the first byte,
+*         length - room in buffer
+*
+* @output: buffer - bytes,
+*          number of bytes copied
+*
+*--*/
+size_t twitMappedMediaSource::readAt( unsigned long long offset, char* buffer, size_t length )
+{
+    return copyAt( m_file.getData(), m_file.getSize(), offset, buffer, length );
+}
+
+/*++
+* @method: twitMappedMediaSource::getData
+*
+* @description: returns the mapped bytes
+*
+* @input: none
+*
+* @output: bytes, NULL if not open
+*
+*--*/
+const char* twitMappedMediaSource::getData()
+{
+    return m_file.getData();
+}
+
+/*++
+* @method: twitStreamMediaSource::twitStreamMediaSource
+*
+* @description: constructor, measures the stream by seeking to its end
+*
+* @input: stream - seekable stream, must outlive the source
+*
+* @output: none
+*
+*--*/
+twitStreamMediaSource::twitStreamMediaSource( std::istream& stream ):
+m_stream( stream ),
+m_size( 0 )
+{
+    m_stream.seekg( 0, std::ios::end );
+    std::streampos end = m_stream.tellg();
+    if( end > 0 )
+    {
+        m_size = (unsigned long long)end;
+    }
+    m_stream.clear();
+    m_stream.seekg( 0, std::ios::beg );
+}
+
+/*++
+* @method: twitStreamMediaSource::getSize
+*
+* @description: returns the size of the stream
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+unsigned long long twitStreamMediaSource::getSize()
+{
+    return m_size;
+}
+
+/*++
+* @method: twitStreamMediaSource::readAt
+*
+* @description: seeks the stream and reads from it
+*
+* @input: offset - position of the first byte,
+*         length - room in buffer
+*
+* @output: buffer - bytes,
+*          number of bytes read
+*
+*--*/
+size_t twitStreamMediaSource::readAt( unsigned long long offset, char* buffer, size_t length )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_stream.clear();
+    m_stream.seekg( (std::streamoff)offset, std::ios::beg );
+    m_stream.read( buffer, (std::streamsize)length );
+    std::streamsize count = m_stream.gcount();
+    return ( count > 0 ) ? (size_t)count : 0;
+}
+
+/*++
+* @method: twitSpoolMediaSource::twitSpoolMediaSource
+*
+* @description: constructor; call open() before anything else
+*
+* @input: expectedSize - exact length of the stream when known in advance,
+*                        which lets its bytes be used while they arrive;
+*                        0 if unknown
+*
+* @output: none
+*
+*--*/
+twitSpoolMediaSource::twitSpoolMediaSource( unsigned long long expectedSize ):
+m_file( NULL ),
+m_expectedSize( expectedSize ),
+m_spooledSize( 0 ),
+m_finished( false ),
+m_failed( false ),
+m_cancelled( false )
+{
+}
+
+/*++
+* @method: twitSpoolMediaSource::~twitSpoolMediaSource
+*
+* @description: destructor, removes the temporary file. fill() must have
+*               returned.
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitSpoolMediaSource::~twitSpoolMediaSource()
+{
+    if( m_file )
+    {
+        fclose( m_file );
+    }
+}
+
+/*++
+* @method: twitSpoolMediaSource::open
+*
+* @description: creates the temporary file, removed once it is closed
+*
+* @input: none
+*
+* @output: true if created
+*
+*--*/
+bool twitSpoolMediaSource::open()
+{
+    m_file = tmpfile();
+    return ( NULL != m_file );
+}
+
+/*++
+* @method: twitSpoolMediaSource::fill
+*
+* @description: copies the stream to the temporary file until it ends,
+*               waking up reads as bytes arrive. with an expected size, a
+*               stream of another length is an error.
+*
+* @input: stream - bytes, read once from where it stands
+*
+* @output: errorMessage - reason of failure,
+*          true if the whole stream was spooled
+*
+*--*/
+bool twitSpoolMediaSource::fill( std::istream& stream, std::string& errorMessage )
+{
+    std::vector<char> buffer( TWITSPOOL_READ_SIZE );
+    bool ok = ( NULL != m_file );
+    if( !ok )
+    {
+        errorMessage = "no temporary file to spool the stream to";
+    }
+    while( ok && stream )
+    {
+        /* Blocks until the buffer is full or the stream ends */
+        stream.read( &buffer[0], (std::streamsize)buffer.size() );
+        std::streamsize count = stream.gcount();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if( m_cancelled )
+            {
+                errorMessage = "upload cancelled";
+                ok = false;
+            }
+            else if( count > 0 )
+            {
+                if( ( 0 != fseek( m_file, 0, SEEK_END ) ) || ( fwrite( &buffer[0], 1, (size_t)count, m_file ) != (size_t)count ) )
+                {
+                    errorMessage = "cannot write the temporary file";
+                    ok = false;
+                }
+                m_spooledSize += (unsigned long long)count;
+                if( ok && m_expectedSize && ( m_spooledSize > m_expectedSize ) )
+                {
+                    errorMessage = "stream is longer than the " + std::to_string( m_expectedSize ) + " bytes expected";
+                    ok = false;
+                }
+            }
+        }
+        m_condition.notify_all();
+    }
+    if( ok && stream.bad() )
+    {
+        errorMessage = "cannot read the stream";
+        ok = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( ok && m_expectedSize && ( m_spooledSize != m_expectedSize ) )
+        {
+            errorMessage = "stream ended after " + std::to_string( m_spooledSize ) + " bytes, " +
+                           std::to_string( m_expectedSize ) + " expected";
+            ok = false;
+        }
+        m_finished = true;
+        m_failed = !ok;
+    }
+    m_condition.notify_all();
+    return ok;
+}
+
+/*++
+* @method: twitSpoolMediaSource::cancel
+*
+* @description: makes waiting reads fail, and fill() stop once the read of
+*               the stream under way returns
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitSpoolMediaSource::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_cancelled = true;
+    }
+    m_condition.notify_all();
+}
+
+/*++
+* @method: twitSpoolMediaSource::getSize
+*
+* @description: returns the expected size, or without one the size spooled
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+unsigned long long twitSpoolMediaSource::getSize()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_expectedSize ? m_expectedSize : m_spooledSize;
+}
+
+/*++
+* @method: twitSpoolMediaSource::readAt
+*
+* @description: reads from the temporary file, after waiting for the bytes
+*               to arrive
+*
+* @input: offset - position of the first byte,
+*         length - room in buffer
+*
+* @output: buffer - bytes,
+*          number of bytes read
+*
+*--*/
+size_t twitSpoolMediaSource::readAt( unsigned long long offset, char* buffer, size_t length )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    const unsigned long long end = offset + length;
+    m_condition.wait( lock, [&]() { return m_finished || m_cancelled || ( m_spooledSize >= end ); } );
+    if( m_cancelled || ( offset >= m_spooledSize ) || ( 0 != fseek( m_file, (long)offset, SEEK_SET ) ) )
+    {
+        return 0;
+    }
+    size_t count = (size_t)std::min( (unsigned long long)length, m_spooledSize - offset );
+    return fread( buffer, 1, count, m_file );
+}
+
+/*++
+* @method: twitSpoolMediaSource::waitFor
+*
+* @description: waits until the bytes before end were spooled. the bytes
+*               up to the expected size are only complete once the stream
+*               ended, since only then is its length known to be right.
+*
+* @input: end - position after the last byte needed
+*
+* @output: true if the bytes can be read
+*
+*--*/
+bool twitSpoolMediaSource::waitFor( unsigned long long end )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    const bool last = ( end >= m_expectedSize );
+    m_condition.wait( lock, [&]() { return m_finished || m_cancelled || ( !last && ( m_spooledSize >= end ) ); } );
+    return !m_failed && !m_cancelled && ( m_spooledSize >= end );
+}
+
+/*++
+* @method: twitCallbackMediaSource::twitCallbackMediaSource
+*
+* @description: constructor
+*
+* @input: size - total size in bytes,
+*         callback - produces the bytes at a position
+*
+* @output: none
+*
+*--*/
+twitCallbackMediaSource::twitCallbackMediaSource( unsigned long long size, const twitMediaReadCallback& callback ):
+m_size( size ),
+m_callback( callback )
+{
+}
+
+/*++
+* @method: twitCallbackMediaSource::getSize
+*
+* @description: returns the size given at construction
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+unsigned long long twitCallbackMediaSource::getSize()
+{
+    return m_size;
+}
+
+/*++
+* @method: twitCallbackMediaSource::readAt
+*
+* @description: asks the callback for bytes
+*
+* @input: offset - position of the first byte,
+*         length - room in buffer
+*
+* @output: buffer - bytes,
+*          number of bytes produced
+*
+*--*/
+size_t twitCallbackMediaSource::readAt( unsigned long long offset, char* buffer, size_t length )
+{
+    if( offset >= m_size || !m_callback )
+    {
+        return 0;
+    }
+    length = (size_t)std::min( (unsigned long long)length, m_size - offset );
+    return m_callback( offset, buffer, length );
+}
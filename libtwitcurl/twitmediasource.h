@@ -0,0 +1,170 @@
+#ifndef _TWITMEDIASOURCE_H_
+#define _TWITMEDIASOURCE_H_
+
+#include <string>
+#include <cstdio>
+#include <istream>
+#include <functional>
+#include <condition_variable>
+#include <mutex>
+#include "twitmmap.h"
+
+class twitBandwidth;
+
+/* twitMediaSource class
+*
+* Bytes of a media upload, read by position. twitCurl::uploadMedia has cURL
+* pull each part of a request straight from the source while it is sent, so
+* no copy of the file or of a chunk is staged in memory. readAt() may be
+* called for several ranges at once from different threads.
+*/
+class twitMediaSource
+{
+public:
+    virtual ~twitMediaSource() {}
+
+    /* Total size in bytes */
+    virtual unsigned long long getSize() = 0;
+
+    /* Copies up to length bytes from offset into buffer. returns the number
+       copied, less than length only at the end of the source, 0 on error */
+    virtual size_t readAt( unsigned long long offset /* in */, char* buffer /* out */, size_t length /* in */ ) = 0;
+
+    /* All bytes, if the source keeps them contiguous in memory; else NULL */
+    virtual const char* getData() { return NULL; }
+
+    /* Blocks until the bytes before end can be read, for a source whose
+       bytes are still arriving. false if they never will */
+    virtual bool waitFor( unsigned long long /* end */ ) { return true; }
+};
+
+/* Called once a source no longer needs a borrowed buffer */
+typedef std::function<void( const char* data, size_t size )> twitMediaReleaseCallback;
+
+/* Bytes in memory. The buffer is borrowed and must outlive the source,
+   unless it is handed over as a string, or a release callback is given,
+   which the source calls when it is destroyed. */
+class twitMemoryMediaSource : public twitMediaSource
+{
+public:
+    twitMemoryMediaSource( const char* data /* in */, size_t size /* in */ );
+    twitMemoryMediaSource( const char* data /* in */, size_t size /* in */,
+                           const twitMediaReleaseCallback& release /* in */ );
+    explicit twitMemoryMediaSource( std::string& data /* in, taken */ );
+    ~twitMemoryMediaSource();
+
+    unsigned long long getSize();
+    size_t readAt( unsigned long long offset /* in */, char* buffer /* out */, size_t length /* in */ );
+    const char* getData();
+
+private:
+    std::string m_owned;
+    const char* m_data;
+    size_t m_size;
+    twitMediaReleaseCallback m_release;
+
+    twitMemoryMediaSource( const twitMemoryMediaSource& );
+    twitMemoryMediaSource& operator=( const twitMemoryMediaSource& );
+};
+
+/* A file mapped into memory; bytes go from the page cache to the socket */
+class twitMappedMediaSource : public twitMediaSource
+{
+public:
+    twitMappedMediaSource();
+
+    bool open( const std::string& path /* in */ );
+
+    unsigned long long getSize();
+    size_t readAt( unsigned long long offset /* in */, char* buffer /* out */, size_t length /* in */ );
+    const char* getData();
+
+private:
+    twitMappedFile m_file;
+
+    twitMappedMediaSource( const twitMappedMediaSource& );
+    twitMappedMediaSource& operator=( const twitMappedMediaSource& );
+};
+
+/* A seekable stream, borrowed. Reads are serialized. */
+class twitStreamMediaSource : public twitMediaSource
+{
+public:
+    explicit twitStreamMediaSource( std::istream& stream /* in */ );
+
+    unsigned long long getSize();
+    size_t readAt( unsigned long long offset /* in */, char* buffer /* out */, size_t length /* in */ );
+
+private:
+    std::mutex m_mutex;
+    std::istream& m_stream;
+    unsigned long long m_size;
+
+    twitStreamMediaSource( const twitStreamMediaSource& );
+    twitStreamMediaSource& operator=( const twitStreamMediaSource& );
+};
+
+/* A stream that cannot seek or whose length is unknown, e.g. a pipe from
+   an encoder. fill() copies it to a temporary file as it arrives, usually
+   on a thread of its own, so that any range can be read again to retry a
+   segment; reads of bytes not there yet wait for them. The size is the
+   one expected, or without one, what was spooled once fill() returned. */
+class twitSpoolMediaSource : public twitMediaSource
+{
+public:
+    explicit twitSpoolMediaSource( unsigned long long expectedSize = 0 /* in */ );
+    ~twitSpoolMediaSource();
+
+    bool open();
+    bool fill( std::istream& stream /* in */, std::string& errorMessage /* out */ );
+    void cancel();
+
+    unsigned long long getSize();
+    size_t readAt( unsigned long long offset /* in */, char* buffer /* out */, size_t length /* in */ );
+    bool waitFor( unsigned long long end /* in */ );
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    FILE* m_file;
+    unsigned long long m_expectedSize;  /* 0 if unknown */
+    unsigned long long m_spooledSize;
+    bool m_finished;                    /* fill() returned */
+    bool m_failed;
+    bool m_cancelled;
+
+    twitSpoolMediaSource( const twitSpoolMediaSource& );
+    twitSpoolMediaSource& operator=( const twitSpoolMediaSource& );
+};
+
+/* Reads bytes at a position for twitCallbackMediaSource, same contract as
+   twitMediaSource::readAt */
+typedef std::function<size_t( unsigned long long offset, char* buffer, size_t length )> twitMediaReadCallback;
+
+/* Bytes produced by a callback, e.g. from a custom container or a
+   decryptor */
+class twitCallbackMediaSource : public twitMediaSource
+{
+public:
+    twitCallbackMediaSource( unsigned long long size /* in */, const twitMediaReadCallback& callback /* in */ );
+
+    unsigned long long getSize();
+    size_t readAt( unsigned long long offset /* in */, char* buffer /* out */, size_t length /* in */ );
+
+private:
+    unsigned long long m_size;
+    twitMediaReadCallback m_callback;
+};
+
+/* Part of a source sent as the body of one request, advanced by cURL's
+   read callback as the bytes go out */
+struct twitMediaRange
+{
+    twitMediaSource* source;
+    unsigned long long start;   /* where the body begins, for rewinds */
+    unsigned long long offset;
+    unsigned long long end;
+    twitBandwidth* bandwidth;   /* budget the bytes are drawn from, NULL for none */
+};
+
+#endif // _TWITMEDIASOURCE_H_
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <limits>
+#include "twitmerge.h"
+
+namespace
+{
+    /* Tweet ids carry their creation time in milliseconds since this epoch
+       above the low 22 bits */
+    const unsigned long long TWITMERGE_ID_EPOCH_MS = 1288834974657ULL;
+    const unsigned int TWITMERGE_ID_TIME_SHIFT = 22;
+
+    bool tweetIdLess( const twitTweet& a, const twitTweet& b )
+    {
+        return a.id < b.id;
+    }
+}
+
+/*++
+* @method: twitIdFromTime
+*
+* @description: returns the smallest tweet id a tweet created at a given
+*               time can have
+*
+* @input: secondsSinceEpoch - time
+*
+* @output: tweet id, 0 for times before ids carried a time
+*
+*--*/
+unsigned long long twitIdFromTime( unsigned long long secondsSinceEpoch )
+{
+    unsigned long long ms = secondsSinceEpoch * 1000;
+    return ( ms > TWITMERGE_ID_EPOCH_MS ) ? ( ms - TWITMERGE_ID_EPOCH_MS ) << TWITMERGE_ID_TIME_SHIFT : 0;
+}
+
+/*++
+* @method: twitMergeStream::twitMergeStream
+*
+* @description: constructor
+*
+* @input: callback - receives the merged tweets,
+*         maxBuffered - tweets held back before the oldest are released
+*                       regardless of lagging sources
+*
+* @output: none
+*
+*--*/
+twitMergeStream::twitMergeStream( const twitMergeCallback& callback, size_t maxBuffered ):
+m_callback( callback ),
+m_maxBuffered( std::max( maxBuffered, (size_t)1 ) ),
+m_bufferedCount( 0 ),
+m_releasedId( 0 ),
+m_lateCount( 0 )
+{
+}
+
+/*++
+* @method: twitMergeStream::addSource
+*
+* @description: adds a source. nothing is released past its watermark until
+*               it pushes or advances.
+*
+* @input: watermark - id up to which the source is known to be complete,
+*                     e.g. the watermark of a resumed twitTimelineSync
+*
+* @output: index of the source
+*
+*--*/
+size_t twitMergeStream::addSource( unsigned long long watermark )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    twitMergeSource source;
+    source.watermark = watermark;
+    source.closed = false;
+    m_sources.push_back( source );
+    return m_sources.size() - 1;
+}
+
+/*++
+* @method: twitMergeStream::push
+*
+* @description: adds tweets of a source and releases what became ready
+*
+* @input: source - index from addSource(),
+*         tweets - new tweets of the source, oldest first,
+*         watermark - id up to which the source is now complete, 0 for the
+*                     newest id of tweets; e.g. the since id of the next
+*                     poll
+*
+* @output: tweets - emptied
+*
+*--*/
+void twitMergeStream::push( size_t source, std::vector<twitTweet>& tweets, unsigned long long watermark )
+{
+    if( !std::is_sorted( tweets.begin(), tweets.end(), tweetIdLess ) )
+    {
+        std::sort( tweets.begin(), tweets.end(), tweetIdLess );
+    }
+    std::lock_guard<std::mutex> emitLock( m_emitMutex );
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( source >= m_sources.size() )
+        {
+            tweets.clear();
+            return;
+        }
+        twitMergeSource& state = m_sources[source];
+        std::deque<twitTweet>& buffer = state.buffer;
+        for( size_t i = 0; i < tweets.size(); ++i )
+        {
+            unsigned long long id = tweets[i].id;
+            if( id <= m_releasedId )
+            {
+                /* Behind the stream, unless it is a repeat */
+                if( id < m_releasedId )
+                {
+                    ++m_lateCount;
+                    m_ready.push_back( std::move( tweets[i] ) );
+                }
+                continue;
+            }
+            if( buffer.empty() || id > buffer.back().id )
+            {
+                buffer.push_back( std::move( tweets[i] ) );
+            }
+            else
+            {
+                /* Older than what the source pushed before, e.g. a gap fill */
+                std::deque<twitTweet>::iterator it = std::lower_bound( buffer.begin(), buffer.end(), tweets[i], tweetIdLess );
+                if( it->id == id )
+                {
+                    continue;
+                }
+                buffer.insert( it, std::move( tweets[i] ) );
+            }
+            ++m_bufferedCount;
+            if( buffer.front().id == id )
+            {
+                twitMergeHead head = { id, source };
+                m_heads.push( head );
+            }
+        }
+        if( !watermark && tweets.size() )
+        {
+            watermark = tweets.back().id;
+        }
+        state.watermark = std::max( state.watermark, watermark );
+        tweets.clear();
+        collectReady( false );
+    }
+    release();
+}
+
+/*++
+* @method: twitMergeStream::advance
+*
+* @description: moves the watermark of a source that has nothing new, e.g.
+*               twitIdFromTime() of a poll that came back empty
+*
+* @input: source - index from addSource(),
+*         watermark - id up to which the source is complete
+*
+* @output: none
+*
+*--*/
+void twitMergeStream::advance( size_t source, unsigned long long watermark )
+{
+    std::vector<twitTweet> none;
+    push( source, none, watermark );
+}
+
+/*++
+* @method: twitMergeStream::closeSource
+*
+* @description: stops waiting for a source, e.g. a search cursor that is
+*               done. its buffered tweets are still merged.
+*
+* @input: source - index from addSource()
+*
+* @output: none
+*
+*--*/
+void twitMergeStream::closeSource( size_t source )
+{
+    std::lock_guard<std::mutex> emitLock( m_emitMutex );
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( source < m_sources.size() )
+        {
+            m_sources[source].closed = true;
+            collectReady( false );
+        }
+    }
+    release();
+}
+
+/*++
+* @method: twitMergeStream::flush
+*
+* @description: releases everything held back, e.g. before shutting down
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitMergeStream::flush()
+{
+    std::lock_guard<std::mutex> emitLock( m_emitMutex );
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        collectReady( true );
+    }
+    release();
+}
+
+/*++
+* @method: twitMergeStream::getBufferedCount
+*
+* @description: returns the number of tweets held back
+*
+* @input: none
+*
+* @output: tweet count
+*
+*--*/
+size_t twitMergeStream::getBufferedCount()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_bufferedCount;
+}
+
+/*++
+* @method: twitMergeStream::getLateCount
+*
+* @description: returns the number of tweets released out of order because
+*               their source lagged past the buffer limit
+*
+* @input: none
+*
+* @output: tweet count
+*
+*--*/
+unsigned long long twitMergeStream::getLateCount()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_lateCount;
+}
+
+/*++
+* @method: twitMergeStream::collectReady
+*
+* @description: moves the tweets every open source has passed, and the
+*               oldest ones beyond the buffer limit, to the ready list in id
+*               order. called with m_mutex held.
+*
+* @input: all - true to take everything buffered
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitMergeStream::collectReady( bool all )
+{
+    unsigned long long frontier = std::numeric_limits<unsigned long long>::max();
+    for( size_t i = 0; i < m_sources.size(); ++i )
+    {
+        if( !m_sources[i].closed )
+        {
+            frontier = std::min( frontier, m_sources[i].watermark );
+        }
+    }
+
+    while( !m_heads.empty() )
+    {
+        twitMergeHead head = m_heads.top();
+        std::deque<twitTweet>& buffer = m_sources[head.source].buffer;
+        if( buffer.empty() || buffer.front().id != head.id )
+        {
+            /* Stale, an older tweet was inserted in front of it */
+            m_heads.pop();
+            continue;
+        }
+        if( !all && head.id > frontier && m_bufferedCount <= m_maxBuffered )
+        {
+            break;
+        }
+        m_heads.pop();
+        if( head.id > m_releasedId )
+        {
+            m_ready.push_back( std::move( buffer.front() ) );
+            m_releasedId = head.id;
+        }
+        buffer.pop_front();
+        --m_bufferedCount;
+        if( buffer.size() )
+        {
+            twitMergeHead next = { buffer.front().id, head.source };
+            m_heads.push( next );
+        }
+    }
+}
+
+/*++
+* @method: twitMergeStream::release
+*
+* @description: hands the ready list to the callback. called with
+*               m_emitMutex held, so batches arrive in the order they were
+*               collected.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitMergeStream::release()
+{
+    std::vector<twitTweet> batch;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        batch.swap( m_ready );
+    }
+    if( batch.size() && m_callback )
+    {
+        m_callback( batch );
+    }
+}
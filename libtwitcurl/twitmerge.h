@@ -0,0 +1,100 @@
+#ifndef _TWITMERGE_H_
+#define _TWITMERGE_H_
+
+#include <deque>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include "twitmodel.h"
+
+namespace twitMergeDefaults
+{
+    const size_t TWITMERGE_MAX_BUFFERED = 10000;    /* tweets held back, all sources */
+};
+
+/* Receives merged tweets in ascending id order, one batch per release.
+   Called on the thread whose push() or advance() released the batch, never
+   on two threads at once. It must not call back into the stream. */
+typedef std::function<void( std::vector<twitTweet>& tweets )> twitMergeCallback;
+
+/* Tweet id of a time, seconds since epoch. Every tweet created at or after
+   it has a larger id, which makes it a watermark for a source that was
+   polled at that time and returned nothing new. */
+unsigned long long twitIdFromTime( unsigned long long secondsSinceEpoch /* in */ );
+
+/* twitMergeStream class
+*
+* Merges tweets of several sources into one stream in id order, which is
+* creation order. A source is anything that hands out tweets oldest first
+* together with a watermark, the id up to which it has delivered
+* everything: a twitTimelineSync timeline, a crawler account, a search
+* polled with since_id, and so on.
+*
+* Tweets are held back only until every open source's watermark has passed
+* them, then released through a k-way heap merge over the source buffers,
+* so the stream moves as soon as the slowest source allows rather than
+* after a full round. Ids delivered by several sources are released once.
+*
+* Buffering is bounded. When more than maxBuffered tweets are held back,
+* the oldest are released anyway; anything a lagging source delivers below
+* that point later is released right away, out of order, and counted by
+* getLateCount().
+*/
+class twitMergeStream
+{
+public:
+    twitMergeStream( const twitMergeCallback& callback /* in */,
+                     size_t maxBuffered = twitMergeDefaults::TWITMERGE_MAX_BUFFERED /* in */ );
+
+    size_t addSource( unsigned long long watermark = 0 /* in */ );
+    void push( size_t source /* in */,
+               std::vector<twitTweet>& tweets /* in, emptied */,
+               unsigned long long watermark = 0 /* in */ );
+    void advance( size_t source /* in */, unsigned long long watermark /* in */ );
+    void closeSource( size_t source /* in */ );
+    void flush();
+
+    size_t getBufferedCount();
+    unsigned long long getLateCount();
+
+private:
+    struct twitMergeSource
+    {
+        std::deque<twitTweet> buffer;
+        unsigned long long watermark;
+        bool closed;
+    };
+
+    /* Head of a source buffer in the merge heap, smallest id on top */
+    struct twitMergeHead
+    {
+        unsigned long long id;
+        size_t source;
+
+        bool operator<( const twitMergeHead& other ) const
+        {
+            return ( id != other.id ) ? id > other.id : source > other.source;
+        }
+    };
+
+    twitMergeCallback m_callback;
+    size_t m_maxBuffered;
+
+    std::mutex m_mutex;                 /* guards everything below */
+    std::mutex m_emitMutex;             /* keeps batches in order */
+    std::vector<twitMergeSource> m_sources;
+    std::priority_queue<twitMergeHead> m_heads;
+    std::vector<twitTweet> m_ready;
+    size_t m_bufferedCount;
+    unsigned long long m_releasedId;    /* largest id released */
+    unsigned long long m_lateCount;
+
+    void collectReady( bool all );
+    void release();
+
+    twitMergeStream( const twitMergeStream& );
+    twitMergeStream& operator=( const twitMergeStream& );
+};
+
+#endif // _TWITMERGE_H_
@@ -0,0 +1,162 @@
+#include "twitmmap.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*++
+* @method: twitMappedFile::twitMappedFile
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitMappedFile::twitMappedFile():
+m_open( false ),
+m_data( NULL ),
+m_size( 0 )
+#ifdef _WIN32
+, m_file( INVALID_HANDLE_VALUE )
+, m_mapping( NULL )
+#else
+, m_fd( -1 )
+#endif
+{
+}
+
+/*++
+* @method: twitMappedFile::~twitMappedFile
+*
+* @description: destructor, unmaps the file
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitMappedFile::~twitMappedFile()
+{
+    close();
+}
+
+/*++
+* @method: twitMappedFile::open
+*
+* @description: maps a file read-only. an empty file opens successfully
+*               with a NULL data pointer.
+*
+* @input: path - file to map
+*
+* @output: true if the file is mapped
+*
+*--*/
+bool twitMappedFile::open( const std::string& path )
+{
+    close();
+#ifdef _WIN32
+    m_file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( INVALID_HANDLE_VALUE == m_file )
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if( !GetFileSizeEx( m_file, &fileSize ) )
+    {
+        close();
+        return false;
+    }
+    m_size = (size_t)fileSize.QuadPart;
+    if( m_size )
+    {
+        m_mapping = CreateFileMappingA( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+        if( !m_mapping )
+        {
+            close();
+            return false;
+        }
+        m_data = (const char*)MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+        if( !m_data )
+        {
+            close();
+            return false;
+        }
+    }
+#else
+    m_fd = ::open( path.c_str(), O_RDONLY );
+    if( m_fd < 0 )
+    {
+        return false;
+    }
+    struct stat st;
+    if( fstat( m_fd, &st ) != 0 )
+    {
+        close();
+        return false;
+    }
+    m_size = (size_t)st.st_size;
+    if( m_size )
+    {
+        void* addr = mmap( NULL, m_size, PROT_READ, MAP_SHARED, m_fd, 0 );
+        if( MAP_FAILED == addr )
+        {
+            m_size = 0;
+            close();
+            return false;
+        }
+        m_data = (const char*)addr;
+    }
+#endif
+    m_open = true;
+    return true;
+}
+
+/*++
+* @method: twitMappedFile::close
+*
+* @description: unmaps the file
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitMappedFile::close()
+{
+#ifdef _WIN32
+    if( m_data )
+    {
+        UnmapViewOfFile( m_data );
+    }
+    if( m_mapping )
+    {
+        CloseHandle( m_mapping );
+        m_mapping = NULL;
+    }
+    if( INVALID_HANDLE_VALUE != m_file )
+    {
+        CloseHandle( m_file );
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if( m_data )
+    {
+        munmap( (void*)m_data, m_size );
+    }
+    if( m_fd >= 0 )
+    {
+        ::close( m_fd );
+        m_fd = -1;
+    }
+#endif
+    m_data = NULL;
+    m_size = 0;
+    m_open = false;
+}
@@ -0,0 +1,40 @@
+#ifndef _TWITMMAP_H_
+#define _TWITMMAP_H_
+
+#include <string>
+#include <cstddef>
+
+/* twitMappedFile class
+*
+* Read-only memory mapping of a whole file. The mapped bytes stay valid until
+* close() or destruction.
+*/
+class twitMappedFile
+{
+public:
+    twitMappedFile();
+    ~twitMappedFile();
+
+    bool open( const std::string& path /* in */ );
+    void close();
+
+    bool isOpen() const { return m_open; }
+    const char* getData() const { return m_data; }
+    size_t getSize() const { return m_size; }
+
+private:
+    bool m_open;
+    const char* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+
+    twitMappedFile( const twitMappedFile& );
+    twitMappedFile& operator=( const twitMappedFile& );
+};
+
+#endif // _TWITMMAP_H_
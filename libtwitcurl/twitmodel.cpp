@@ -0,0 +1,450 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include "twitmodel.h"
+
+/*++
+* @method: twitUser::twitUser
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitUser::twitUser():
+id( 0 ),
+createdAt( 0 ),
+followersCount( 0 ),
+friendsCount( 0 ),
+statusesCount( 0 ),
+isProtected( false ),
+isVerified( false ),
+screenName( twitInternPool::emptyString() ),
+name( twitInternPool::emptyString() ),
+location( twitInternPool::emptyString() ),
+profileImageUrl( twitInternPool::emptyString() )
+{
+}
+
+/*++
+* @method: twitTweet::twitTweet
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitTweet::twitTweet():
+id( 0 ),
+createdAt( 0 ),
+userId( 0 ),
+inReplyToStatusId( 0 ),
+retweetedStatusId( 0 ),
+retweetCount( 0 ),
+favoriteCount( 0 ),
+userScreenName( twitInternPool::emptyString() ),
+lang( twitInternPool::emptyString() )
+{
+}
+
+/*++
+* @method: twitParseId
+*
+* @description: converts a decimal id string to a number
+*
+* @input: idStr - id in string format
+*
+* @output: id, 0 if idStr is not a number
+*
+*--*/
+unsigned long long twitParseId( const std::string& idStr )
+{
+    unsigned long long id = 0;
+    for( size_t i = 0; i < idStr.size(); ++i )
+    {
+        char c = idStr[i];
+        if( c < '0' || c > '9' )
+        {
+            return ( i == 0 ) ? 0 : id;
+        }
+        id = id * 10 + (unsigned long long)( c - '0' );
+    }
+    return id;
+}
+
+/*++
+* @method: twitParseCreatedAt
+*
+* @description: converts twitter's created_at format
+*               ("Wed Aug 27 13:08:45 +0000 2008") to seconds since epoch
+*
+* @input: createdAt - time in twitter format
+*
+* @output: seconds since epoch, 0 if the format is not recognized
+*
+*--*/
+unsigned long long twitParseCreatedAt( const std::string& createdAt )
+{
+    static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    int day = 0, hour = 0, minute = 0, second = 0, offset = 0;
+    long year = 0;
+    char month[4] = { 0 };
+    char sign = '+';
+
+    /* Day of week is ignored, it is implied by the date */
+    if( createdAt.size() < 30 ||
+        sscanf( createdAt.c_str() + 4, "%3s %d %d:%d:%d %c%4d %ld",
+                month, &day, &hour, &minute, &second, &sign, &offset, &year ) != 8 )
+    {
+        return 0;
+    }
+    const char* found = strstr( months, month );
+    if( !found || day < 1 || year < 1970 )
+    {
+        return 0;
+    }
+    unsigned int mon = (unsigned int)( found - months ) / 3 + 1;
+
+    /* Days from civil date, Howard Hinnant's algorithm */
+    long y = year - ( mon <= 2 ? 1 : 0 );
+    long era = y / 400;
+    unsigned long yoe = (unsigned long)( y - era * 400 );
+    unsigned long doy = ( 153 * ( mon + ( mon > 2 ? -3 : 9 ) ) + 2 ) / 5 + day - 1;
+    unsigned long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = (long long)era * 146097 + (long long)doe - 719468;
+
+    long long secs = days * 86400 + hour * 3600 + minute * 60 + second;
+    long long tz = ( offset / 100 ) * 3600 + ( offset % 100 ) * 60;
+    secs += ( sign == '-' ) ? tz : -tz;
+    return ( secs > 0 ) ? (unsigned long long)secs : 0;
+}
+
+/*++
+* @method: twitGetJsonId
+*
+* @description: reads an id field. the "<key>_str" variant is preferred as
+*               the numeric one does not survive a trip through a double.
+*
+* @input: json - object holding the id,
+*         key - id field name
+*
+* @output: id, 0 if absent
+*
+*--*/
+unsigned long long twitGetJsonId( const picojson::value& json, const char* key )
+{
+    std::string strKey = std::string( key ) + "_str";
+    if( json.contains( strKey ) )
+    {
+        const picojson::value& v = json.get( strKey );
+        if( v.is<std::string>() )
+        {
+            return twitParseId( v.get<std::string>() );
+        }
+    }
+    if( json.contains( key ) )
+    {
+        const picojson::value& v = json.get( key );
+        if( v.is<double>() )
+        {
+            return (unsigned long long)v.get<double>();
+        }
+        if( v.is<std::string>() )
+        {
+            return twitParseId( v.get<std::string>() );
+        }
+    }
+    return 0;
+}
+
+/*++
+* @method: twitGetJsonCount
+*
+* @description: reads a non negative counter field
+*
+* @input: json - object holding the counter,
+*         key - counter field name
+*
+* @output: counter, 0 if absent
+*
+*--*/
+unsigned int twitGetJsonCount( const picojson::value& json, const char* key )
+{
+    if( json.contains( key ) )
+    {
+        const picojson::value& v = json.get( key );
+        if( v.is<double>() && v.get<double>() > 0 )
+        {
+            return (unsigned int)v.get<double>();
+        }
+    }
+    return 0;
+}
+
+/*++
+* @method: twitInternField
+*
+* @description: interns a string field of a JSON object. this is an internal
+*               function.
+*
+* @input: json - object holding the field,
+*         key - field name,
+*         pool - intern pool
+*
+* @output: interned handle, empty string handle if absent
+*
+* @remarks: internal function
+*
+*--*/
+static twitInternStr twitInternField( const picojson::value& json, const char* key, twitInternPool& pool )
+{
+    if( json.contains( key ) )
+    {
+        const picojson::value& v = json.get( key );
+        if( v.is<std::string>() )
+        {
+            return pool.intern( v.get<std::string>() );
+        }
+    }
+    return twitInternPool::emptyString();
+}
+
+/*++
+* @method: twitInternEntities
+*
+* @description: interns one field of every element of an entities array.
+*               this is an internal function.
+*
+* @input: entities - tweet "entities" object,
+*         kind - entity array name,
+*         key - field to take from each element,
+*         pool - intern pool
+*
+* @output: outList - interned handles
+*
+* @remarks: internal function
+*
+*--*/
+static void twitInternEntities( const picojson::value& entities, const char* kind, const char* key,
+                                twitInternPool& pool, std::vector<twitInternStr>& outList )
+{
+    if( !entities.contains( kind ) || !entities.get( kind ).is<picojson::array>() )
+    {
+        return;
+    }
+    const picojson::array& arr = entities.get( kind ).get<picojson::array>();
+    outList.reserve( arr.size() );
+    for( size_t i = 0; i < arr.size(); ++i )
+    {
+        twitInternStr s = twitInternField( arr[i], key, pool );
+        if( !s->empty() )
+        {
+            outList.push_back( s );
+        }
+    }
+}
+
+/*++
+* @method: twitParseUser
+*
+* @description: converts a JSON user object
+*
+* @input: json - user object,
+*         pool - pool that receives repeated strings
+*
+* @output: outUser - parsed user, true if json was a user object
+*
+*--*/
+bool twitParseUser( const picojson::value& json, twitUser& outUser, twitInternPool& pool )
+{
+    if( !json.is<picojson::object>() )
+    {
+        return false;
+    }
+    outUser.id = twitGetJsonId( json, "id" );
+    if( !outUser.id )
+    {
+        return false;
+    }
+    if( json.contains( "created_at" ) && json.get( "created_at" ).is<std::string>() )
+    {
+        outUser.createdAt = twitParseCreatedAt( json.get( "created_at" ).get<std::string>() );
+    }
+    outUser.followersCount = twitGetJsonCount( json, "followers_count" );
+    outUser.friendsCount = twitGetJsonCount( json, "friends_count" );
+    outUser.statusesCount = twitGetJsonCount( json, "statuses_count" );
+    outUser.isProtected = json.contains( "protected" ) && json.get( "protected" ).evaluate_as_boolean();
+    outUser.isVerified = json.contains( "verified" ) && json.get( "verified" ).evaluate_as_boolean();
+    outUser.screenName = twitInternField( json, "screen_name", pool );
+    outUser.name = twitInternField( json, "name", pool );
+    outUser.location = twitInternField( json, "location", pool );
+    outUser.profileImageUrl = twitInternField( json, "profile_image_url_https", pool );
+    if( json.contains( "description" ) && json.get( "description" ).is<std::string>() )
+    {
+        outUser.description = json.get( "description" ).get<std::string>();
+    }
+    return true;
+}
+
+/*++
+* @method: twitParseUsers
+*
+* @description: converts a JSON array of users, as returned by users/lookup,
+*               or an object with a "users" array, as returned by blocks/list
+*
+* @input: json - users response,
+*         pool - pool that receives repeated strings
+*
+* @output: outUsers - parsed users are appended, returns number appended
+*
+*--*/
+size_t twitParseUsers( const picojson::value& json, std::vector<twitUser>& outUsers, twitInternPool& pool )
+{
+    const picojson::value* arrValue = &json;
+    if( json.is<picojson::object>() && json.contains( "users" ) )
+    {
+        arrValue = &json.get( "users" );
+    }
+    if( !arrValue->is<picojson::array>() )
+    {
+        return 0;
+    }
+
+    const picojson::array& arr = arrValue->get<picojson::array>();
+    size_t before = outUsers.size();
+    outUsers.reserve( before + arr.size() );
+    for( size_t i = 0; i < arr.size(); ++i )
+    {
+        outUsers.push_back( twitUser() );
+        if( !twitParseUser( arr[i], outUsers.back(), pool ) )
+        {
+            outUsers.pop_back();
+        }
+    }
+    return outUsers.size() - before;
+}
+
+/*++
+* @method: twitParseTweet
+*
+* @description: converts a JSON tweet object. direct messages are accepted
+*               too, their sender takes the place of the tweet's user.
+*
+* @input: json - tweet object,
+*         pool - pool that receives repeated strings
+*
+* @output: outTweet - parsed tweet, true if json was a tweet object
+*
+*--*/
+bool twitParseTweet( const picojson::value& json, twitTweet& outTweet, twitInternPool& pool )
+{
+    if( !json.is<picojson::object>() )
+    {
+        return false;
+    }
+    outTweet.id = twitGetJsonId( json, "id" );
+    if( !outTweet.id )
+    {
+        return false;
+    }
+    if( json.contains( "created_at" ) && json.get( "created_at" ).is<std::string>() )
+    {
+        outTweet.createdAt = twitParseCreatedAt( json.get( "created_at" ).get<std::string>() );
+    }
+    outTweet.inReplyToStatusId = twitGetJsonId( json, "in_reply_to_status_id" );
+    outTweet.retweetCount = twitGetJsonCount( json, "retweet_count" );
+    outTweet.favoriteCount = twitGetJsonCount( json, "favorite_count" );
+    outTweet.lang = twitInternField( json, "lang", pool );
+
+    /* Extended tweets carry their text in full_text */
+    const char* textKey = json.contains( "full_text" ) ? "full_text" : "text";
+    if( json.contains( textKey ) && json.get( textKey ).is<std::string>() )
+    {
+        outTweet.text = json.get( textKey ).get<std::string>();
+    }
+
+    const char* userKey = json.contains( "user" ) ? "user" : "sender";
+    if( json.contains( userKey ) && json.get( userKey ).is<picojson::object>() )
+    {
+        const picojson::value& user = json.get( userKey );
+        outTweet.userId = twitGetJsonId( user, "id" );
+        outTweet.userScreenName = twitInternField( user, "screen_name", pool );
+    }
+    else if( json.contains( "sender_id" ) )
+    {
+        outTweet.userId = twitGetJsonId( json, "sender_id" );
+        outTweet.userScreenName = twitInternField( json, "sender_screen_name", pool );
+    }
+
+    if( json.contains( "retweeted_status" ) && json.get( "retweeted_status" ).is<picojson::object>() )
+    {
+        outTweet.retweetedStatusId = twitGetJsonId( json.get( "retweeted_status" ), "id" );
+    }
+
+    if( json.contains( "entities" ) && json.get( "entities" ).is<picojson::object>() )
+    {
+        const picojson::value& entities = json.get( "entities" );
+        twitInternEntities( entities, "hashtags", "text", pool, outTweet.hashtags );
+        twitInternEntities( entities, "urls", "expanded_url", pool, outTweet.urls );
+        twitInternEntities( entities, "user_mentions", "screen_name", pool, outTweet.mentions );
+    }
+    return true;
+}
+
+/*++
+* @method: twitParseTweets
+*
+* @description: converts a timeline (JSON array of tweets) or a search
+*               response (object with a "statuses" array)
+*
+* @input: json - timeline or search response,
+*         pool - pool that receives repeated strings
+*
+* @output: outTweets - parsed tweets are appended,
+*          outUsers - if not NULL, every distinct author is appended once,
+*          returns number of tweets appended
+*
+*--*/
+size_t twitParseTweets( const picojson::value& json, std::vector<twitTweet>& outTweets,
+                        twitInternPool& pool, std::vector<twitUser>* outUsers )
+{
+    const picojson::value* arrValue = &json;
+    if( json.is<picojson::object>() && json.contains( "statuses" ) )
+    {
+        arrValue = &json.get( "statuses" );
+    }
+    if( !arrValue->is<picojson::array>() )
+    {
+        return 0;
+    }
+
+    const picojson::array& arr = arrValue->get<picojson::array>();
+    std::unordered_set<unsigned long long> seenUsers;
+    size_t before = outTweets.size();
+    outTweets.reserve( before + arr.size() );
+    for( size_t i = 0; i < arr.size(); ++i )
+    {
+        outTweets.push_back( twitTweet() );
+        if( !twitParseTweet( arr[i], outTweets.back(), pool ) )
+        {
+            outTweets.pop_back();
+            continue;
+        }
+
+        /* Timelines repeat the same author object, keep it once */
+        if( outUsers && arr[i].contains( "user" ) && seenUsers.insert( outTweets.back().userId ).second )
+        {
+            outUsers->push_back( twitUser() );
+            if( !twitParseUser( arr[i].get( "user" ), outUsers->back(), pool ) )
+            {
+                outUsers->pop_back();
+            }
+        }
+    }
+    return outTweets.size() - before;
+}
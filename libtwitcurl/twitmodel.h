@@ -0,0 +1,64 @@
+#ifndef _TWITMODEL_H_
+#define _TWITMODEL_H_
+
+#include <string>
+#include <vector>
+#include <picojson/picojson.h>
+#include "twitintern.h"
+
+/* Typed twitter objects built from JSON responses. Strings that repeat across
+   responses (names, urls, hashtags, ...) are interned handles; free text is
+   stored inline. */
+struct twitUser
+{
+    unsigned long long id;
+    unsigned long long createdAt;       /* seconds since epoch */
+    unsigned int followersCount;
+    unsigned int friendsCount;
+    unsigned int statusesCount;
+    bool isProtected;
+    bool isVerified;
+    twitInternStr screenName;
+    twitInternStr name;
+    twitInternStr location;
+    twitInternStr profileImageUrl;
+    std::string description;
+
+    twitUser();
+};
+
+struct twitTweet
+{
+    unsigned long long id;
+    unsigned long long createdAt;       /* seconds since epoch */
+    unsigned long long userId;
+    unsigned long long inReplyToStatusId;
+    unsigned long long retweetedStatusId;
+    unsigned int retweetCount;
+    unsigned int favoriteCount;
+    twitInternStr userScreenName;
+    twitInternStr lang;
+    std::string text;
+    std::vector<twitInternStr> hashtags;
+    std::vector<twitInternStr> urls;
+    std::vector<twitInternStr> mentions;
+
+    twitTweet();
+};
+
+/* JSON to typed object conversion */
+bool twitParseUser( const picojson::value& json /* in */, twitUser& outUser /* out */, twitInternPool& pool /* in */ );
+size_t twitParseUsers( const picojson::value& json /* in */, std::vector<twitUser>& outUsers /* out */, twitInternPool& pool /* in */ );
+bool twitParseTweet( const picojson::value& json /* in */, twitTweet& outTweet /* out */, twitInternPool& pool /* in */ );
+size_t twitParseTweets( const picojson::value& json /* in */,
+                        std::vector<twitTweet>& outTweets /* out */,
+                        twitInternPool& pool /* in */,
+                        std::vector<twitUser>* outUsers = NULL /* out */ );
+
+/* Field helpers */
+unsigned long long twitParseId( const std::string& idStr /* in */ );
+unsigned long long twitParseCreatedAt( const std::string& createdAt /* in */ );
+unsigned long long twitGetJsonId( const picojson::value& json /* in */, const char* key /* in */ );
+unsigned int twitGetJsonCount( const picojson::value& json /* in */, const char* key /* in */ );
+
+#endif // _TWITMODEL_H_
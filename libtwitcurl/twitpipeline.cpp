@@ -0,0 +1,243 @@
+#include "twitpipeline.h"
+
+/*++
+* @method: twitParsePipeline::twitParsePipeline
+*
+* @description: constructor, starts the parser threads
+*
+* @input: workerCount - number of parser threads, 0 picks one per spare core
+*
+* @output: none
+*
+*--*/
+twitParsePipeline::twitParsePipeline( unsigned int workerCount ):
+m_pending( 0 ),
+m_stop( false )
+{
+    if( 0 == workerCount )
+    {
+        /* Leave one core to the transport thread */
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = ( cores > 1 ) ? cores - 1 : 1;
+    }
+    for( unsigned int i = 0; i < workerCount; ++i )
+    {
+        m_workers.push_back( std::thread( [this](){ workerLoop(); } ) );
+    }
+}
+
+/*++
+* @method: twitParsePipeline::~twitParsePipeline
+*
+* @description: destructor, delivers everything already submitted and
+*               stops the parser threads
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitParsePipeline::~twitParsePipeline()
+{
+    flush();
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_stop = true;
+    }
+    m_jobCondition.notify_all();
+    for( size_t i = 0; i < m_workers.size(); ++i )
+    {
+        m_workers[i].join();
+    }
+}
+
+/*++
+* @method: twitParsePipeline::submit
+*
+* @description: queues a response buffer for parsing. the buffer is swapped
+*               into the pipeline, so no copy of the payload is made and
+*               the caller gets an empty string back.
+*
+* @input: streamId - stream the result is ordered in,
+*         buffer - raw response,
+*         onParsed - callback receiving the parsed result
+*
+* @output: true if the buffer was queued
+*
+*--*/
+bool twitParsePipeline::submit( unsigned int streamId, std::string& buffer, const twitParseCallback& onParsed )
+{
+    twitParseJob* job = new twitParseJob();
+    job->result.streamId = streamId;
+    job->result.buffer.swap( buffer );
+    job->onParsed = onParsed;
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if( m_stop )
+        {
+            buffer.swap( job->result.buffer );
+            delete job;
+            return false;
+        }
+        job->result.sequence = m_streams[streamId].nextSubmit++;
+        m_jobs.push_back( job );
+        ++m_pending;
+    }
+    m_jobCondition.notify_one();
+    return true;
+}
+
+/*++
+* @method: twitParsePipeline::submit
+*
+* @description: queues the last web response of a twitCurl object for
+*               parsing. the response is moved out of twitCurl, so call this
+*               right after the API method returned true.
+*
+* @input: twitObj - twitCurl object that performed the request,
+*         streamId - stream the result is ordered in,
+*         onParsed - callback receiving the parsed result
+*
+* @output: true if the response was queued
+*
+*--*/
+bool twitParsePipeline::submit( twitCurl& twitObj, unsigned int streamId, const twitParseCallback& onParsed )
+{
+    std::string buffer;
+    twitObj.takeLastWebResponse( buffer );
+    return submit( streamId, buffer, onParsed );
+}
+
+/*++
+* @method: twitParsePipeline::flush
+*
+* @description: blocks until every buffer submitted so far was delivered
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitParsePipeline::flush()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    while( m_pending )
+    {
+        m_idleCondition.wait( lock );
+    }
+}
+
+/*++
+* @method: twitParsePipeline::getWorkerCount
+*
+* @description: returns number of parser threads
+*
+* @input: none
+*
+* @output: number of parser threads
+*
+*--*/
+unsigned int twitParsePipeline::getWorkerCount()
+{
+    return (unsigned int)m_workers.size();
+}
+
+/*++
+* @method: twitParsePipeline::workerLoop
+*
+* @description: parser thread body. this is an internal method.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitParsePipeline::workerLoop()
+{
+    for( ;; )
+    {
+        twitParseJob* job = NULL;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            while( !m_stop && m_jobs.empty() )
+            {
+                m_jobCondition.wait( lock );
+            }
+            if( m_jobs.empty() )
+            {
+                return;
+            }
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        /* Parse outside the lock, this is where the pool earns its keep */
+        twitParseResult& result = job->result;
+        const char* begin = result.buffer.data();
+        picojson::parse( result.json, begin, begin + result.buffer.size(), &result.error );
+
+        deliver( job );
+    }
+}
+
+/*++
+* @method: twitParsePipeline::deliver
+*
+* @description: hands a parsed job to its stream. the first thread to find
+*               the stream idle delivers every in-order result that is ready,
+*               so callbacks of one stream never run concurrently.
+*
+* @input: job - parsed job
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitParsePipeline::deliver( twitParseJob* job )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    const unsigned int streamId = job->result.streamId;
+    twitParseStream* stream = &m_streams[streamId];
+    stream->ready[job->result.sequence] = job;
+    if( stream->delivering )
+    {
+        return;
+    }
+
+    stream->delivering = true;
+    unsigned long long delivered = 0;
+    while( !stream->ready.empty() && stream->ready.begin()->first == stream->nextDeliver )
+    {
+        twitParseJob* next = stream->ready.begin()->second;
+        stream->ready.erase( stream->ready.begin() );
+        ++stream->nextDeliver;
+
+        lock.unlock();
+        if( next->onParsed )
+        {
+            next->onParsed( next->result );
+        }
+        delete next;
+        lock.lock();
+
+        /* std::map nodes are stable, but re-fetch for clarity after unlocking */
+        stream = &m_streams[streamId];
+        ++delivered;
+    }
+    stream->delivering = false;
+
+    /* Forget idle streams so the map does not grow with every stream id */
+    if( stream->ready.empty() && stream->nextDeliver == stream->nextSubmit )
+    {
+        m_streams.erase( streamId );
+    }
+
+    m_pending -= delivered;
+    if( 0 == m_pending )
+    {
+        m_idleCondition.notify_all();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef _TWITPIPELINE_H_
+#define _TWITPIPELINE_H_
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <picojson/picojson.h>
+#include "twitcurl.h"
+
+/* One parsed response, handed to the consumer of a pipeline stream */
+struct twitParseResult
+{
+    unsigned int streamId;
+    unsigned long long sequence;
+    std::string buffer;     /* raw response, swapped in from the caller */
+    picojson::value json;
+    std::string error;      /* picojson parse error, empty on success */
+};
+
+typedef std::function<void ( twitParseResult& )> twitParseCallback;
+
+/* twitParsePipeline class
+*
+* Decodes completed response buffers on a pool of parser threads so that the
+* thread driving twitCurl can go straight back to the network. Results of a
+* stream are delivered to its callbacks one at a time and in submit order;
+* different streams are delivered independently of each other.
+*/
+class twitParsePipeline
+{
+public:
+    twitParsePipeline( unsigned int workerCount = 0 /* in */ );
+    ~twitParsePipeline();
+
+    bool submit( unsigned int streamId /* in */,
+                 std::string& buffer /* in, emptied */,
+                 const twitParseCallback& onParsed /* in */ );
+    bool submit( twitCurl& twitObj /* in */,
+                 unsigned int streamId /* in */,
+                 const twitParseCallback& onParsed /* in */ );
+    void flush();
+
+    unsigned int getWorkerCount();
+
+private:
+    struct twitParseJob
+    {
+        twitParseResult result;
+        twitParseCallback onParsed;
+    };
+
+    struct twitParseStream
+    {
+        unsigned long long nextSubmit;
+        unsigned long long nextDeliver;
+        bool delivering;
+        std::map<unsigned long long, twitParseJob*> ready;
+
+        twitParseStream() : nextSubmit( 0 ), nextDeliver( 0 ), delivering( false ) {}
+    };
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_jobCondition;
+    std::condition_variable m_idleCondition;
+    std::deque<twitParseJob*> m_jobs;
+    std::map<unsigned int, twitParseStream> m_streams;
+    unsigned long long m_pending;
+    bool m_stop;
+
+    void workerLoop();
+    void deliver( twitParseJob* job );
+};
+
+#endif // _TWITPIPELINE_H_
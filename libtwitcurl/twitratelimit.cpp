@@ -0,0 +1,199 @@
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+#include "twitratelimit.h"
+
+/*++
+* @method: twitRateBudget::twitRateBudget
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitRateBudget::twitRateBudget():
+m_interrupted( false )
+{
+}
+
+/*++
+* @method: twitRateBudget::acquire
+*
+* @description: takes one call out of a resource's window, blocking until the
+*               window resets if it is used up. resources twitter has not
+*               reported yet are never blocked.
+*
+* @input: resource - rate limit resource name,
+*         cancelled - optional flag of the caller, checked while waiting
+*
+* @output: true if the call may be made, false if interrupt() was called
+*          or the caller's flag was raised
+*
+*--*/
+bool twitRateBudget::acquire( const std::string& resource, const std::atomic<bool>* cancelled )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    for( ;; )
+    {
+        if( m_interrupted || ( cancelled && *cancelled ) )
+        {
+            return false;
+        }
+
+        twitRateWindow& window = m_windows[resource];
+        unsigned long long now = (unsigned long long)time( NULL );
+        if( window.remaining < 0 || now >= window.reset )
+        {
+            /* Unknown or already reset window, the response will tell */
+            window.remaining = -1;
+            return true;
+        }
+        if( window.remaining > 0 )
+        {
+            --window.remaining;
+            return true;
+        }
+
+        /* Sleep past the reset time; one extra second absorbs clock skew */
+        std::chrono::system_clock::time_point wakeUp =
+            std::chrono::system_clock::from_time_t( (time_t)window.reset + 1 );
+        if( cancelled )
+        {
+            /* Nobody notifies us about the caller's flag, poll it */
+            wakeUp = std::min( wakeUp, std::chrono::system_clock::now() + std::chrono::seconds( 1 ) );
+        }
+        m_condition.wait_until( lock, wakeUp );
+    }
+}
+
+/*++
+* @method: twitRateBudget::update
+*
+* @description: records the window reported in a response
+*
+* @input: resource - rate limit resource name,
+*         rateLimit - rate limit of the response, see twitCurl::getLastRateLimit
+*
+* @output: none
+*
+*--*/
+void twitRateBudget::update( const std::string& resource, const twitRateLimit& rateLimit )
+{
+    if( rateLimit.remaining < 0 || 0 == rateLimit.reset )
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock( m_mutex );
+    twitRateWindow& window = m_windows[resource];
+    window.remaining = rateLimit.remaining;
+    window.reset = rateLimit.reset;
+}
+
+/*++
+* @method: twitRateBudget::exhaust
+*
+* @description: marks a window as used up, for responses that were rate
+*               limited without usable headers
+*
+* @input: resource - rate limit resource name,
+*         reset - time the window resets, seconds since epoch
+*
+* @output: none
+*
+*--*/
+void twitRateBudget::exhaust( const std::string& resource, unsigned long long reset )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    twitRateWindow& window = m_windows[resource];
+    window.remaining = 0;
+    window.reset = reset;
+}
+
+/*++
+* @method: twitRateBudget::recordResponse
+*
+* @description: records the window reported in the last response of a
+*               twitCurl object, marking the window used up if the request
+*               was rate limited
+*
+* @input: resource - rate limit resource name,
+*         twitObj - twitCurl object that made the request
+*
+* @output: false if the request was rate limited and should be retried once
+*          acquire() lets it through again, otherwise true
+*
+*--*/
+bool twitRateBudget::recordResponse( const std::string& resource, twitCurl& twitObj )
+{
+    twitRateLimit rateLimit;
+    twitObj.getLastRateLimit( rateLimit );
+    if( 429 != twitObj.getLastHttpStatus() )
+    {
+        update( resource, rateLimit );
+        return true;
+    }
+
+    /* Without a reset time, back off for a full 15 minute window */
+    exhaust( resource, rateLimit.reset ? rateLimit.reset : (unsigned long long)time( NULL ) + 15 * 60 );
+    return false;
+}
+
+/*++
+* @method: twitRateBudget::interrupt
+*
+* @description: wakes every blocked acquire() and makes all further calls
+*               fail, used when shutting down
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitRateBudget::interrupt()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_interrupted = true;
+    }
+    m_condition.notify_all();
+}
+
+/*++
+* @method: twitRateBudget::getRemaining
+*
+* @description: returns the calls left in a resource's window
+*
+* @input: resource - rate limit resource name
+*
+* @output: remaining calls, -1 if unknown
+*
+*--*/
+int twitRateBudget::getRemaining( const std::string& resource )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::map<std::string, twitRateWindow>::iterator it = m_windows.find( resource );
+    if( it == m_windows.end() || (unsigned long long)time( NULL ) >= it->second.reset )
+    {
+        return -1;
+    }
+    return it->second.remaining;
+}
+
+/*++
+* @method: twitRateBudget::getReset
+*
+* @description: returns when a resource's window resets
+*
+* @input: resource - rate limit resource name
+*
+* @output: seconds since epoch, 0 if unknown
+*
+*--*/
+unsigned long long twitRateBudget::getReset( const std::string& resource )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::map<std::string, twitRateWindow>::iterator it = m_windows.find( resource );
+    return ( it == m_windows.end() ) ? 0 : it->second.reset;
+}
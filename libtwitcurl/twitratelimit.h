@@ -0,0 +1,61 @@
+#ifndef _TWITRATELIMIT_H_
+#define _TWITRATELIMIT_H_
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "twitcurl.h"
+
+/* Rate limit resource names, as used by twitter's rate_limit_status */
+namespace twitRateResources
+{
+    const std::string TWITRATE_FRIENDS_IDS = "/friends/ids";
+    const std::string TWITRATE_FOLLOWERS_IDS = "/followers/ids";
+    const std::string TWITRATE_BLOCKS_IDS = "/blocks/ids";
+    const std::string TWITRATE_BLOCKS_LIST = "/blocks/list";
+    const std::string TWITRATE_USERS_LOOKUP = "/users/lookup";
+    const std::string TWITRATE_SEARCH_TWEETS = "/search/tweets";
+    const std::string TWITRATE_HOME_TIMELINE = "/statuses/home_timeline";
+    const std::string TWITRATE_USER_TIMELINE = "/statuses/user_timeline";
+    const std::string TWITRATE_MENTIONS_TIMELINE = "/statuses/mentions_timeline";
+    const std::string TWITRATE_DIRECT_MESSAGES = "/direct_messages";
+};
+
+/* twitRateBudget class
+*
+* Keeps track of the remaining calls of each rate limit window, as reported
+* by twitter, so that the bulk helpers can hold back instead of hitting 429.
+* One budget should be shared by everything using the same credentials.
+*/
+class twitRateBudget
+{
+public:
+    twitRateBudget();
+
+    bool acquire( const std::string& resource /* in */, const std::atomic<bool>* cancelled = NULL /* in */ );
+    void update( const std::string& resource /* in */, const twitRateLimit& rateLimit /* in */ );
+    void exhaust( const std::string& resource /* in */, unsigned long long reset /* in */ );
+    bool recordResponse( const std::string& resource /* in */, twitCurl& twitObj /* in */ );
+    void interrupt();
+
+    int getRemaining( const std::string& resource /* in */ );
+    unsigned long long getReset( const std::string& resource /* in */ );
+
+private:
+    struct twitRateWindow
+    {
+        int remaining;              /* -1 until twitter told us */
+        unsigned long long reset;
+
+        twitRateWindow() : remaining( -1 ), reset( 0 ) {}
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::map<std::string, twitRateWindow> m_windows;
+    bool m_interrupted;
+};
+
+#endif // _TWITRATELIMIT_H_
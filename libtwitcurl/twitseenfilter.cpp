@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cmath>
+#include "twitseenfilter.h"
+
+namespace
+{
+    const unsigned int TWITSEEN_BLOCK_BITS = 512;
+    const unsigned int TWITSEEN_MAX_HASHES = 16;
+
+    /* Bits per id of a classic Bloom filter, plus a margin for the uneven
+       load of blocked filters */
+    const double TWITSEEN_BLOCK_OVERHEAD = 1.2;
+
+    /* splitmix64 finalizer. tweet ids are timestamps with a few sequence
+       bits, far from uniform, so every bit of the id has to be mixed in */
+    unsigned long long mixId( unsigned long long id )
+    {
+        id += 0x9e3779b97f4a7c15ULL;
+        id = ( id ^ ( id >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+        id = ( id ^ ( id >> 27 ) ) * 0x94d049bb133111ebULL;
+        return id ^ ( id >> 31 );
+    }
+
+    /* Block of a hash, from its high half */
+    size_t blockIndex( unsigned long long hash, size_t blockCount )
+    {
+        return (size_t)( ( ( hash >> 32 ) * blockCount ) >> 32 );
+    }
+
+    /* Position of the i-th bit of an id in its block. The first three come
+       from the low half of the hash, the rest from remixing it, so that the
+       positions are independent of each other and of the block index. */
+    unsigned int nextBit( unsigned long long& bits, unsigned int i )
+    {
+        if( i && !( i % 3 ) )
+        {
+            bits = mixId( bits );
+        }
+        return (unsigned int)( bits >> ( 9 * ( i % 3 ) ) ) % TWITSEEN_BLOCK_BITS;
+    }
+}
+
+/*++
+* @method: twitSeenFilter::twitSeenFilter
+*
+* @description: constructor, allocates both generations up front
+*
+* @input: capacity - ids one generation is sized for; a generation that
+*                    reaches it is rotated out early to hold the error rate,
+*         falsePositiveRate - chance of dropping an id that was not seen,
+*         generationSecs - lifetime of a generation, 0 to rotate by count
+*                          only. ids are remembered at least this long.
+*
+* @output: none
+*
+*--*/
+twitSeenFilter::twitSeenFilter( size_t capacity, double falsePositiveRate, unsigned int generationSecs ):
+m_current( 0 ),
+m_capacity( std::max( capacity, (size_t)1 ) ),
+m_hashCount( 1 ),
+m_generationSecs( generationSecs )
+{
+    if( !( falsePositiveRate > 0.0 && falsePositiveRate < 1.0 ) )
+    {
+        falsePositiveRate = twitSeenFilterDefaults::TWITSEEN_DEFAULT_FALSE_POSITIVE_RATE;
+    }
+    const double ln2 = std::log( 2.0 );
+    double bitsPerId = -std::log( falsePositiveRate ) / ( ln2 * ln2 ) * TWITSEEN_BLOCK_OVERHEAD;
+    double hashes = std::floor( bitsPerId / TWITSEEN_BLOCK_OVERHEAD * ln2 + 0.5 );
+    m_hashCount = (unsigned int)std::min( std::max( hashes, 1.0 ), (double)TWITSEEN_MAX_HASHES );
+
+    size_t blockCount = (size_t)std::ceil( bitsPerId * m_capacity / TWITSEEN_BLOCK_BITS );
+    for( int i = 0; i < 2; ++i )
+    {
+        m_generations[i].blocks.resize( std::max( blockCount, (size_t)1 ) );
+        resetGeneration( m_generations[i] );
+    }
+}
+
+/*++
+* @method: twitSeenFilter::testAndInsert
+*
+* @description: tells whether an id was seen and remembers it
+*
+* @input: id - tweet or message id
+*
+* @output: true if the id was seen before, or is a false positive
+*
+*--*/
+bool twitSeenFilter::testAndInsert( unsigned long long id )
+{
+    const unsigned long long hash = mixId( id );
+    std::lock_guard<std::mutex> lock( m_mutex );
+    rotateIfDue();
+
+    twitSeenGeneration& current = m_generations[m_current];
+    if( testBlock( current, hash, m_hashCount ) )
+    {
+        return true;
+    }
+    /* Seen only in the older generation, carry it over so that an id that
+       keeps coming back is never forgotten */
+    bool seen = testBlock( m_generations[1 - m_current], hash, m_hashCount );
+    setBlock( current, hash, m_hashCount );
+    ++current.count;
+    return seen;
+}
+
+/*++
+* @method: twitSeenFilter::contains
+*
+* @description: tells whether an id was seen, without remembering it
+*
+* @input: id - tweet or message id
+*
+* @output: true if the id was seen before, or is a false positive
+*
+*--*/
+bool twitSeenFilter::contains( unsigned long long id )
+{
+    const unsigned long long hash = mixId( id );
+    std::lock_guard<std::mutex> lock( m_mutex );
+    rotateIfDue();
+    return testBlock( m_generations[0], hash, m_hashCount ) ||
+           testBlock( m_generations[1], hash, m_hashCount );
+}
+
+/*++
+* @method: twitSeenFilter::filter
+*
+* @description: drops the tweets seen before and remembers the rest,
+*               keeping their order. duplicates within the list go too.
+*
+* @input: tweets - tweets about to be delivered
+*
+* @output: tweets - tweets not seen before,
+*          number of tweets dropped
+*
+*--*/
+size_t twitSeenFilter::filter( std::vector<twitTweet>& tweets )
+{
+    size_t kept = 0;
+    for( size_t i = 0; i < tweets.size(); ++i )
+    {
+        if( testAndInsert( tweets[i].id ) )
+        {
+            continue;
+        }
+        if( kept != i )
+        {
+            tweets[kept] = std::move( tweets[i] );
+        }
+        ++kept;
+    }
+    size_t dropped = tweets.size() - kept;
+    tweets.erase( tweets.begin() + kept, tweets.end() );
+    return dropped;
+}
+
+/*++
+* @method: twitSeenFilter::rotate
+*
+* @description: forgets the older generation and starts a new one
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitSeenFilter::rotate()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_current = 1 - m_current;
+    resetGeneration( m_generations[m_current] );
+}
+
+/*++
+* @method: twitSeenFilter::clear
+*
+* @description: forgets every id
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitSeenFilter::clear()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    resetGeneration( m_generations[0] );
+    resetGeneration( m_generations[1] );
+}
+
+/*++
+* @method: twitSeenFilter::getBytes
+*
+* @description: returns the memory held by the filter, fixed at construction
+*
+* @input: none
+*
+* @output: size in bytes
+*
+*--*/
+size_t twitSeenFilter::getBytes() const
+{
+    return sizeof( *this ) +
+           ( m_generations[0].blocks.size() + m_generations[1].blocks.size() ) * sizeof( twitSeenBlock );
+}
+
+/*++
+* @method: twitSeenFilter::testBlock
+*
+* @description: checks the bits of a hash in its block
+*
+* @input: generation - generation to check,
+*         hash - mixed id,
+*         hashCount - bits per id
+*
+* @output: true if all bits are set
+*
+* @remarks: internal method
+*
+*--*/
+bool twitSeenFilter::testBlock( const twitSeenGeneration& generation, unsigned long long hash, unsigned int hashCount )
+{
+    const twitSeenBlock& block = generation.blocks[blockIndex( hash, generation.blocks.size() )];
+    unsigned long long bits = hash;
+    for( unsigned int i = 0; i < hashCount; ++i )
+    {
+        unsigned int bit = nextBit( bits, i );
+        if( !( block.words[bit >> 6] & ( 1ULL << ( bit & 63 ) ) ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*++
+* @method: twitSeenFilter::setBlock
+*
+* @description: sets the bits of a hash in its block
+*
+* @input: generation - generation to update,
+*         hash - mixed id,
+*         hashCount - bits per id
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitSeenFilter::setBlock( twitSeenGeneration& generation, unsigned long long hash, unsigned int hashCount )
+{
+    twitSeenBlock& block = generation.blocks[blockIndex( hash, generation.blocks.size() )];
+    unsigned long long bits = hash;
+    for( unsigned int i = 0; i < hashCount; ++i )
+    {
+        unsigned int bit = nextBit( bits, i );
+        block.words[bit >> 6] |= 1ULL << ( bit & 63 );
+    }
+}
+
+/*++
+* @method: twitSeenFilter::rotateIfDue
+*
+* @description: rotates when the current generation is past its lifetime or
+*               full. called with the lock held.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitSeenFilter::rotateIfDue()
+{
+    const twitSeenGeneration& current = m_generations[m_current];
+    bool expired = m_generationSecs && ( time( NULL ) - current.started >= (time_t)m_generationSecs );
+    if( expired || current.count >= m_capacity )
+    {
+        m_current = 1 - m_current;
+        resetGeneration( m_generations[m_current] );
+    }
+}
+
+/*++
+* @method: twitSeenFilter::resetGeneration
+*
+* @description: empties a generation and restarts its clock
+*
+* @input: generation - generation to reset
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitSeenFilter::resetGeneration( twitSeenGeneration& generation )
+{
+    std::fill( generation.blocks.begin(), generation.blocks.end(), twitSeenBlock() );
+    generation.count = 0;
+    generation.started = time( NULL );
+}
@@ -0,0 +1,72 @@
+#ifndef _TWITSEENFILTER_H_
+#define _TWITSEENFILTER_H_
+
+#include <ctime>
+#include <vector>
+#include <mutex>
+#include "twitmodel.h"
+
+namespace twitSeenFilterDefaults
+{
+    const size_t TWITSEEN_DEFAULT_CAPACITY = 1000000;           /* ids per generation */
+    const double TWITSEEN_DEFAULT_FALSE_POSITIVE_RATE = 0.0001;
+    const unsigned int TWITSEEN_DEFAULT_GENERATION_SECS = 24 * 60 * 60;
+};
+
+/* twitSeenFilter class
+*
+* Bounded memory "seen before" test for tweet ids, a blocked Bloom filter
+* kept in two generations. Ids go into the current generation and are
+* looked up in both. Once the current generation is older than its
+* lifetime or holds its capacity, the older one is dropped and a fresh one
+* started, so an id is remembered for at least one lifetime and memory stays
+* fixed however long the process runs.
+*
+* Each id touches one 64 byte block, i.e. one cache line. Like any Bloom
+* filter it may claim an unseen id was seen, at the configured rate; it
+* never misses one that was seen within the window. Safe to share between
+* threads.
+*/
+class twitSeenFilter
+{
+public:
+    twitSeenFilter( size_t capacity = twitSeenFilterDefaults::TWITSEEN_DEFAULT_CAPACITY /* in */,
+                    double falsePositiveRate = twitSeenFilterDefaults::TWITSEEN_DEFAULT_FALSE_POSITIVE_RATE /* in */,
+                    unsigned int generationSecs = twitSeenFilterDefaults::TWITSEEN_DEFAULT_GENERATION_SECS /* in */ );
+
+    bool testAndInsert( unsigned long long id /* in */ );
+    bool contains( unsigned long long id /* in */ );
+    size_t filter( std::vector<twitTweet>& tweets /* in, out */ );
+    void rotate();
+    void clear();
+
+    size_t getBytes() const;
+
+private:
+    /* One cache line of bits */
+    struct twitSeenBlock
+    {
+        unsigned long long words[8];
+    };
+
+    struct twitSeenGeneration
+    {
+        std::vector<twitSeenBlock> blocks;
+        size_t count;
+        time_t started;
+    };
+
+    std::mutex m_mutex;
+    twitSeenGeneration m_generations[2];
+    int m_current;
+    size_t m_capacity;
+    unsigned int m_hashCount;
+    unsigned int m_generationSecs;
+
+    static bool testBlock( const twitSeenGeneration& generation, unsigned long long hash, unsigned int hashCount );
+    static void setBlock( twitSeenGeneration& generation, unsigned long long hash, unsigned int hashCount );
+    void rotateIfDue();
+    void resetGeneration( twitSeenGeneration& generation );
+};
+
+#endif // _TWITSEENFILTER_H_
@@ -0,0 +1,681 @@
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include "twitatomicfile.h"
+#include "twitsnapshot.h"
+
+using namespace twitSnapshotFormat;
+
+namespace
+{
+    /* Section payload waiting to be written */
+    struct twitSnapshotChunk
+    {
+        const void* data;
+        size_t size;
+    };
+
+    /* String table being built, index 0 is the empty string */
+    struct twitSnapshotStrings
+    {
+        std::unordered_map<std::string, unsigned int> indexes;
+        std::vector<unsigned long long> offsets;
+        std::string blob;
+
+        twitSnapshotStrings() : offsets( 2, 0 ) {}
+
+        unsigned int add( twitInternStr str )
+        {
+            if( !str || str->empty() )
+            {
+                return 0;
+            }
+            std::unordered_map<std::string, unsigned int>::const_iterator it = indexes.find( *str );
+            if( it != indexes.end() )
+            {
+                return it->second;
+            }
+            unsigned int index = (unsigned int)( offsets.size() - 1 );
+            indexes[*str] = index;
+            blob += *str;
+            offsets.push_back( blob.size() );
+            return index;
+        }
+    };
+
+    const unsigned long long TWITSNAPSHOT_ALIGN = 8;
+
+    unsigned long long alignUp( unsigned long long value )
+    {
+        return ( value + TWITSNAPSHOT_ALIGN - 1 ) & ~( TWITSNAPSHOT_ALIGN - 1 );
+    }
+
+    void appendBlobString( std::string& blob, std::vector<unsigned long long>& offsets, const std::string& str )
+    {
+        blob += str;
+        offsets.push_back( blob.size() );
+    }
+
+    void appendStringList( std::vector<unsigned int>& lists, std::vector<unsigned long long>& offsets,
+                           const std::vector<twitInternStr>& strs, twitSnapshotStrings& strings )
+    {
+        for( size_t i = 0; i < strs.size(); ++i )
+        {
+            lists.push_back( strings.add( strs[i] ) );
+        }
+        offsets.push_back( lists.size() );
+    }
+
+    const void* vectorData( const std::vector<unsigned long long>& v ) { return v.empty() ? NULL : &v[0]; }
+    const void* vectorData( const std::vector<unsigned int>& v ) { return v.empty() ? NULL : &v[0]; }
+
+    bool userIdLess( const twitUser* a, const twitUser* b )
+    {
+        return a->id < b->id;
+    }
+}
+
+/*++
+* @method: twitWriteSnapshot
+*
+* @description: writes tweets and users to a snapshot file that twitSnapshot
+*               can later map and read in place. an existing file is
+*               replaced as a whole; readers that mapped it keep the old
+*               snapshot.
+*
+* @input: path - snapshot file,
+*         tweets - tweets to store, in the order they are read back,
+*         users - users to store, they are written sorted by id
+*
+* @output: errorMessage - reason of failure, true if the file was written
+*
+*--*/
+bool twitWriteSnapshot( const std::string& path, const std::vector<twitTweet>& tweets,
+                        const std::vector<twitUser>& users, std::string& errorMessage )
+{
+    errorMessage.clear();
+    const size_t tweetCount = tweets.size();
+    const size_t userCount = users.size();
+    twitSnapshotStrings strings;
+
+    std::vector<unsigned long long> tweetIds( tweetCount ), tweetCreatedAt( tweetCount ), tweetUserIds( tweetCount );
+    std::vector<unsigned long long> inReplyToIds( tweetCount ), retweetedIds( tweetCount );
+    std::vector<unsigned int> retweetCounts( tweetCount ), favoriteCounts( tweetCount );
+    std::vector<unsigned int> tweetScreenNames( tweetCount ), langs( tweetCount );
+    std::vector<unsigned long long> textOffsets( 1, 0 );
+    std::string textBlob;
+    for( size_t i = 0; i < tweetCount; ++i )
+    {
+        const twitTweet& tweet = tweets[i];
+        tweetIds[i] = tweet.id;
+        tweetCreatedAt[i] = tweet.createdAt;
+        tweetUserIds[i] = tweet.userId;
+        inReplyToIds[i] = tweet.inReplyToStatusId;
+        retweetedIds[i] = tweet.retweetedStatusId;
+        retweetCounts[i] = tweet.retweetCount;
+        favoriteCounts[i] = tweet.favoriteCount;
+        tweetScreenNames[i] = strings.add( tweet.userScreenName );
+        langs[i] = strings.add( tweet.lang );
+        appendBlobString( textBlob, textOffsets, tweet.text );
+    }
+
+    /* The string lists of all fields share one section; each field has its
+       own offset array whose first entry is where the previous field ended */
+    std::vector<unsigned int> stringLists;
+    std::vector<unsigned long long> hashtagOffsets( 1, 0 ), urlOffsets, mentionOffsets;
+    for( size_t i = 0; i < tweetCount; ++i )
+    {
+        appendStringList( stringLists, hashtagOffsets, tweets[i].hashtags, strings );
+    }
+    urlOffsets.push_back( stringLists.size() );
+    for( size_t i = 0; i < tweetCount; ++i )
+    {
+        appendStringList( stringLists, urlOffsets, tweets[i].urls, strings );
+    }
+    mentionOffsets.push_back( stringLists.size() );
+    for( size_t i = 0; i < tweetCount; ++i )
+    {
+        appendStringList( stringLists, mentionOffsets, tweets[i].mentions, strings );
+    }
+
+    /* Users go in id order so readers can binary search them */
+    std::vector<const twitUser*> sortedUsers( userCount );
+    for( size_t i = 0; i < userCount; ++i )
+    {
+        sortedUsers[i] = &users[i];
+    }
+    std::sort( sortedUsers.begin(), sortedUsers.end(), userIdLess );
+
+    std::vector<unsigned long long> userIds( userCount ), userCreatedAt( userCount );
+    std::vector<unsigned int> followers( userCount ), friends( userCount ), statuses( userCount ), flags( userCount );
+    std::vector<unsigned int> screenNames( userCount ), names( userCount ), locations( userCount ), imageUrls( userCount );
+    std::vector<unsigned long long> descriptionOffsets( 1, 0 );
+    std::string descriptionBlob;
+    for( size_t i = 0; i < userCount; ++i )
+    {
+        const twitUser& user = *sortedUsers[i];
+        userIds[i] = user.id;
+        userCreatedAt[i] = user.createdAt;
+        followers[i] = user.followersCount;
+        friends[i] = user.friendsCount;
+        statuses[i] = user.statusesCount;
+        flags[i] = ( user.isProtected ? eUserProtected : 0 ) |
+                   ( user.isVerified ? eUserVerified : 0 );
+        screenNames[i] = strings.add( user.screenName );
+        names[i] = strings.add( user.name );
+        locations[i] = strings.add( user.location );
+        imageUrls[i] = strings.add( user.profileImageUrl );
+        appendBlobString( descriptionBlob, descriptionOffsets, user.description );
+    }
+
+    const size_t stringCount = strings.offsets.size() - 1;
+    twitSnapshotChunk chunks[eSectionMax] = {
+        { vectorData( tweetIds ), tweetCount * sizeof( unsigned long long ) },
+        { vectorData( tweetCreatedAt ), tweetCount * sizeof( unsigned long long ) },
+        { vectorData( tweetUserIds ), tweetCount * sizeof( unsigned long long ) },
+        { vectorData( inReplyToIds ), tweetCount * sizeof( unsigned long long ) },
+        { vectorData( retweetedIds ), tweetCount * sizeof( unsigned long long ) },
+        { vectorData( retweetCounts ), tweetCount * sizeof( unsigned int ) },
+        { vectorData( favoriteCounts ), tweetCount * sizeof( unsigned int ) },
+        { vectorData( tweetScreenNames ), tweetCount * sizeof( unsigned int ) },
+        { vectorData( langs ), tweetCount * sizeof( unsigned int ) },
+        { vectorData( textOffsets ), ( tweetCount + 1 ) * sizeof( unsigned long long ) },
+        { textBlob.data(), textBlob.size() },
+        { vectorData( hashtagOffsets ), ( tweetCount + 1 ) * sizeof( unsigned long long ) },
+        { vectorData( urlOffsets ), ( tweetCount + 1 ) * sizeof( unsigned long long ) },
+        { vectorData( mentionOffsets ), ( tweetCount + 1 ) * sizeof( unsigned long long ) },
+        { vectorData( stringLists ), stringLists.size() * sizeof( unsigned int ) },
+        { vectorData( userIds ), userCount * sizeof( unsigned long long ) },
+        { vectorData( userCreatedAt ), userCount * sizeof( unsigned long long ) },
+        { vectorData( followers ), userCount * sizeof( unsigned int ) },
+        { vectorData( friends ), userCount * sizeof( unsigned int ) },
+        { vectorData( statuses ), userCount * sizeof( unsigned int ) },
+        { vectorData( flags ), userCount * sizeof( unsigned int ) },
+        { vectorData( screenNames ), userCount * sizeof( unsigned int ) },
+        { vectorData( names ), userCount * sizeof( unsigned int ) },
+        { vectorData( locations ), userCount * sizeof( unsigned int ) },
+        { vectorData( imageUrls ), userCount * sizeof( unsigned int ) },
+        { vectorData( descriptionOffsets ), ( userCount + 1 ) * sizeof( unsigned long long ) },
+        { descriptionBlob.data(), descriptionBlob.size() },
+        { vectorData( strings.offsets ), ( stringCount + 1 ) * sizeof( unsigned long long ) },
+        { strings.blob.data(), strings.blob.size() }
+    };
+
+    twitSnapshotHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, MAGIC, sizeof( header.magic ) );
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.sectionCount = eSectionMax;
+
+    twitSnapshotSectionEntry table[eSectionMax];
+    unsigned long long offset = alignUp( sizeof( header ) + sizeof( table ) );
+    for( int i = 0; i < eSectionMax; ++i )
+    {
+        table[i].offset = offset;
+        table[i].size = chunks[i].size;
+        offset = alignUp( offset + chunks[i].size );
+    }
+    /* A snapshot mapped by a reader is replaced, never written over */
+    twitAtomicFile file( path, true );
+    std::ostream& out = file.stream();
+    if( !out )
+    {
+        errorMessage = "cannot create " + path;
+        return false;
+    }
+    const char padding[TWITSNAPSHOT_ALIGN] = { 0 };
+    out.write( (const char*)&header, sizeof( header ) );
+    out.write( (const char*)table, sizeof( table ) );
+    unsigned long long written = sizeof( header ) + sizeof( table );
+    for( int i = 0; i < eSectionMax; ++i )
+    {
+        out.write( padding, (std::streamsize)( table[i].offset - written ) );
+        if( chunks[i].size )
+        {
+            out.write( (const char*)chunks[i].data, (std::streamsize)chunks[i].size );
+        }
+        written = table[i].offset + chunks[i].size;
+    }
+    out.write( padding, (std::streamsize)( alignUp( written ) - written ) );
+    return file.commit( errorMessage );
+}
+
+/*++
+* @method: twitSnapshot::twitSnapshot
+*
+* @description: constructor
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+twitSnapshot::twitSnapshot():
+m_tweetCount( 0 ),
+m_userCount( 0 ),
+m_textBlobSize( 0 ),
+m_descriptionBlobSize( 0 ),
+m_listCount( 0 ),
+m_stringCount( 0 ),
+m_stringBlobSize( 0 )
+{
+    memset( m_sections, 0, sizeof( m_sections ) );
+}
+
+/*++
+* @method: twitSnapshot::open
+*
+* @description: maps a snapshot file and validates its layout. column and
+*               string data are used in place, nothing is decoded.
+*
+* @input: path - snapshot file
+*
+* @output: errorMessage - reason of failure, true if the snapshot is usable
+*
+*--*/
+bool twitSnapshot::open( const std::string& path, std::string& errorMessage )
+{
+    close();
+    errorMessage.clear();
+    if( !m_file.open( path ) )
+    {
+        errorMessage = "cannot map " + path;
+        return false;
+    }
+
+    const char* data = m_file.getData();
+    const size_t fileSize = m_file.getSize();
+    const size_t tableEnd = sizeof( twitSnapshotHeader ) + eSectionMax * sizeof( twitSnapshotSectionEntry );
+    if( fileSize < tableEnd )
+    {
+        errorMessage = "snapshot is truncated";
+        close();
+        return false;
+    }
+
+    const twitSnapshotHeader* header = (const twitSnapshotHeader*)data;
+    if( memcmp( header->magic, MAGIC, sizeof( header->magic ) ) != 0 )
+    {
+        errorMessage = "not a snapshot file";
+    }
+    else if( header->byteOrderMark != BYTE_ORDER_MARK )
+    {
+        errorMessage = "snapshot was written with a different byte order";
+    }
+    else if( header->version != VERSION || header->sectionCount != eSectionMax )
+    {
+        errorMessage = "unsupported snapshot version";
+    }
+    if( errorMessage.length() )
+    {
+        close();
+        return false;
+    }
+
+    const twitSnapshotSectionEntry* table = (const twitSnapshotSectionEntry*)( data + sizeof( twitSnapshotHeader ) );
+    unsigned long long sizes[eSectionMax];
+    for( int i = 0; i < eSectionMax; ++i )
+    {
+        if( table[i].offset % TWITSNAPSHOT_ALIGN || table[i].offset > fileSize ||
+            table[i].size > fileSize - table[i].offset )
+        {
+            errorMessage = "snapshot section out of bounds";
+            close();
+            return false;
+        }
+        m_sections[i] = data + table[i].offset;
+        sizes[i] = table[i].size;
+    }
+
+    /* Every column must agree on the row counts */
+    const unsigned long long tweets = sizes[eTweetIds] / sizeof( unsigned long long );
+    const unsigned long long users = sizes[eUserIds] / sizeof( unsigned long long );
+    const unsigned long long u64Tweets = tweets * sizeof( unsigned long long );
+    const unsigned long long u32Tweets = tweets * sizeof( unsigned int );
+    const unsigned long long u64Users = users * sizeof( unsigned long long );
+    const unsigned long long u32Users = users * sizeof( unsigned int );
+    const unsigned long long tweetOffsets = u64Tweets + sizeof( unsigned long long );
+    if( sizes[eTweetIds] != u64Tweets || sizes[eTweetCreatedAt] != u64Tweets || sizes[eTweetUserIds] != u64Tweets ||
+        sizes[eTweetInReplyToStatusIds] != u64Tweets || sizes[eTweetRetweetedStatusIds] != u64Tweets ||
+        sizes[eTweetRetweetCounts] != u32Tweets || sizes[eTweetFavoriteCounts] != u32Tweets ||
+        sizes[eTweetUserScreenNames] != u32Tweets || sizes[eTweetLangs] != u32Tweets ||
+        sizes[eTweetTextOffsets] != tweetOffsets || sizes[eTweetHashtagOffsets] != tweetOffsets ||
+        sizes[eTweetUrlOffsets] != tweetOffsets || sizes[eTweetMentionOffsets] != tweetOffsets ||
+        sizes[eUserIds] != u64Users || sizes[eUserCreatedAt] != u64Users ||
+        sizes[eUserFollowersCounts] != u32Users || sizes[eUserFriendsCounts] != u32Users ||
+        sizes[eUserStatusesCounts] != u32Users || sizes[eUserFlags] != u32Users ||
+        sizes[eUserScreenNames] != u32Users || sizes[eUserNames] != u32Users ||
+        sizes[eUserLocations] != u32Users || sizes[eUserProfileImageUrls] != u32Users ||
+        sizes[eUserDescriptionOffsets] != u64Users + sizeof( unsigned long long ) )
+    {
+        errorMessage = "snapshot columns disagree on row count";
+        close();
+        return false;
+    }
+    if( sizes[eTweetStringLists] % sizeof( unsigned int ) ||
+        sizes[eStringOffsets] < sizeof( unsigned long long ) || sizes[eStringOffsets] % sizeof( unsigned long long ) )
+    {
+        errorMessage = "snapshot string table is corrupt";
+        close();
+        return false;
+    }
+
+    m_tweetCount = (size_t)tweets;
+    m_userCount = (size_t)users;
+    m_textBlobSize = (size_t)sizes[eTweetTextBlob];
+    m_descriptionBlobSize = (size_t)sizes[eUserDescriptionBlob];
+    m_listCount = (size_t)( sizes[eTweetStringLists] / sizeof( unsigned int ) );
+    m_stringCount = (size_t)( sizes[eStringOffsets] / sizeof( unsigned long long ) - 1 );
+    m_stringBlobSize = (size_t)sizes[eStringBlob];
+    return true;
+}
+
+/*++
+* @method: twitSnapshot::close
+*
+* @description: unmaps the snapshot. pointers and views handed out before
+*               are invalid afterwards.
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitSnapshot::close()
+{
+    m_file.close();
+    memset( m_sections, 0, sizeof( m_sections ) );
+    m_tweetCount = 0;
+    m_userCount = 0;
+    m_textBlobSize = 0;
+    m_descriptionBlobSize = 0;
+    m_listCount = 0;
+    m_stringCount = 0;
+    m_stringBlobSize = 0;
+}
+
+const unsigned long long* twitSnapshot::getTweetIds() const
+{
+    return (const unsigned long long*)section( eTweetIds );
+}
+
+const unsigned long long* twitSnapshot::getTweetCreatedAt() const
+{
+    return (const unsigned long long*)section( eTweetCreatedAt );
+}
+
+const unsigned long long* twitSnapshot::getTweetUserIds() const
+{
+    return (const unsigned long long*)section( eTweetUserIds );
+}
+
+const unsigned int* twitSnapshot::getTweetRetweetCounts() const
+{
+    return (const unsigned int*)section( eTweetRetweetCounts );
+}
+
+const unsigned int* twitSnapshot::getTweetFavoriteCounts() const
+{
+    return (const unsigned int*)section( eTweetFavoriteCounts );
+}
+
+const unsigned long long* twitSnapshot::getTweetInReplyToStatusIds() const
+{
+    return (const unsigned long long*)section( eTweetInReplyToStatusIds );
+}
+
+const unsigned long long* twitSnapshot::getTweetRetweetedStatusIds() const
+{
+    return (const unsigned long long*)section( eTweetRetweetedStatusIds );
+}
+
+const unsigned long long* twitSnapshot::getUserIds() const
+{
+    return (const unsigned long long*)section( eUserIds );
+}
+
+/*++
+* @method: twitSnapshot::blobString
+*
+* @description: resolves entry index of an offset array into a blob. a
+*               corrupt offset yields an empty string instead of reading
+*               outside the mapping. this is an internal method.
+*
+* @input: offsets - offset array, blob - string blob, blobSize - blob size,
+*         index - entry index
+*
+* @output: outLength - string size, returns string start
+*
+* @remarks: internal method
+*
+*--*/
+const char* twitSnapshot::blobString( const unsigned long long* offsets, const char* blob, size_t blobSize,
+                                      size_t index, size_t& outLength )
+{
+    unsigned long long begin = offsets[index];
+    unsigned long long end = offsets[index + 1];
+    if( begin > end || end > blobSize )
+    {
+        outLength = 0;
+        return blob;
+    }
+    outLength = (size_t)( end - begin );
+    return blob + begin;
+}
+
+/*++
+* @method: twitSnapshot::getTweet
+*
+* @description: returns a row view of one tweet, text points into the mapping
+*
+* @input: index - tweet index, less than getTweetCount()
+*
+* @output: row view
+*
+*--*/
+twitTweetRow twitSnapshot::getTweet( size_t index ) const
+{
+    twitTweetRow row;
+    row.id = getTweetIds()[index];
+    row.createdAt = getTweetCreatedAt()[index];
+    row.userId = getTweetUserIds()[index];
+    row.retweetCount = getTweetRetweetCounts()[index];
+    row.favoriteCount = getTweetFavoriteCounts()[index];
+    row.text = blobString( (const unsigned long long*)section( eTweetTextOffsets ), section( eTweetTextBlob ),
+                           m_textBlobSize, index, row.textLength );
+    return row;
+}
+
+/*++
+* @method: twitSnapshot::readTweet
+*
+* @description: rebuilds a tweet as twitParseTweet() would have parsed it
+*
+* @input: index - tweet index, less than getTweetCount(),
+*         pool - pool interning the strings
+*
+* @output: outTweet - tweet
+*
+*--*/
+void twitSnapshot::readTweet( size_t index, twitTweet& outTweet, twitInternPool& pool ) const
+{
+    twitTweetRow row = getTweet( index );
+    outTweet.id = row.id;
+    outTweet.createdAt = row.createdAt;
+    outTweet.userId = row.userId;
+    outTweet.inReplyToStatusId = getTweetInReplyToStatusIds()[index];
+    outTweet.retweetedStatusId = getTweetRetweetedStatusIds()[index];
+    outTweet.retweetCount = row.retweetCount;
+    outTweet.favoriteCount = row.favoriteCount;
+    outTweet.userScreenName = internString( ( (const unsigned int*)section( eTweetUserScreenNames ) )[index], pool );
+    outTweet.lang = internString( ( (const unsigned int*)section( eTweetLangs ) )[index], pool );
+    outTweet.text.assign( row.text, row.textLength );
+    readList( eTweetHashtagOffsets, index, outTweet.hashtags, pool );
+    readList( eTweetUrlOffsets, index, outTweet.urls, pool );
+    readList( eTweetMentionOffsets, index, outTweet.mentions, pool );
+}
+
+/*++
+* @method: twitSnapshot::getUser
+*
+* @description: returns a view of one user, users are in id order
+*
+* @input: index - user index, less than getUserCount()
+*
+* @output: user view
+*
+*--*/
+twitSnapshotUser twitSnapshot::getUser( size_t index ) const
+{
+    twitSnapshotUser user;
+    user.id = getUserIds()[index];
+    user.createdAt = ( (const unsigned long long*)section( eUserCreatedAt ) )[index];
+    user.followersCount = ( (const unsigned int*)section( eUserFollowersCounts ) )[index];
+    user.friendsCount = ( (const unsigned int*)section( eUserFriendsCounts ) )[index];
+    user.statusesCount = ( (const unsigned int*)section( eUserStatusesCounts ) )[index];
+    unsigned int flags = ( (const unsigned int*)section( eUserFlags ) )[index];
+    user.isProtected = ( flags & eUserProtected ) != 0;
+    user.isVerified = ( flags & eUserVerified ) != 0;
+
+    user.screenName = getString( ( (const unsigned int*)section( eUserScreenNames ) )[index], user.screenNameLength );
+    user.name = getString( ( (const unsigned int*)section( eUserNames ) )[index], user.nameLength );
+    user.location = getString( ( (const unsigned int*)section( eUserLocations ) )[index], user.locationLength );
+    user.profileImageUrl = getString( ( (const unsigned int*)section( eUserProfileImageUrls ) )[index],
+                                      user.profileImageUrlLength );
+    user.description = blobString( (const unsigned long long*)section( eUserDescriptionOffsets ),
+                                   section( eUserDescriptionBlob ), m_descriptionBlobSize, index,
+                                   user.descriptionLength );
+    return user;
+}
+
+/*++
+* @method: twitSnapshot::findUser
+*
+* @description: looks a user up by id
+*
+* @input: id - user id
+*
+* @output: outUser - user view, true if the user is in the snapshot
+*
+*--*/
+bool twitSnapshot::findUser( unsigned long long id, twitSnapshotUser& outUser ) const
+{
+    const unsigned long long* ids = getUserIds();
+    if( !m_userCount )
+    {
+        return false;
+    }
+    const unsigned long long* found = std::lower_bound( ids, ids + m_userCount, id );
+    if( found == ids + m_userCount || *found != id )
+    {
+        return false;
+    }
+    outUser = getUser( (size_t)( found - ids ) );
+    return true;
+}
+
+/*++
+* @method: twitSnapshot::readUser
+*
+* @description: rebuilds a user as twitParseUser() would have parsed it
+*
+* @input: index - user index, less than getUserCount(),
+*         pool - pool interning the strings
+*
+* @output: outUser - user
+*
+*--*/
+void twitSnapshot::readUser( size_t index, twitUser& outUser, twitInternPool& pool ) const
+{
+    twitSnapshotUser user = getUser( index );
+    outUser.id = user.id;
+    outUser.createdAt = user.createdAt;
+    outUser.followersCount = user.followersCount;
+    outUser.friendsCount = user.friendsCount;
+    outUser.statusesCount = user.statusesCount;
+    outUser.isProtected = user.isProtected;
+    outUser.isVerified = user.isVerified;
+    outUser.screenName = internString( ( (const unsigned int*)section( eUserScreenNames ) )[index], pool );
+    outUser.name = internString( ( (const unsigned int*)section( eUserNames ) )[index], pool );
+    outUser.location = internString( ( (const unsigned int*)section( eUserLocations ) )[index], pool );
+    outUser.profileImageUrl = internString( ( (const unsigned int*)section( eUserProfileImageUrls ) )[index], pool );
+    outUser.description.assign( user.description, user.descriptionLength );
+}
+
+/*++
+* @method: twitSnapshot::getString
+*
+* @description: returns an entry of the string table. an index outside the
+*               table yields an empty string.
+*
+* @input: index - string index
+*
+* @output: outLength - string size, returns string start
+*
+*--*/
+const char* twitSnapshot::getString( size_t index, size_t& outLength ) const
+{
+    if( index >= m_stringCount )
+    {
+        outLength = 0;
+        return section( eStringBlob );
+    }
+    return blobString( (const unsigned long long*)section( eStringOffsets ), section( eStringBlob ),
+                       m_stringBlobSize, index, outLength );
+}
+
+/*++
+* @method: twitSnapshot::internString
+*
+* @description: interns an entry of the string table. this is an internal
+*               method.
+*
+* @input: index - string index, pool - pool to intern into
+*
+* @output: handle of the string
+*
+* @remarks: internal method
+*
+*--*/
+twitInternStr twitSnapshot::internString( unsigned int index, twitInternPool& pool ) const
+{
+    size_t length = 0;
+    const char* str = getString( index, length );
+    return length ? pool.intern( str, length ) : twitInternPool::emptyString();
+}
+
+/*++
+* @method: twitSnapshot::readList
+*
+* @description: interns the strings of one tweet's hashtags, urls or
+*               mentions. corrupt offsets yield an empty list. this is an
+*               internal method.
+*
+* @input: offsets - offset array of the field, index - tweet index,
+*         pool - pool to intern into
+*
+* @output: outList - strings of the field
+*
+* @remarks: internal method
+*
+*--*/
+void twitSnapshot::readList( twitSnapshotSection offsets, size_t index,
+                             std::vector<twitInternStr>& outList, twitInternPool& pool ) const
+{
+    const unsigned long long* fieldOffsets = (const unsigned long long*)section( offsets );
+    const unsigned int* lists = (const unsigned int*)section( eTweetStringLists );
+    unsigned long long begin = fieldOffsets[index];
+    unsigned long long end = fieldOffsets[index + 1];
+    outList.clear();
+    if( begin > end || end > m_listCount )
+    {
+        return;
+    }
+    outList.reserve( (size_t)( end - begin ) );
+    for( unsigned long long i = begin; i < end; ++i )
+    {
+        outList.push_back( internString( lists[i], pool ) );
+    }
+}
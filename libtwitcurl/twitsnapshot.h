@@ -0,0 +1,176 @@
+#ifndef _TWITSNAPSHOT_H_
+#define _TWITSNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include "twitbatch.h"
+#include "twitmodel.h"
+#include "twitmmap.h"
+
+/* Snapshot file layout (version 3, host byte order, checked on open)
+*
+*   header        magic "TWITSNAP", version, byte order mark, section count
+*   section table one { offset, size } pair per twitSnapshotSection
+*   sections      every section starts on an 8 byte boundary
+*
+* Every field of twitTweet and twitUser is stored, so a snapshot can stand
+* in for the parsed JSON. Tweets are stored column by column as in
+* twitTweetBatch. Users are sorted by id and stored the same way.
+*
+* Interned strings (screen names, languages, hashtags, ...) are stored once
+* in a string table and referenced by 32 bit index; index 0 is the empty
+* string. The hashtags, urls and mentions of tweet i are the string indexes
+* [offsets[i], offsets[i+1]) of one shared list section, each field with its
+* own offset array. Free text (tweet texts, user descriptions) is kept in
+* blobs addressed the same way. Offsets are 64 bit. Readers use the mapped
+* bytes in place.
+*/
+namespace twitSnapshotFormat
+{
+    const char MAGIC[8] = { 'T', 'W', 'I', 'T', 'S', 'N', 'A', 'P' };
+    const unsigned int VERSION = 3;
+    const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+    enum twitSnapshotSection
+    {
+        eTweetIds = 0,
+        eTweetCreatedAt,
+        eTweetUserIds,
+        eTweetInReplyToStatusIds,
+        eTweetRetweetedStatusIds,
+        eTweetRetweetCounts,
+        eTweetFavoriteCounts,
+        eTweetUserScreenNames,
+        eTweetLangs,
+        eTweetTextOffsets,
+        eTweetTextBlob,
+        eTweetHashtagOffsets,
+        eTweetUrlOffsets,
+        eTweetMentionOffsets,
+        eTweetStringLists,
+        eUserIds,
+        eUserCreatedAt,
+        eUserFollowersCounts,
+        eUserFriendsCounts,
+        eUserStatusesCounts,
+        eUserFlags,
+        eUserScreenNames,
+        eUserNames,
+        eUserLocations,
+        eUserProfileImageUrls,
+        eUserDescriptionOffsets,
+        eUserDescriptionBlob,
+        eStringOffsets,
+        eStringBlob,
+        eSectionMax
+    };
+
+    enum twitSnapshotUserFlag
+    {
+        eUserProtected = 1,
+        eUserVerified = 2
+    };
+
+    struct twitSnapshotHeader
+    {
+        char magic[8];
+        unsigned int version;
+        unsigned int byteOrderMark;
+        unsigned int sectionCount;
+        unsigned int reserved;
+    };
+
+    struct twitSnapshotSectionEntry
+    {
+        unsigned long long offset;
+        unsigned long long size;
+    };
+};
+
+/* User view of a snapshot, strings point into the mapped file */
+struct twitSnapshotUser
+{
+    unsigned long long id;
+    unsigned long long createdAt;
+    unsigned int followersCount;
+    unsigned int friendsCount;
+    unsigned int statusesCount;
+    bool isProtected;
+    bool isVerified;
+    const char* screenName;
+    size_t screenNameLength;
+    const char* name;
+    size_t nameLength;
+    const char* location;
+    size_t locationLength;
+    const char* profileImageUrl;
+    size_t profileImageUrlLength;
+    const char* description;
+    size_t descriptionLength;
+};
+
+/* Writes a snapshot file */
+bool twitWriteSnapshot( const std::string& path /* in */,
+                        const std::vector<twitTweet>& tweets /* in */,
+                        const std::vector<twitUser>& users /* in */,
+                        std::string& errorMessage /* out */ );
+
+/* twitSnapshot class
+*
+* Read-only view of a snapshot file. open() maps the file and validates the
+* header and section table; nothing is decoded or copied.
+*/
+class twitSnapshot
+{
+public:
+    twitSnapshot();
+
+    bool open( const std::string& path /* in */, std::string& errorMessage /* out */ );
+    void close();
+
+    /* Tweets */
+    size_t getTweetCount() const { return m_tweetCount; }
+    const unsigned long long* getTweetIds() const;
+    const unsigned long long* getTweetCreatedAt() const;
+    const unsigned long long* getTweetUserIds() const;
+    const unsigned int* getTweetRetweetCounts() const;
+    const unsigned int* getTweetFavoriteCounts() const;
+    const unsigned long long* getTweetInReplyToStatusIds() const;
+    const unsigned long long* getTweetRetweetedStatusIds() const;
+    twitTweetRow getTweet( size_t index /* in */ ) const;
+    void readTweet( size_t index /* in */, twitTweet& outTweet /* out */, twitInternPool& pool /* in */ ) const;
+
+    /* Users */
+    size_t getUserCount() const { return m_userCount; }
+    const unsigned long long* getUserIds() const;
+    twitSnapshotUser getUser( size_t index /* in */ ) const;
+    bool findUser( unsigned long long id /* in */, twitSnapshotUser& outUser /* out */ ) const;
+    void readUser( size_t index /* in */, twitUser& outUser /* out */, twitInternPool& pool /* in */ ) const;
+
+    /* String table */
+    size_t getStringCount() const { return m_stringCount; }
+    const char* getString( size_t index /* in */, size_t& outLength /* out */ ) const;
+
+private:
+    twitMappedFile m_file;
+    const char* m_sections[twitSnapshotFormat::eSectionMax];
+    size_t m_tweetCount;
+    size_t m_userCount;
+    size_t m_textBlobSize;
+    size_t m_descriptionBlobSize;
+    size_t m_listCount;
+    size_t m_stringCount;
+    size_t m_stringBlobSize;
+
+    const char* section( twitSnapshotFormat::twitSnapshotSection id ) const { return m_sections[id]; }
+    static const char* blobString( const unsigned long long* offsets, const char* blob, size_t blobSize,
+                                   size_t index, size_t& outLength );
+    twitInternStr internString( unsigned int index, twitInternPool& pool ) const;
+    void readList( twitSnapshotFormat::twitSnapshotSection offsets, size_t index,
+                   std::vector<twitInternStr>& outList, twitInternPool& pool ) const;
+
+    twitSnapshot( const twitSnapshot& );
+    twitSnapshot& operator=( const twitSnapshot& );
+};
+
+#endif // _TWITSNAPSHOT_H_
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <picojson/picojson.h>
+#include "twitatomicfile.h"
+#include "twitcurlurls.h"
+#include "twittimelinesync.h"
+
+namespace
+{
+    const int TWITSYNC_MAX_ATTEMPTS = 4;
+
+    /* Names used in the state file, indexed by eTwitTimeline */
+    const char* TWITSYNC_TIMELINE_NAMES[eTwitTimelineMax] = { "home", "mentions", "direct_messages" };
+
+    const std::string& timelineResource( const eTwitTimeline timeline )
+    {
+        switch( timeline )
+        {
+        case eTwitTimelineMentions:         return twitRateResources::TWITRATE_MENTIONS_TIMELINE;
+        case eTwitTimelineDirectMessages:   return twitRateResources::TWITRATE_DIRECT_MESSAGES;
+        default:                            return twitRateResources::TWITRATE_HOME_TIMELINE;
+        }
+    }
+
+    std::string idToString( unsigned long long id )
+    {
+        return id ? std::to_string( id ) : std::string();
+    }
+
+    bool tweetIdLess( const twitTweet& a, const twitTweet& b )
+    {
+        return a.id < b.id;
+    }
+}
+
+/*++
+* @method: twitTimelineSync::twitTimelineSync
+*
+* @description: constructor
+*
+* @input: twitObj - authorized twitCurl object used for the requests,
+*         statePath - file the sync state is kept in, empty to keep it in
+*                     memory only; call loadState() to resume from it,
+*         budget - rate budget shared with other users of the same
+*                  credentials, NULL to use a private one
+*
+* @output: none
+*
+*--*/
+twitTimelineSync::twitTimelineSync( twitCurl& twitObj, const std::string& statePath, twitRateBudget* budget ):
+m_twit( twitObj ),
+m_statePath( statePath ),
+m_budget( budget ? budget : &m_ownBudget ),
+m_seenFilter( NULL )
+{
+    for( int i = 0; i < eTwitTimelineMax; ++i )
+    {
+        m_states[i].sinceId = 0;
+        m_states[i].gapTop = 0;
+        m_states[i].gapMaxId = 0;
+    }
+}
+
+/*++
+* @method: twitTimelineSync::loadState
+*
+* @description: reads the state written by previous polls. a missing file is
+*               not an error, syncing then starts from scratch.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if the state was loaded or there was none
+*
+*--*/
+bool twitTimelineSync::loadState( std::string& errorMessage )
+{
+    if( m_statePath.empty() )
+    {
+        return true;
+    }
+    std::ifstream file( m_statePath.c_str() );
+    if( !file )
+    {
+        return true;
+    }
+
+    std::string line;
+    while( std::getline( file, line ) )
+    {
+        std::istringstream fields( line );
+        std::string name;
+        twitTimelineState state;
+        if( !( fields >> name ) )
+        {
+            continue;
+        }
+        if( !( fields >> state.sinceId >> state.gapTop >> state.gapMaxId ) )
+        {
+            errorMessage = "malformed line in " + m_statePath + ": " + line;
+            return false;
+        }
+        for( int i = 0; i < eTwitTimelineMax; ++i )
+        {
+            if( name == TWITSYNC_TIMELINE_NAMES[i] )
+            {
+                m_states[i] = state;
+            }
+        }
+    }
+    return true;
+}
+
+/*++
+* @method: twitTimelineSync::poll
+*
+* @description: fetches everything added to a timeline since the last poll,
+*               resuming a gap left by an interrupted poll first
+*
+* @input: timeline - timeline to sync,
+*         pool - intern pool of the returned tweets' strings
+*
+* @output: outTweets - new tweets or messages, oldest first, each delivered
+*                      exactly once across polls,
+*          errorMessage - reason of failure,
+*          true if the timeline is in sync. tweets the seen filter knows are
+*          not returned. on failure outTweets still holds
+*          what was fetched, and the next poll picks up where this one
+*          stopped. either way, call commit() once outTweets is handled.
+*
+*--*/
+bool twitTimelineSync::poll( const eTwitTimeline timeline, std::vector<twitTweet>& outTweets,
+                             std::string& errorMessage, twitInternPool& pool )
+{
+    outTweets.clear();
+    twitTimelineState& state = m_states[timeline];
+    bool askedNew = false;
+    bool ok = true;
+    std::string response;
+    std::vector<twitTweet> page;
+
+    for( ;; )
+    {
+        if( !state.gapTop )
+        {
+            if( askedNew )
+            {
+                break;
+            }
+            askedNew = true;
+        }
+
+        /* Newest page above the watermark, or the next page down the gap */
+        if( !fetchPage( timeline, idToString( state.sinceId ), state.gapTop ? idToString( state.gapMaxId ) : "",
+                        response, errorMessage ) )
+        {
+            ok = false;
+            break;
+        }
+        picojson::value json;
+        std::string parseError = picojson::parse( json, response );
+        if( parseError.length() || !json.is<picojson::array>() )
+        {
+            errorMessage = parseError.length() ? parseError : response;
+            ok = false;
+            break;
+        }
+        page.clear();
+        twitParseTweets( json, page, pool );
+
+        unsigned long long oldest = 0;
+        unsigned long long newest = 0;
+        for( size_t i = 0; i < page.size(); ++i )
+        {
+            unsigned long long id = page[i].id;
+            oldest = ( !oldest || id < oldest ) ? id : oldest;
+            newest = std::max( newest, id );
+            /* Pages of a gap never overlap delivered ids, check anyway */
+            if( id > state.sinceId && ( !state.gapTop || id <= state.gapMaxId ) )
+            {
+                outTweets.push_back( page[i] );
+            }
+        }
+
+        if( page.empty() || oldest <= state.sinceId )
+        {
+            /* Reached the watermark, everything up to the gap top is in */
+            if( !state.gapTop )
+            {
+                break;
+            }
+            state.sinceId = state.gapTop;
+            state.gapTop = 0;
+            state.gapMaxId = 0;
+        }
+        else
+        {
+            if( state.gapTop && oldest > state.gapMaxId )
+            {
+                errorMessage = "timeline did not honour max_id";
+                ok = false;
+                break;
+            }
+            if( !state.gapTop )
+            {
+                state.gapTop = newest;
+            }
+            state.gapMaxId = oldest - 1;
+        }
+    }
+
+    std::sort( outTweets.begin(), outTweets.end(), tweetIdLess );
+    if( m_seenFilter )
+    {
+        m_seenFilter->filter( outTweets );
+    }
+    return ok;
+}
+
+/*++
+* @method: twitTimelineSync::commit
+*
+* @description: writes the state reached by the polls so far. call it once
+*               the tweets they returned are handled; until then a restart
+*               returns them again.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if written or no state file is used
+*
+*--*/
+bool twitTimelineSync::commit( std::string& errorMessage )
+{
+    return saveState( errorMessage );
+}
+
+/*++
+* @method: twitTimelineSync::getWatermark
+*
+* @description: returns the newest id of a timeline delivered without gaps
+*
+* @input: timeline - timeline
+*
+* @output: since id of the next poll, 0 if never synced
+*
+*--*/
+unsigned long long twitTimelineSync::getWatermark( const eTwitTimeline timeline )
+{
+    return m_states[timeline].sinceId;
+}
+
+/*++
+* @method: twitTimelineSync::setWatermark
+*
+* @description: moves the watermark of a timeline, dropping a pending gap.
+*               use it to skip history on a first sync or to resync. the
+*               state file gets it with the next commit().
+*
+* @input: timeline - timeline,
+*         sinceId - newest id considered delivered, 0 to sync from scratch
+*
+* @output: none
+*
+*--*/
+void twitTimelineSync::setWatermark( const eTwitTimeline timeline, unsigned long long sinceId )
+{
+    m_states[timeline].sinceId = sinceId;
+    m_states[timeline].gapTop = 0;
+    m_states[timeline].gapMaxId = 0;
+}
+
+/*++
+* @method: twitTimelineSync::setSeenFilter
+*
+* @description: sets a filter consulted before tweets are returned. the
+*               watermarks still advance past the tweets it drops.
+*
+* @input: seenFilter - filter, may be shared with other pollers and must
+*                      outlive the sync; NULL for none
+*
+* @output: none
+*
+*--*/
+void twitTimelineSync::setSeenFilter( twitSeenFilter* seenFilter )
+{
+    m_seenFilter = seenFilter;
+}
+
+/*++
+* @method: twitTimelineSync::requestPage
+*
+* @description: issues the request of a timeline. this is an internal method.
+*
+* @input: timeline - timeline,
+*         sinceId - since id, empty for none,
+*         maxId - max id, empty for none
+*
+* @output: true if the request completed
+*
+* @remarks: internal method
+*
+*--*/
+bool twitTimelineSync::requestPage( const eTwitTimeline timeline, const std::string& sinceId, const std::string& maxId )
+{
+    switch( timeline )
+    {
+    case eTwitTimelineMentions:
+        return m_twit.mentionsGet( sinceId, maxId, twitCurlDefaults::MAX_TIMELINE_TWEET_COUNT );
+    case eTwitTimelineDirectMessages:
+        return m_twit.directMessageGet( sinceId, maxId, twitCurlDefaults::MAX_TIMELINE_TWEET_COUNT );
+    default:
+        return m_twit.timelineHomeGet( sinceId, maxId, twitCurlDefaults::MAX_TIMELINE_TWEET_COUNT );
+    }
+}
+
+/*++
+* @method: twitTimelineSync::fetchPage
+*
+* @description: fetches one page of a timeline, waiting on the rate budget
+*               and retrying rate limited requests. this is an internal
+*               method.
+*
+* @input: timeline - timeline,
+*         sinceId - since id, empty for none,
+*         maxId - max id, empty for none
+*
+* @output: response - response body,
+*          errorMessage - reason of failure,
+*          true if the page was fetched
+*
+* @remarks: internal method
+*
+*--*/
+bool twitTimelineSync::fetchPage( const eTwitTimeline timeline, const std::string& sinceId, const std::string& maxId,
+                                  std::string& response, std::string& errorMessage )
+{
+    const std::string& resource = timelineResource( timeline );
+    for( int attempt = 0; attempt < TWITSYNC_MAX_ATTEMPTS; ++attempt )
+    {
+        if( !m_budget->acquire( resource ) )
+        {
+            errorMessage = "rate budget interrupted";
+            return false;
+        }
+        if( !requestPage( timeline, sinceId, maxId ) )
+        {
+            m_twit.getLastCurlError( errorMessage );
+            return false;
+        }
+        if( !m_budget->recordResponse( resource, m_twit ) )
+        {
+            /* Rate limited, wait for the window and ask again */
+            continue;
+        }
+        m_twit.takeLastWebResponse( response );
+        if( 200 != m_twit.getLastHttpStatus() )
+        {
+            errorMessage = response;
+            return false;
+        }
+        return true;
+    }
+    errorMessage = "rate limited";
+    return false;
+}
+
+/*++
+* @method: twitTimelineSync::saveState
+*
+* @description: writes the state of every timeline. the file is replaced as
+*               a whole so a crash leaves either the old or the new state.
+*               this is an internal method.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if written or no state file is used
+*
+* @remarks: internal method
+*
+*--*/
+bool twitTimelineSync::saveState( std::string& errorMessage )
+{
+    if( m_statePath.empty() )
+    {
+        return true;
+    }
+    twitAtomicFile file( m_statePath );
+    for( int i = 0; i < eTwitTimelineMax; ++i )
+    {
+        file.stream() << TWITSYNC_TIMELINE_NAMES[i] << " " << m_states[i].sinceId << " "
+                      << m_states[i].gapTop << " " << m_states[i].gapMaxId << "\n";
+    }
+    return file.commit( errorMessage );
+}
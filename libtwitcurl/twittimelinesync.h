@@ -0,0 +1,83 @@
+#ifndef _TWITTIMELINESYNC_H_
+#define _TWITTIMELINESYNC_H_
+
+#include <string>
+#include <vector>
+#include "twitcurl.h"
+#include "twitmodel.h"
+#include "twitratelimit.h"
+#include "twitseenfilter.h"
+
+/* Timelines twitTimelineSync can keep in sync */
+enum eTwitTimeline
+{
+    eTwitTimelineHome = 0,
+    eTwitTimelineMentions,
+    eTwitTimelineDirectMessages,
+    eTwitTimelineMax
+};
+
+/* twitTimelineSync class
+*
+* Keeps a gap free copy of the home timeline, mentions and direct messages.
+*
+* Every timeline has a watermark, the newest id delivered. A poll asks for
+* everything above the watermark and, as long as pages come back, pages
+* backwards with max_id until the watermark is reached, so bursts larger
+* than one page are never lost. While a gap is being filled its bounds are
+* part of the state; if a poll is cut short, the next one resumes the gap
+* before asking for anything newer. poll() advances the state in memory
+* only; commit() writes it to the state file once the caller has handled
+* the returned tweets. A restart resumes from the last commit, so tweets
+* returned but not committed before a crash are returned again, and
+* nothing is ever skipped.
+*
+* A seen filter, possibly shared with other pollers, drops tweets already
+* delivered elsewhere, e.g. a mention that also shows on the home timeline.
+*/
+class twitTimelineSync
+{
+public:
+    twitTimelineSync( twitCurl& twitObj /* in */,
+                      const std::string& statePath = "" /* in */,
+                      twitRateBudget* budget = NULL /* in */ );
+
+    bool loadState( std::string& errorMessage /* out */ );
+    bool poll( const eTwitTimeline timeline /* in */,
+               std::vector<twitTweet>& outTweets /* out */,
+               std::string& errorMessage /* out */,
+               twitInternPool& pool = twitInternPool::global() /* in */ );
+    bool commit( std::string& errorMessage /* out */ );
+
+    unsigned long long getWatermark( const eTwitTimeline timeline /* in */ );
+    void setWatermark( const eTwitTimeline timeline /* in */, unsigned long long sinceId /* in */ );
+    void setSeenFilter( twitSeenFilter* seenFilter /* in */ );
+
+private:
+    /* Sync state of one timeline. Ids up to sinceId are delivered. While
+       gapTop is set, ids in ( sinceId, gapMaxId ] are still missing and
+       ids in ( gapMaxId, gapTop ] are delivered. */
+    struct twitTimelineState
+    {
+        unsigned long long sinceId;
+        unsigned long long gapTop;
+        unsigned long long gapMaxId;
+    };
+
+    twitCurl& m_twit;
+    std::string m_statePath;
+    twitRateBudget m_ownBudget;
+    twitRateBudget* m_budget;
+    twitSeenFilter* m_seenFilter;
+    twitTimelineState m_states[eTwitTimelineMax];
+
+    bool requestPage( const eTwitTimeline timeline, const std::string& sinceId, const std::string& maxId );
+    bool fetchPage( const eTwitTimeline timeline, const std::string& sinceId, const std::string& maxId,
+                    std::string& response, std::string& errorMessage );
+    bool saveState( std::string& errorMessage );
+
+    twitTimelineSync( const twitTimelineSync& );
+    twitTimelineSync& operator=( const twitTimelineSync& );
+};
+
+#endif // _TWITTIMELINESYNC_H_
@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "twitatomicfile.h"
+#include "twitcurlurls.h"
+#include "twituploadsession.h"
+
+using namespace twitUploadSessionDefaults;
+
+namespace
+{
+    /* First line of the state file */
+    const std::string TWITUPLOAD_STATE_HEADER = "twitcurl-upload 1";
+}
+
+/*++
+* @method: twitUploadSession::twitUploadSession
+*
+* @description: constructor
+*
+* @input: statePath - file keeping the session across restarts, empty to
+*                     keep it in memory only; call loadState() to resume
+*                     from it
+*
+* @output: none
+*
+*--*/
+twitUploadSession::twitUploadSession( const std::string& statePath ):
+m_statePath( statePath )
+{
+    reset();
+}
+
+/*++
+* @method: twitUploadSession::loadState
+*
+* @description: reads the session written by a previous upload. a missing
+*               file is not an error, the upload then starts from scratch.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if the file is missing or was read
+*
+*--*/
+bool twitUploadSession::loadState( std::string& errorMessage )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    reset();
+    if( m_statePath.empty() )
+    {
+        return true;
+    }
+    std::ifstream file( m_statePath.c_str() );
+    if( !file )
+    {
+        return true;
+    }
+
+    std::string line;
+    std::string mediaId;
+    long long expiresAt = 0;
+    std::vector<twitUploadSegment> segments;
+    if( !std::getline( file, line ) || TWITUPLOAD_STATE_HEADER != line )
+    {
+        errorMessage = "not an upload state file: " + m_statePath;
+        return false;
+    }
+    while( std::getline( file, line ) )
+    {
+        std::istringstream fields( line );
+        std::string name;
+        bool ok = true;
+        if( !( fields >> name ) )
+        {
+            continue;
+        }
+        if( "media_id" == name )
+        {
+            ok = !!( fields >> mediaId );
+        }
+        else if( "media_type" == name )
+        {
+            ok = !!( fields >> m_mediaType );
+        }
+        else if( "total_bytes" == name )
+        {
+            ok = !!( fields >> m_totalBytes );
+        }
+        else if( "fingerprint" == name )
+        {
+            ok = !!( fields >> m_fingerprint );
+        }
+        else if( "expires_at" == name )
+        {
+            ok = !!( fields >> expiresAt );
+        }
+        else if( "segment" == name )
+        {
+            twitUploadSegment segment = { 0, 0, 0, false, false };
+            ok = ( fields >> segment.index >> segment.offset >> segment.end >> segment.done ) &&
+                 ( segments.size() == segment.index ) && ( segment.offset < segment.end ) &&
+                 ( segment.end <= m_totalBytes );
+            segments.push_back( segment );
+        }
+        if( !ok )
+        {
+            errorMessage = "malformed line in " + m_statePath + ": " + line;
+            reset();
+            return false;
+        }
+    }
+    m_mediaId = mediaId;
+    m_expiresAt = (time_t)expiresAt;
+    m_segments.swap( segments );
+    return true;
+}
+
+/*++
+* @method: twitUploadSession::canResume
+*
+* @description: tells whether the session belongs to the given media and its
+*               media id stays valid long enough to finish the upload
+*
+* @input: mediaType - twitCurlTypes::eTwitCurlMediaType of the media,
+*         totalBytes - size of the media,
+*         fingerprint - fingerprint of the media
+*
+* @output: true if the upload can go on with the saved media id
+*
+*--*/
+bool twitUploadSession::canResume( int mediaType, unsigned long long totalBytes, unsigned long long fingerprint )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return !m_mediaId.empty() && ( mediaType == m_mediaType ) && ( totalBytes == m_totalBytes ) &&
+           ( fingerprint == m_fingerprint ) && ( time( NULL ) + TWITUPLOAD_EXPIRY_MARGIN_SECS < m_expiresAt );
+}
+
+/*++
+* @method: twitUploadSession::begin
+*
+* @description: starts a new session for a media id given by INIT, dropping
+*               any earlier one
+*
+* @input: mediaId - media id,
+*         mediaType - twitCurlTypes::eTwitCurlMediaType of the media,
+*         totalBytes - size of the media,
+*         fingerprint - fingerprint of the media,
+*         expiresAt - time the media id expires
+*
+* @output: none
+*
+*--*/
+void twitUploadSession::begin( const std::string& mediaId, int mediaType, unsigned long long totalBytes,
+                               unsigned long long fingerprint, time_t expiresAt )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    reset();
+    m_mediaId = mediaId;
+    m_mediaType = mediaType;
+    m_totalBytes = totalBytes;
+    m_fingerprint = fingerprint;
+    m_expiresAt = expiresAt;
+
+    /* Losing the file only costs the ability to resume */
+    std::string errorMessage;
+    saveState( errorMessage );
+}
+
+/*++
+* @method: twitUploadSession::clear
+*
+* @description: ends the session, after the upload was finalized or its
+*               media id was refused, and removes its file
+*
+* @input: none
+*
+* @output: none
+*
+*--*/
+void twitUploadSession::clear()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    reset();
+    if( !m_statePath.empty() )
+    {
+        remove( m_statePath.c_str() );
+    }
+}
+
+/*++
+* @method: twitUploadSession::takeSegment
+*
+* @description: hands out the next segment to send. segments that were
+*               started but never accepted come first, with their original
+*               index and range; after them the rest of the media is split
+*               into segments of about chunkSize bytes, grown where needed
+*               to stay within the segments twitter allows.
+*
+* @input: chunkSize - wanted size of a new segment
+*
+* @output: outSegment - segment to send,
+*          false if every segment is sent or being sent
+*
+*--*/
+bool twitUploadSession::takeSegment( size_t chunkSize, twitUploadSegment& outSegment )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    unsigned long long covered = 0;
+    for( size_t i = 0; i < m_segments.size(); ++i )
+    {
+        if( !m_segments[i].done && !m_segments[i].taken )
+        {
+            m_segments[i].taken = true;
+            outSegment = m_segments[i];
+            return true;
+        }
+        covered = std::max( covered, m_segments[i].end );
+    }
+
+    const size_t maxSegments = twitCurlDefaults::MAX_MEDIA_SEGMENT_COUNT;
+    if( m_mediaId.empty() || ( covered >= m_totalBytes ) || ( m_segments.size() >= maxSegments ) )
+    {
+        return false;
+    }
+    unsigned long long left = m_totalBytes - covered;
+    unsigned long long segmentsLeft = maxSegments - m_segments.size();
+    unsigned long long segmentSize = std::max( (unsigned long long)chunkSize, ( left + segmentsLeft - 1 ) / segmentsLeft );
+    twitUploadSegment segment = { m_segments.size(), covered, covered + std::min( left, segmentSize ), false, true };
+    m_segments.push_back( segment );
+    outSegment = segment;
+    return true;
+}
+
+/*++
+* @method: twitUploadSession::finishSegment
+*
+* @description: returns a segment handed out by takeSegment(). an accepted
+*               segment is written to the state file; a failed one is
+*               handed out again by the next takeSegment().
+*
+* @input: index - segment index,
+*         done - true if twitter accepted the segment
+*
+* @output: none
+*
+*--*/
+void twitUploadSession::finishSegment( size_t index, bool done )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( index >= m_segments.size() )
+    {
+        return;
+    }
+    m_segments[index].taken = false;
+    if( done )
+    {
+        m_segments[index].done = true;
+        std::string errorMessage;
+        saveState( errorMessage );
+    }
+}
+
+/*++
+* @method: twitUploadSession::isComplete
+*
+* @description: tells whether every byte of the media was accepted
+*
+* @input: none
+*
+* @output: true if the upload can be finalized
+*
+*--*/
+bool twitUploadSession::isComplete()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( m_mediaId.empty() )
+    {
+        return false;
+    }
+    unsigned long long covered = 0;
+    for( size_t i = 0; i < m_segments.size(); ++i )
+    {
+        if( !m_segments[i].done )
+        {
+            return false;
+        }
+        covered = std::max( covered, m_segments[i].end );
+    }
+    return covered >= m_totalBytes;
+}
+
+/*++
+* @method: twitUploadSession::getMediaId
+*
+* @description: returns the media id of the session
+*
+* @input: none
+*
+* @output: media id, empty if there is no session
+*
+*--*/
+std::string twitUploadSession::getMediaId()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_mediaId;
+}
+
+/*++
+* @method: twitUploadSession::getExpiresAt
+*
+* @description: returns when the media id of the session expires
+*
+* @input: none
+*
+* @output: time the media id expires, 0 if there is no session
+*
+*--*/
+time_t twitUploadSession::getExpiresAt()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_expiresAt;
+}
+
+/*++
+* @method: twitUploadSession::getBytesDone
+*
+* @description: returns how much of the media twitter accepted so far
+*
+* @input: none
+*
+* @output: byte count
+*
+*--*/
+unsigned long long twitUploadSession::getBytesDone()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    unsigned long long bytes = 0;
+    for( size_t i = 0; i < m_segments.size(); ++i )
+    {
+        if( m_segments[i].done )
+        {
+            bytes += m_segments[i].end - m_segments[i].offset;
+        }
+    }
+    return bytes;
+}
+
+/*++
+* @method: twitUploadSession::saveState
+*
+* @description: writes the session. the file is replaced as a whole so a
+*               crash leaves either the old or the new state. called with
+*               the lock held.
+*
+* @input: none
+*
+* @output: errorMessage - reason of failure,
+*          true if written
+*
+* @remarks: internal method
+*
+*--*/
+bool twitUploadSession::saveState( std::string& errorMessage )
+{
+    if( m_statePath.empty() )
+    {
+        return true;
+    }
+    twitAtomicFile file( m_statePath );
+    file.stream() << TWITUPLOAD_STATE_HEADER << "\n"
+                  << "media_id " << m_mediaId << "\n"
+                  << "media_type " << m_mediaType << "\n"
+                  << "total_bytes " << m_totalBytes << "\n"
+                  << "fingerprint " << m_fingerprint << "\n"
+                  << "expires_at " << (long long)m_expiresAt << "\n";
+    for( size_t i = 0; i < m_segments.size(); ++i )
+    {
+        file.stream() << "segment " << m_segments[i].index << " " << m_segments[i].offset << " "
+                      << m_segments[i].end << " " << m_segments[i].done << "\n";
+    }
+    return file.commit( errorMessage );
+}
+
+/*++
+* @method: twitUploadSession::reset
+*
+* @description: forgets the session in memory. called with the lock held.
+*
+* @input: none
+*
+* @output: none
+*
+* @remarks: internal method
+*
+*--*/
+void twitUploadSession::reset()
+{
+    m_mediaId.clear();
+    m_mediaType = 0;
+    m_totalBytes = 0;
+    m_fingerprint = 0;
+    m_expiresAt = 0;
+    m_segments.clear();
+}
@@ -0,0 +1,76 @@
+#ifndef _TWITUPLOADSESSION_H_
+#define _TWITUPLOADSESSION_H_
+
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace twitUploadSessionDefaults
+{
+    const long TWITUPLOAD_DEFAULT_EXPIRY_SECS = 86400;    /* media id lifetime when INIT does not say */
+    const long TWITUPLOAD_EXPIRY_MARGIN_SECS = 300;       /* left to finish a resumed upload */
+};
+
+/* One APPEND segment of a chunked upload */
+struct twitUploadSegment
+{
+    size_t index;
+    unsigned long long offset;
+    unsigned long long end;
+    bool done;
+    bool taken;                 /* being sent right now, not saved */
+};
+
+/* twitUploadSession class
+*
+* State of a chunked upload: the media id twitter gave at INIT, when it
+* expires, a fingerprint of the media and the segments sent so far. The
+* state is written to a file whenever a segment is accepted, so an upload
+* cut short by a failure or a restart continues from the first missing
+* segment instead of starting over, as long as the media id is still valid
+* and the media still has the same size and fingerprint. Segments keep
+* the index and byte range they were first given; only the part of the
+* media never sent is split anew. Safe to share between the connections of
+* a parallel upload.
+*/
+class twitUploadSession
+{
+public:
+    explicit twitUploadSession( const std::string& statePath = "" /* in */ );
+
+    bool loadState( std::string& errorMessage /* out */ );
+    bool canResume( int mediaType /* in */, unsigned long long totalBytes /* in */,
+                    unsigned long long fingerprint /* in */ );
+    void begin( const std::string& mediaId /* in */, int mediaType /* in */,
+                unsigned long long totalBytes /* in */, unsigned long long fingerprint /* in */,
+                time_t expiresAt /* in */ );
+    void clear();
+
+    bool takeSegment( size_t chunkSize /* in */, twitUploadSegment& outSegment /* out */ );
+    void finishSegment( size_t index /* in */, bool done /* in */ );
+    bool isComplete();
+
+    std::string getMediaId();
+    time_t getExpiresAt();
+    unsigned long long getBytesDone();
+
+private:
+    std::mutex m_mutex;
+    std::string m_statePath;
+    std::string m_mediaId;      /* empty when there is no session */
+    int m_mediaType;
+    unsigned long long m_totalBytes;
+    unsigned long long m_fingerprint;
+    time_t m_expiresAt;
+    std::vector<twitUploadSegment> m_segments;
+
+    bool saveState( std::string& errorMessage );
+    void reset();
+
+    twitUploadSession( const twitUploadSession& );
+    twitUploadSession& operator=( const twitUploadSession& );
+};
+
+#endif // _TWITUPLOADSESSION_H_
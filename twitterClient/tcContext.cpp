@@ -1,18 +1,36 @@
-﻿#include <deque>
+﻿#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <map>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <regex>
 #include <picojson/picojson.h>
 #include "TwitterClient.h"
+#include "twithash.h"
+#include "twitmediacache.h"
 
 
 struct tcMediaData
 {
     twitCurlTypes::eTwitCurlMediaType type;
-    std::shared_ptr<std::istream> stream;
+    std::shared_ptr<twitMediaSource> source;
     std::string media_id;
+    twitMediaProcessing processing;
+    time_t expires_at;
+    unsigned long long hash;
+    bool hashed;
+    bool cached;
+
+    tcMediaData() : type(twitCurlTypes::eTwitCurlMediaUnknown), expires_at(0), hash(0), hashed(false), cached(false)
+    {
+        processing.state = twitCurlTypes::eTwitCurlMediaStateNone;
+        processing.checkAfterSecs = 0;
+        processing.progressPercent = -1;
+    }
 };
 typedef std::list<tcMediaData> tcMediaCont;
 typedef std::shared_ptr<tcMediaCont> tcMediaContPtr;
@@ -27,7 +45,9 @@ struct tcTweetData
 
     tcTweetData() : code(tcEStatusCode_Unknown) {}
 };
-typedef std::vector<tcTweetData> tcTweetDataCont;
+typedef std::shared_ptr<tcTweetData> tcTweetDataPtr;
+// keyed by handle, so erasing a tweet leaves the handles of the others alone
+typedef std::map<int, tcTweetDataPtr> tcTweetDataCont;
 
 
 class tcContext
@@ -54,7 +74,11 @@ public:
     tcAuthState     getEnterPinState();
 
     bool            addMedia(const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype);
+    bool            addMediaBorrowed(const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype,
+                                     tcMediaReleaseCallback release, void *userdata);
+    bool            addMediaOwned(void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype);
     bool            addMediaFile(const char *path);
+    bool            enableMediaCache(const char *path);
     int             tweet(const char *message);
     int             tweetAsync(const char *message);
     tcTweetState    getTweetStatus(int thandle);
@@ -63,9 +87,16 @@ public:
 
 private:
     bool getErrorMessage(std::string &dst, bool error_if_response_is_not_json=false);
+    void pushMedia(twitCurlTypes::eTwitCurlMediaType mtype, const std::shared_ptr<twitMediaSource> &source);
     int pushTweet(const char *message);
-    void tweetImpl(tcTweetData &tw);
+    tcTweetDataPtr findTweet(int thandle);
+    bool uploadTweetMedia(tcTweetData &tw);
+    int tweetMediaWait(tcTweetData &tw);
+    void pollTweetMedia(tcTweetData &tw);
+    void postTweet(tcTweetData &tw);
+    void continueTweetAsync(int thandle);
     void enqueueTask(const std::function<void()> &f);
+    void enqueueDelayedTask(int seconds, const std::function<void()> &f);
     void processTasks();
 
 private:
@@ -76,12 +107,16 @@ private:
     std::string m_auth_error;
 
     tcMediaContPtr m_media;
+    std::unique_ptr<twitMediaCache> m_media_cache;
+    std::mutex m_tweets_mutex;
     tcTweetDataCont m_tweets;
+    int m_last_tweet_handle;
 
     std::thread m_send_thread;
     std::mutex m_queue_mutex;
     std::condition_variable m_condition;
     std::deque<std::function<void ()>> m_tasks;
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void ()>> m_delayed_tasks;
     bool m_stop;
 };
 
@@ -90,6 +125,7 @@ private:
 tcContext::tcContext()
     : m_stop(false)
     , m_auth_code(tcEStatusCode_Unknown)
+    , m_last_tweet_handle(0)
 {
     m_send_thread = std::thread([this](){ processTasks(); });
 }
@@ -252,14 +288,38 @@ tcAuthState tcContext::getEnterPinState()
 }
 
 bool tcContext::addMedia(const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype)
+{
+    std::string copy((const char*)data, data_size);
+    pushMedia(mtype, std::make_shared<twitMemoryMediaSource>(copy));
+    return true;
+}
+
+// the upload reads the caller's buffer in place; release says when it is free again
+bool tcContext::addMediaBorrowed(const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype,
+                                 tcMediaReleaseCallback release, void *userdata)
+{
+    twitMediaReleaseCallback on_release;
+    if (release) {
+        on_release = [release, userdata](const char *p, size_t size) { release(p, (int)size, userdata); };
+    }
+    pushMedia(mtype, std::make_shared<twitMemoryMediaSource>((const char*)data, (size_t)data_size, on_release));
+    return true;
+}
+
+// data must come from malloc(), it is freed once no longer needed
+bool tcContext::addMediaOwned(void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype)
+{
+    return addMediaBorrowed(data, data_size, mtype,
+        [](const void *p, int, void *) { free(const_cast<void*>(p)); }, nullptr);
+}
+
+void tcContext::pushMedia(twitCurlTypes::eTwitCurlMediaType mtype, const std::shared_ptr<twitMediaSource> &source)
 {
     if (!m_media) { m_media.reset(new tcMediaCont()); }
     m_media->push_back(tcMediaData());
     tcMediaData &md = m_media->back();
     md.type = mtype;
-    md.stream.reset(
-        new std::istringstream(std::move(std::string((const char*)data, data_size)), std::ios::binary));
-    return true;
+    md.source = source;
 }
 
 
@@ -272,6 +332,16 @@ void tcContext::enqueueTask(const std::function<void()> &f)
     m_condition.notify_one();
 }
 
+// runs f on the task thread once seconds have passed, without holding it meanwhile
+void tcContext::enqueueDelayedTask(int seconds, const std::function<void()> &f)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_queue_mutex);
+        m_delayed_tasks.insert(std::make_pair(std::chrono::steady_clock::now() + std::chrono::seconds(seconds), f));
+    }
+    m_condition.notify_one();
+}
+
 void tcContext::processTasks()
 {
     while (!m_stop)
@@ -279,10 +349,23 @@ void tcContext::processTasks()
         std::function<void()> task;
         {
             std::unique_lock<std::mutex> lock(m_queue_mutex);
-            while (!m_stop && m_tasks.empty()) {
-                m_condition.wait(lock);
+            for (;;) {
+                if (m_stop) { return; }
+
+                auto now = std::chrono::steady_clock::now();
+                while (!m_delayed_tasks.empty() && m_delayed_tasks.begin()->first <= now) {
+                    m_tasks.push_back(m_delayed_tasks.begin()->second);
+                    m_delayed_tasks.erase(m_delayed_tasks.begin());
+                }
+                if (!m_tasks.empty()) { break; }
+
+                if (m_delayed_tasks.empty()) {
+                    m_condition.wait(lock);
+                }
+                else {
+                    m_condition.wait_until(lock, m_delayed_tasks.begin()->first);
+                }
             }
-            if (m_stop) { return; }
 
             task = m_tasks.front();
             m_tasks.pop_front();
@@ -291,83 +374,216 @@ void tcContext::processTasks()
     }
 }
 
-void tcContext::tweetImpl(tcTweetData &tw)
+bool tcContext::uploadTweetMedia(tcTweetData &tw)
 {
-    tcEStatusCode code = tcEStatusCode_Failed;
-    if (tw.media) {
-        for (auto &media : *tw.media) {
-            if (!m_twitter.uploadMedia(*media.stream, media.type, media.media_id, tw.error_message)) {
-                break;
+    if (!tw.media || tw.media->empty()) { return true; }
+
+    // every attachment goes up at once over its own connection,
+    // and the first one that fails aborts the others
+    std::atomic<bool> cancel(false);
+    std::mutex error_mutex;
+    auto upload = [&](twitCurl *twitter, tcMediaData *media) {
+        // media attached before is not uploaded again while its id is valid
+        if (m_media_cache) {
+            media->hash = twitHashSource(*media->source, media->hashed);
+            media->cached = media->hashed &&
+                m_media_cache->lookup(media->hash, media->source->getSize(), media->type, media->media_id);
+        }
+        if (media->cached) { return; }
+
+        std::string error;
+        if (twitter->uploadMedia(*media->source, media->type, media->media_id, error)) {
+            twitter->getLastMediaProcessing(media->processing);
+            media->expires_at = twitter->getLastMediaExpiry();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(error_mutex);
+        if (!cancel) {
+            tw.error_message = error.empty() ? "media upload failed" : error;
+            cancel = true;
+        }
+    };
+
+    m_twitter.setCancelFlag(&cancel);
+    std::vector<std::unique_ptr<twitCurl>> clones;
+    std::vector<std::thread> workers;
+    auto it = tw.media->begin();
+    tcMediaData *first = &*it;
+    for (++it; it != tw.media->end(); ++it) {
+        clones.emplace_back(m_twitter.clone());
+        workers.emplace_back(upload, clones.back().get(), &*it);
+    }
+    upload(&m_twitter, first);
+    for (auto &worker : workers) { worker.join(); }
+    m_twitter.setCancelFlag(nullptr);
+    if (cancel) { return false; }
+
+    // media_ids keep the order the media was added in
+    for (auto &media : *tw.media) {
+        if (!tw.tweet.media_ids.empty()) { tw.tweet.media_ids += ","; }
+        tw.tweet.media_ids += media.media_id;
+    }
+    return true;
+}
+
+// seconds until the media of tw is worth asking about again,
+// 0 once all of it can be attached, -1 if processing failed
+int tcContext::tweetMediaWait(tcTweetData &tw)
+{
+    int wait = 0;
+    if (!tw.error_message.empty()) { return -1; }
+    if (!tw.media) { return 0; }
+    for (auto &media : *tw.media) {
+        switch (media.processing.state) {
+        case twitCurlTypes::eTwitCurlMediaStateFailed:
+            tw.error_message = media.processing.errorMessage;
+            return -1;
+        case twitCurlTypes::eTwitCurlMediaStatePending:
+        case twitCurlTypes::eTwitCurlMediaStateInProgress:
+            wait = std::max(wait, std::max(media.processing.checkAfterSecs, 1));
+            break;
+        default:
+            break;
+        }
+    }
+    return wait;
+}
+
+void tcContext::pollTweetMedia(tcTweetData &tw)
+{
+    if (!tw.media) { return; }
+    for (auto &media : *tw.media) {
+        if (media.processing.state != twitCurlTypes::eTwitCurlMediaStatePending &&
+            media.processing.state != twitCurlTypes::eTwitCurlMediaStateInProgress)
+        {
+            continue;
+        }
+        if (!m_twitter.mediaStatus(media.media_id, media.processing)) {
+            media.processing.state = twitCurlTypes::eTwitCurlMediaStateFailed;
+            if (!getErrorMessage(media.processing.errorMessage, true)) {
+                media.processing.errorMessage = "media status check failed";
             }
-            if (!tw.tweet.media_ids.empty()) { tw.tweet.media_ids += ","; }
-            tw.tweet.media_ids += media.media_id;
         }
     }
+}
+
+// posts the status once its media is usable, or records why it can't be
+void tcContext::postTweet(tcTweetData &tw)
+{
+    tcEStatusCode code = tcEStatusCode_Failed;
     if (tw.error_message.empty()) {
+        if (m_media_cache && tw.media) {
+            for (auto &media : *tw.media) {
+                if (media.hashed && !media.cached) {
+                    m_media_cache->insert(media.hash, media.source->getSize(), media.type,
+                                          media.media_id, media.expires_at);
+                }
+            }
+        }
         if (m_twitter.statusUpdate(tw.tweet)) {
             code = getErrorMessage(tw.error_message) ? tcEStatusCode_Failed : tcEStatusCode_Succeeded;
         }
     }
+    // a cached id twitter no longer takes must not fail the next tweet too
+    if (code == tcEStatusCode_Failed && m_media_cache && tw.media) {
+        for (auto &media : *tw.media) {
+            if (media.cached) { m_media_cache->erase(media.hash, media.source->getSize(), media.type); }
+        }
+    }
     tw.media.reset();
     tw.code = code;
 }
 
-int tcContext::pushTweet(const char *message)
+void tcContext::continueTweetAsync(int t)
 {
-    // handle 0 == invalid
-    if (m_tweets.empty()) { m_tweets.push_back(tcTweetData()); }
-    int ret = (int)m_tweets.size();
+    // looked up again on each step: a tweet erased meanwhile is dropped
+    tcTweetDataPtr tw = findTweet(t);
+    if (!tw) { return; }
+
+    // while twitter processes the media the task thread serves other tweets
+    int wait = tweetMediaWait(*tw);
+    if (wait > 0) {
+        enqueueDelayedTask(wait, [this, t](){
+            tcTweetDataPtr tw = findTweet(t);
+            if (!tw) { return; }
+            pollTweetMedia(*tw);
+            continueTweetAsync(t);
+        });
+        return;
+    }
+    postTweet(*tw);
+}
 
-    m_tweets.push_back(tcTweetData());
-    tcTweetData &tw = m_tweets.back();
-    tw.code = tcEStatusCode_InProgress;
-    tw.tweet.status = message;
-    tw.media = m_media;
+int tcContext::pushTweet(const char *message)
+{
+    tcTweetDataPtr tw = std::make_shared<tcTweetData>();
+    tw->code = tcEStatusCode_InProgress;
+    tw->tweet.status = message;
+    tw->media = m_media;
     m_media.reset();
+
+    // handle 0 == invalid, handles are never reused
+    std::unique_lock<std::mutex> lock(m_tweets_mutex);
+    int ret = ++m_last_tweet_handle;
+    m_tweets[ret] = tw;
     return ret;
 }
 
+tcTweetDataPtr tcContext::findTweet(int thandle)
+{
+    std::unique_lock<std::mutex> lock(m_tweets_mutex);
+    auto it = m_tweets.find(thandle);
+    return it == m_tweets.end() ? nullptr : it->second;
+}
+
 int tcContext::tweet(const char *message)
 {
     int t = pushTweet(message);
-    tweetImpl(m_tweets[t]);
+    // held to the end so an erase meanwhile does not free it under us
+    tcTweetDataPtr tw = findTweet(t);
+    uploadTweetMedia(*tw);
+    // the caller asked to block, so processing is waited out here
+    for (int wait; (wait = tweetMediaWait(*tw)) > 0; ) {
+        std::this_thread::sleep_for(std::chrono::seconds(wait));
+        pollTweetMedia(*tw);
+    }
+    postTweet(*tw);
     return t;
 }
 
 int tcContext::tweetAsync(const char *message)
 {
     int t = pushTweet(message);
-    enqueueTask([this, t](){ tweetImpl(m_tweets[t]); });
+    enqueueTask([this, t](){
+        tcTweetDataPtr tw = findTweet(t);
+        if (!tw) { return; }
+        uploadTweetMedia(*tw);
+        continueTweetAsync(t);
+    });
     return t;
 }
 
 tcTweetState tcContext::getTweetStatus(int thandle)
 {
     tcTweetState r = { tcEStatusCode_Unknown, nullptr };
-    if (thandle <= m_tweets.size())
+    if (tcTweetDataPtr tw = findTweet(thandle))
     {
-        auto & tw = m_tweets[thandle];
-        r.code = tw.code;
-        r.error_message = tw.error_message.c_str();
+        r.code = tw->code;
+        r.error_message = tw->error_message.c_str();
     }
     return r;
 }
 
 void tcContext::eraseTweetCache(int thandle)
 {
-    if (thandle <= m_tweets.size() && thandle > 0)
-    {
-        m_tweets.erase(m_tweets.begin()+thandle);
-    }
+    // a step of the tweet under way keeps its data until it returns
+    std::unique_lock<std::mutex> lock(m_tweets_mutex);
+    m_tweets.erase(thandle);
 }
 
 tcTweetData* tcContext::getTweetData(int thandle)
 {
-    if (thandle <= m_tweets.size())
-    {
-        return &m_tweets[thandle];
-    }
-    return nullptr;
+    return findTweet(thandle).get();
 }
 
 bool tcContext::addMediaFile(const char *path)
@@ -376,15 +592,21 @@ bool tcContext::addMediaFile(const char *path)
     mtype = tcGetMediaTypeByFilename(path);
     if (mtype == twitCurlTypes::eTwitCurlMediaUnknown) { return false; }
 
-    if (!m_media) { m_media.reset(new tcMediaCont()); }
-    m_media->push_back(tcMediaData());
-    tcMediaData &md = m_media->back();
-    md.type = mtype;
-    md.stream.reset(new std::ifstream(path, std::ios::binary));
-
+    // mapped, the upload reads straight from the page cache
+    std::shared_ptr<twitMappedMediaSource> source(new twitMappedMediaSource());
+    if (!source->open(path)) { return false; }
+    pushMedia(mtype, source);
     return true;
 }
 
+// path keeps the cache across restarts; null or empty keeps it in memory
+bool tcContext::enableMediaCache(const char *path)
+{
+    m_media_cache.reset(new twitMediaCache(path ? path : ""));
+    std::string error;
+    return m_media_cache->loadState(error);
+}
+
 
 
 
@@ -481,10 +703,22 @@ tcCLinkage tcExport bool tcAddMedia(tcContext *ctx, const void *data, int data_s
 {
     return ctx->addMedia(data, data_size, mtype);
 }
+tcCLinkage tcExport bool tcAddMediaBorrowed(tcContext *ctx, const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype, tcMediaReleaseCallback release, void *userdata)
+{
+    return ctx->addMediaBorrowed(data, data_size, mtype, release, userdata);
+}
+tcCLinkage tcExport bool tcAddMediaOwned(tcContext *ctx, void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype)
+{
+    return ctx->addMediaOwned(data, data_size, mtype);
+}
 tcCLinkage tcExport bool tcAddMediaFile(tcContext *ctx, const char *path)
 {
     return ctx->addMediaFile(path);
 }
+tcCLinkage tcExport bool tcEnableMediaCache(tcContext *ctx, const char *path)
+{
+    return ctx->enableMediaCache(path);
+}
 tcCLinkage tcExport int tcTweet(tcContext *ctx, const char *message)
 {
     return ctx->tweet(message);
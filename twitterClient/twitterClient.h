@@ -53,6 +53,9 @@ struct tcTweetState
     const char *error_message;
 };
 
+// called once a buffer given to tcAddMediaBorrowed() is no longer used
+typedef void (*tcMediaReleaseCallback)(const void *data, int data_size, void *userdata);
+
 
 tcCLinkage tcExport tcContext*      tcCreateContext();
 tcCLinkage tcExport void            tcDestroyContext(tcContext *ctx);
@@ -73,7 +76,10 @@ tcCLinkage tcExport void            tcEnterPinAsync(tcContext *ctx, const char *
 tcCLinkage tcExport tcAuthState     tcGetEnterPinState(tcContext *ctx);
 
 tcCLinkage tcExport bool            tcAddMedia(tcContext *ctx, const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype);
+tcCLinkage tcExport bool            tcAddMediaBorrowed(tcContext *ctx, const void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype, tcMediaReleaseCallback release, void *userdata);
+tcCLinkage tcExport bool            tcAddMediaOwned(tcContext *ctx, void *data, int data_size, twitCurlTypes::eTwitCurlMediaType mtype);
 tcCLinkage tcExport bool            tcAddMediaFile(tcContext *ctx, const char *path);
+tcCLinkage tcExport bool            tcEnableMediaCache(tcContext *ctx, const char *path);
 tcCLinkage tcExport int             tcTweet(tcContext *ctx, const char *message);
 tcCLinkage tcExport int             tcTweetAsync(tcContext *ctx, const char *message);
 tcCLinkage tcExport tcTweetState    tcGetTweetState(tcContext *ctx, int thandle);